@@ -0,0 +1,118 @@
+/* endianbench.c:
+ * Compares the endian handling of the byte accessors before and after the
+ * switch to hardware byte swaps and endian specific entry points.
+ * Build from the folder holding the 'store' folder, e.g.
+ *   cc -O2 -I. store/benchmark/endianbench.c store/implementation/[a-z]*.c \
+ *      -o endianbench
+ * Prints one line per case: name, ns per operation and a checksum which
+ * keeps the compiler from dropping the work.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "store/store.h"
+#include "store/storeutil.h"
+
+#define TOTAL_LOCATIONS 4096
+#define ITERATIONS 2000000
+
+/* uint64_t legacyInvertEndian(uint64_t number, unsigned byteLength):
+ * The divide and modulo loop invertEndian used before, kept as baseline.
+ */
+static uint64_t legacyInvertEndian(uint64_t number, unsigned byteLength){
+  byteLength = byteLength*!(byteLength/8) + 8*(bool)(byteLength/8);
+
+  uint64_t result = 0;
+
+  for (unsigned index = 0; index < byteLength; index++){
+    result = result*256 + number % 256;
+    number /= 256;
+  }
+
+  return result;
+}
+
+static double nowNanoseconds(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static void report(const char *name, double start, uint64_t checksum){
+  printf("%-44s %8.2f ns/op  checksum %016"PRIx64"\n", name,
+         (nowNanoseconds() - start) / ITERATIONS, checksum);
+}
+
+int main(void){
+  volatile unsigned byteLength = 4;
+  uint64_t checksum = 0;
+  double start;
+
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    checksum += legacyInvertEndian(index * 0x9e3779b9u, byteLength);
+  report("legacy invertEndian loop, 4 bytes", start, checksum);
+
+  checksum = 0;
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    checksum += invertEndian(index * 0x9e3779b9u, byteLength);
+  report("invertEndian byte swap, 4 bytes", start, checksum);
+
+  store matrix = initializeStoreofKind(TOTAL_LOCATIONS, 32, MATRIX_STORE);
+  store packed = initializeStoreofKind(TOTAL_LOCATIONS, 32, PACKED_STORE);
+  for (uint64_t location = 0; location < TOTAL_LOCATIONS; location++){
+    uint64_t number = (location * 2654435761u) & 0xffffffff;
+    writeBytestoStore(matrix, location, 0, number, 4, LITTLEENDIAN);
+    writeBytestoStore(packed, location, 0, number, 4, LITTLEENDIAN);
+  }
+
+  checksum = 0;
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    checksum += readBytesfromStore(matrix, index % TOTAL_LOCATIONS, 0, 4,
+                                   LITTLEENDIAN);
+  report("readBytesfromStore, matrix, little endian", start, checksum);
+
+  checksum = 0;
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    checksum += readBytesfromStore(packed, index % TOTAL_LOCATIONS, 0, 4,
+                                   LITTLEENDIAN);
+  report("readBytesfromStore, packed, little endian", start, checksum);
+
+  checksum = 0;
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    checksum += readLittleEndianBytesfromStore(packed,
+                                               index % TOTAL_LOCATIONS, 0, 4);
+  report("readLittleEndianBytesfromStore, packed", start, checksum);
+
+  checksum = 0;
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    checksum += readBigEndianBytesfromStore(packed,
+                                            index % TOTAL_LOCATIONS, 0, 4);
+  report("readBigEndianBytesfromStore, packed", start, checksum);
+
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    writeBytestoStore(matrix, index % TOTAL_LOCATIONS, 0, index, 4,
+                      LITTLEENDIAN);
+  report("writeBytestoStore, matrix, little endian", start, 0);
+
+  start = nowNanoseconds();
+  for (uint64_t index = 0; index < ITERATIONS; index++)
+    writeLittleEndianBytestoStore(packed, index % TOTAL_LOCATIONS, 0,
+                                  index & 0xffffffff, 4);
+  report("writeLittleEndianBytestoStore, packed", start, 0);
+
+  destroyStore(&matrix);
+  destroyStore(&packed);
+
+  return 0;
+}
@@ -0,0 +1,1050 @@
+/* storebench.c:
+ * Measures the access paths of the store API across store kinds, word
+ * sizes, store sizes and access patterns. The per bit paths the fast ones
+ * replaced are kept here as legacy* baselines, run just before them.
+ * Build from the folder holding the 'store' folder, e.g.
+ *   cc -O2 -I. store/benchmark/storebench.c store/implementation/[a-z]*.c \
+ *      -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc -lm -lpthread \
+ *      -o storebench
+ * The --wrap flags let it count allocations, without them allocations per
+ * operation print as -1.
+ * Run as
+ *   storebench [largest store in MiB, default 256] [operations per case,
+ *              default 1048576] [only cases whose name holds this text]
+ * Stores hold about 16 KiB (in L1), 1 MiB (in L2 or LLC) and the largest
+ * size (far past LLC) of packed bits, MATRIX_STORE, taking a byte per bit
+ * and a heap row per location, only up to 1 << 20 locations.
+ * Prints comma separated values, a header line then one line per case:
+ * case, kind, wordSize, locations, bytes of packed bits, pattern,
+ * operations, ns per operation, GB/s of bits accessed, allocations per
+ * operation, peak resident KiB during the case, and a checksum which keeps
+ * the compiler from dropping the work.
+ */
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "store/store.h"
+#include "store/storeatomic.h"
+#include "store/registerfile.h"
+#include "store/storeblock.h"
+#include "store/storedirty.h"
+#include "store/storefield.h"
+#include "store/storefile.h"
+#include "store/storehash.h"
+#include "store/storesnapshot.h"
+#include "store/storeutil.h"
+#include "store/vectorstore.h"
+
+#define SMALL_STORE_BYTES ((uint64_t)16 << 10)
+#define MEDIUM_STORE_BYTES ((uint64_t)1 << 20)
+#define MATRIX_LOCATION_LIMIT ((uint64_t)1 << 20)
+#define BLOCK_LOCATIONS 64
+/* odd, so strides visit every location, and past a page of most stores.*/
+#define STRIDE_LOCATIONS 4097
+#define WHOLE_STORE_PASSES 4
+#define VECTOR_ELEMENT_BITS 8
+#define VECTOR_SLIDE_ELEMENTS 3
+#define BENCHMARK_REGISTERS 32
+#define REGISTERS_PER_OP 4
+#define BENCHMARK_FIELDS 2
+
+static const uint64_t wordSizes[] = {1, 8, 32, 64, 200};
+static const char *kindNames[] = {"matrix", "packed", "paged"};
+
+typedef enum{
+  SEQUENTIAL_ACCESS,
+  STRIDED_ACCESS,
+  RANDOM_ACCESS,
+  WHOLE_STORE
+}accessPattern;
+
+static const char *patternNames[] = {"sequential", "strided", "random",
+                                     "whole"};
+
+/* struct benchmarkContext:
+ * Store under measure and how a case walks it: totalLocations is a power
+ * of two, 1 << locationBits, so patterns only mask. 'fields' are compiled
+ * for the word size of the store, when it takes them.
+ */
+typedef struct{
+  store *STORE;
+  accessPattern pattern;
+  uint64_t mask;
+  unsigned locationBits;
+  unsigned width;
+  unsigned byteLength;
+  uint8_t *buffer;
+  bool bits[64];
+  fieldDescriptor fields[BENCHMARK_FIELDS];
+}benchmarkContext;
+
+/* enum caseNeeds:
+ * What a case needs from the store, it is skipped otherwise.
+ */
+enum caseNeeds{
+  NEEDS_NOTHING = 0,
+  NEEDS_BYTES = 1,
+  NEEDS_FLAT_WORDS = 2,
+  NEEDS_WHOLE_STORE = 4,
+  NEEDS_VECTOR_WORDS = 8,
+  NEEDS_NARROW_WORDS = 16,
+  NEEDS_PACKED_STORE = 32
+};
+
+/* enum caseBits:
+ * Bits one operation of a case accesses, for GB/s.
+ */
+enum caseBits{
+  ONE_BIT,
+  FIELD_BITS,
+  BYTE_BITS,
+  WORD_BITS,
+  FIELDS_BITS,
+  REGISTERS_BITS,
+  BLOCK_BITS,
+  STORE_BITS
+};
+
+typedef struct{
+  const char *name;
+  uint64_t (*run)(const benchmarkContext *context, uint64_t ops);
+  unsigned needs;
+  enum caseBits bits;
+}benchmarkCase;
+
+
+
+/* Allocations of the library and the benchmark, counted when linked with
+ * --wrap, __real_malloc being then the malloc of the C library. Weak, so
+ * the benchmark links without the flags too.
+ */
+void *__real_malloc(size_t size) __attribute__((weak));
+void *__real_calloc(size_t count, size_t size) __attribute__((weak));
+void *__real_realloc(void *pointer, size_t size) __attribute__((weak));
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t count, size_t size);
+void *__wrap_realloc(void *pointer, size_t size);
+
+/* volatile, as compilers take malloc for touching no global of the
+ * program.*/
+static volatile uint64_t totalAllocations;
+
+void *__wrap_malloc(size_t size){
+  totalAllocations++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size){
+  totalAllocations++;
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size){
+  totalAllocations++;
+  return __real_realloc(pointer, size);
+}
+
+
+
+/* uint64_t legacyInvertEndian(uint64_t number, unsigned byteLength):
+ * The divide and modulo loop invertEndian used before, kept as baseline.
+ */
+static uint64_t legacyInvertEndian(uint64_t number, unsigned byteLength){
+  byteLength = byteLength*!(byteLength/8) + 8*(bool)(byteLength/8);
+
+  uint64_t result = 0;
+
+  for (unsigned index = 0; index < byteLength; index++){
+    result = result*256 + number % 256;
+    number /= 256;
+  }
+
+  return result;
+}
+
+
+
+/* bool *legacyReadMultiBits(const store STORE, const uint64_t location,
+                             const uint64_t wordStartBit,
+                             const uint64_t numberofBits):
+ * The bit by bit loop readMultiBitsfromStore used before, into a malloced
+ * array, kept as baseline without its checks and warnings.
+ */
+static bool *legacyReadMultiBits(const store STORE, const uint64_t location,
+                                 const uint64_t wordStartBit,
+                                 const uint64_t numberofBits){
+  bool *bitArray = (bool*)malloc(sizeof(bool)*numberofBits);
+  for (uint64_t index = 0; index < numberofBits; index++){
+    bitArray[numberofBits - index - 1] =
+     readBitfromStore(STORE, location, wordStartBit + index);
+  }
+
+  return bitArray;
+}
+
+
+
+/* uint64_t legacyReadNumBits(const store STORE, const uint64_t location,
+                              const uint64_t wordStartBit,
+                              const uint64_t bitWidth):
+ * The path readNumBitsfromStore took before, legacyReadMultiBits then the
+ * multiply and add loop of bitStringtoNumber. The array, leaked before, is
+ * freed so long cases don't run out of memory.
+ */
+static uint64_t legacyReadNumBits(const store STORE, const uint64_t location,
+                                  const uint64_t wordStartBit,
+                                  const uint64_t bitWidth){
+  bool *bitArray = legacyReadMultiBits(STORE, location, wordStartBit,
+                                       bitWidth);
+  uint64_t number = 0;
+
+  for (uint64_t index = 0; index < bitWidth; index++)
+    number = number*2 + bitArray[bitWidth - index - 1];
+  free(bitArray);
+
+  return number;
+}
+
+
+
+/* int legacyWriteNumBits(const store STORE, const uint64_t location,
+                          const uint64_t wordStartBit, uint64_t number,
+                          const uint64_t length):
+ * The path writeNumBitstoStore took before: truncating through pow, then
+ * a malloced array of bits built by divide and modulo for
+ * writeMultiBitstoStore, freed here too.
+ */
+static int legacyWriteNumBits(const store STORE, const uint64_t location,
+                              const uint64_t wordStartBit, uint64_t number,
+                              const uint64_t length){
+  if (length < 64 && number >= pow(2, length))
+    number %= (uint64_t)pow(2, length);
+
+  bool *bitString = malloc(sizeof(bool)*length);
+  for (uint64_t index = 0; index < length; index++){
+    bitString[index] = number % 2;
+    number /= 2;
+  }
+  int result = writeMultiBitstoStore(STORE, location, wordStartBit,
+                                     bitString, length);
+  free(bitString);
+
+  return result;
+}
+
+
+
+/* uint64_t legacyReadBytes(const store STORE, const uint64_t location,
+                            const uint64_t wordStartBit,
+                            const unsigned byteLength,
+                            const bool endianStyle):
+ * The path readBytesfromStore took before, over legacyReadNumBits and
+ * legacyInvertEndian.
+ */
+static uint64_t legacyReadBytes(const store STORE, const uint64_t location,
+                                const uint64_t wordStartBit,
+                                const unsigned byteLength,
+                                const bool endianStyle){
+  uint64_t number = legacyReadNumBits(STORE, location, wordStartBit,
+                                      byteLength * 8);
+
+  if (endianStyle == LITTLEENDIAN)
+    number = legacyInvertEndian(number, byteLength);
+
+  return number;
+}
+
+
+
+/* int legacyWriteBytes(const store STORE, const uint64_t location,
+                        const uint64_t wordStartBit, uint64_t number,
+                        const unsigned byteLength, const bool endianStyle):
+ * The path writeBytestoStore took before, over legacyInvertEndian and
+ * legacyWriteNumBits.
+ */
+static int legacyWriteBytes(const store STORE, const uint64_t location,
+                            const uint64_t wordStartBit, uint64_t number,
+                            const unsigned byteLength,
+                            const bool endianStyle){
+  if (endianStyle == LITTLEENDIAN)
+    number = legacyInvertEndian(number, byteLength);
+
+  return legacyWriteNumBits(STORE, location, wordStartBit, number,
+                            byteLength * 8);
+}
+
+static double nowNanoseconds(void){
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+
+
+/* void resetPeakResident(void):
+ * Makes the peak resident size restart from the current one, on Linux.
+ */
+static void resetPeakResident(void){
+  int fd = open("/proc/self/clear_refs", O_WRONLY);
+  if (fd < 0)
+    return;
+  if (write(fd, "5", 1) < 0){}
+  close(fd);
+}
+
+
+
+/* long peakResidentKiB(void):
+ * Returns peak resident size since resetPeakResident, or of the process
+ * where it can't be reset.
+ */
+static long peakResidentKiB(void){
+  FILE *status = fopen("/proc/self/status", "r");
+  char line[128];
+  long peak = -1;
+
+  if (status != NULL){
+    while (fgets(line, sizeof(line), status) != NULL)
+      if (sscanf(line, "VmHWM: %ld", &peak) == 1)
+        break;
+    fclose(status);
+  }
+  if (peak < 0){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    peak = usage.ru_maxrss;
+  }
+
+  return peak;
+}
+
+
+
+/* uint64_t locationofOp(const benchmarkContext *context, uint64_t op):
+ * Returns location accessed by operation 'op' of the pattern, random
+ * access going through a bijection of the locations, so every location is
+ * visited once per pass as with the other patterns.
+ */
+static inline uint64_t locationofOp(const benchmarkContext *context,
+                                    uint64_t op){
+  switch (context->pattern){
+    case STRIDED_ACCESS:
+      return (op * STRIDE_LOCATIONS) & context->mask;
+    case RANDOM_ACCESS:{
+      uint64_t location = (op * 0x9e3779b97f4a7c15ULL) & context->mask;
+      location ^= location >> (context->locationBits / 2 + 1);
+      return (location * 0xbf58476d1ce4e5b9ULL) & context->mask;
+    }
+    default:
+      return op & context->mask;
+  }
+}
+
+
+
+/* BENCHMARK_ACCESS(name, expression):
+ * Defines run##name, evaluating expression at the location of every
+ * operation, 'STORE', 'location' and 'context' in scope, and returning the
+ * sum of its values.
+ */
+#define BENCHMARK_ACCESS(name, expression)                                    \
+  static uint64_t run##name(const benchmarkContext *context, uint64_t ops){   \
+    store *STORE = context->STORE;                                            \
+    uint64_t checksum = 0;                                                    \
+    (void)STORE;                                                              \
+    for (uint64_t op = 0; op < ops; op++){                                    \
+      uint64_t location = locationofOp(context, op);                          \
+      checksum += (uint64_t)(expression);                                     \
+    }                                                                         \
+    return checksum;                                                          \
+  }
+
+BENCHMARK_ACCESS(ReadBit,
+                 readBitfromStore(*STORE, location,
+                                  location % STORE->wordSize))
+BENCHMARK_ACCESS(ReadStoreBit,
+                 readStoreBit(STORE, location, location % STORE->wordSize))
+BENCHMARK_ACCESS(WriteBit,
+                 writeBittoStore(*STORE, location,
+                                 location % STORE->wordSize, location & 1))
+BENCHMARK_ACCESS(WriteStoreBit,
+                 writeStoreBit(STORE, location, location % STORE->wordSize,
+                               location & 1))
+BENCHMARK_ACCESS(LegacyReadNumBits,
+                 legacyReadNumBits(*STORE, location, 0, context->width))
+BENCHMARK_ACCESS(ReadNumBits,
+                 readNumBitsfromStore(*STORE, location, 0, context->width))
+BENCHMARK_ACCESS(ReadField,
+                 readFieldfromStore(*STORE, location, 0, context->width))
+BENCHMARK_ACCESS(ReadStoreField,
+                 readStoreField(STORE, location, 0, context->width))
+BENCHMARK_ACCESS(LegacyWriteNumBits,
+                 legacyWriteNumBits(*STORE, location, 0, location,
+                                    context->width))
+BENCHMARK_ACCESS(WriteNumBits,
+                 writeNumBitstoStore(*STORE, location, 0, location,
+                                     context->width))
+BENCHMARK_ACCESS(WriteField,
+                 writeFieldtoStore(*STORE, location, 0, context->width,
+                                   location))
+BENCHMARK_ACCESS(WriteStoreField,
+                 writeStoreField(STORE, location, 0, context->width,
+                                 location))
+BENCHMARK_ACCESS(ReadMultiBitsintoBuffer,
+                 readMultiBitsintoBuffer(*STORE, location, 0, context->width,
+                                         (bool*)context->buffer) +
+                 context->buffer[0])
+BENCHMARK_ACCESS(WriteMultiBits,
+                 writeMultiBitstoStore(*STORE, location, 0,
+                                       context->bits,
+                                       context->width))
+BENCHMARK_ACCESS(LegacyReadBytes,
+                 legacyReadBytes(*STORE, location, 0, context->byteLength,
+                                 LITTLEENDIAN))
+BENCHMARK_ACCESS(ReadBytes,
+                 readBytesfromStore(*STORE, location, 0, context->byteLength,
+                                    LITTLEENDIAN))
+BENCHMARK_ACCESS(ReadLittleEndianBytes,
+                 readLittleEndianBytesfromStore(*STORE, location, 0,
+                                                context->byteLength))
+BENCHMARK_ACCESS(ReadBigEndianBytes,
+                 readBigEndianBytesfromStore(*STORE, location, 0,
+                                             context->byteLength))
+BENCHMARK_ACCESS(LegacyWriteBytes,
+                 legacyWriteBytes(*STORE, location, 0, location,
+                                  context->byteLength, LITTLEENDIAN))
+BENCHMARK_ACCESS(WriteBytes,
+                 writeBytestoStore(*STORE, location, 0, location,
+                                   context->byteLength, LITTLEENDIAN))
+BENCHMARK_ACCESS(WriteLittleEndianBytes,
+                 writeLittleEndianBytestoStore(*STORE, location, 0, location,
+                                               context->byteLength))
+BENCHMARK_ACCESS(ReadValue,
+                 readValuefromStore(*STORE, location, 0, context->byteLength,
+                                    LITTLEENDIAN, context->buffer) +
+                 context->buffer[0])
+BENCHMARK_ACCESS(WriteValue,
+                 writeValuetoStore(*STORE, location, 0, context->byteLength,
+                                   LITTLEENDIAN, &location))
+BENCHMARK_ACCESS(ReadBlock,
+                 readBlockfromStore(*STORE, location & ~(uint64_t)
+                                    (BLOCK_LOCATIONS - 1), BLOCK_LOCATIONS,
+                                    context->buffer) + context->buffer[0])
+BENCHMARK_ACCESS(WriteBlock,
+                 writeBlocktoStore(*STORE, location & ~(uint64_t)
+                                   (BLOCK_LOCATIONS - 1), BLOCK_LOCATIONS,
+                                   context->buffer))
+BENCHMARK_ACCESS(FillBlock,
+                 fillBlockinStore(*STORE, location & ~(uint64_t)
+                                  (BLOCK_LOCATIONS - 1), BLOCK_LOCATIONS,
+                                  location))
+BENCHMARK_ACCESS(CopyBlock,
+                 copyBlockbetweenStores(*STORE, (location ^ (context->mask /
+                                        2 + 1)) & ~(uint64_t)
+                                        (BLOCK_LOCATIONS - 1), *STORE,
+                                        location & ~(uint64_t)
+                                        (BLOCK_LOCATIONS - 1),
+                                        BLOCK_LOCATIONS))
+BENCHMARK_ACCESS(LoadAcquire, loadAcquirefromStore(*STORE, location))
+BENCHMARK_ACCESS(StoreRelease,
+                 storeReleasetoStore(*STORE, location, location))
+BENCHMARK_ACCESS(CompareAndSwap,
+                 compareAndSwapinStore(*STORE, location, &(uint64_t){location},
+                                       location + 1))
+BENCHMARK_ACCESS(FetchAndAdd,
+                 fetchAndOperateinStore(*STORE, location, ATOMIC_ADD, 1,
+                                        NULL))
+BENCHMARK_ACCESS(LegacyInvertEndian,
+                 legacyInvertEndian(location * 0x9e3779b9u,
+                                    context->byteLength))
+BENCHMARK_ACCESS(InvertEndian,
+                 invertEndian(location * 0x9e3779b9u, context->byteLength))
+
+/* vector cases take their sources across half and a quarter of the store
+ * from the destination.*/
+BENCHMARK_ACCESS(AddVectors,
+                 addVectors(*STORE, location, location ^ (context->mask / 2 +
+                            1), location ^ (context->mask / 4 + 1),
+                            VECTOR_ELEMENT_BITS))
+BENCHMARK_ACCESS(CompareVectors,
+                 compareVectors(*STORE, location, location ^
+                                (context->mask / 2 + 1), location ^
+                                (context->mask / 4 + 1), VECTOR_ELEMENT_BITS,
+                                VECTOR_LESS_UNSIGNED))
+BENCHMARK_ACCESS(MergeVectors,
+                 mergeVectors(*STORE, location, location ^ (context->mask /
+                              2 + 1), location ^ (context->mask / 4 + 1),
+                              location ^ 1, VECTOR_ELEMENT_BITS))
+BENCHMARK_ACCESS(SlideVectorUp,
+                 slideVectorUp(*STORE, location, location ^ (context->mask /
+                               2 + 1), VECTOR_ELEMENT_BITS,
+                               VECTOR_SLIDE_ELEMENTS))
+BENCHMARK_ACCESS(SlideVectorDown,
+                 slideVectorDown(*STORE, location, location ^ (context->mask /
+                                 2 + 1), VECTOR_ELEMENT_BITS,
+                                 VECTOR_SLIDE_ELEMENTS))
+BENCHMARK_ACCESS(ExtractFields,
+                 extractFieldsfromStore(*STORE, location, context->fields,
+                                        BENCHMARK_FIELDS,
+                                        (uint64_t*)context->buffer) +
+                 context->buffer[0])
+BENCHMARK_ACCESS(InsertFields,
+                 insertFieldsinStore(*STORE, location, context->fields,
+                                     BENCHMARK_FIELDS,
+                                     (uint64_t[]){location, ~location}))
+
+
+
+/* uint64_t readMultiBitswith(const benchmarkContext *context, uint64_t ops,
+                              bool legacy):
+ * readMultiBitsfromStore, or legacyReadMultiBits, freeing the bits it
+ * returns.
+ */
+static uint64_t readMultiBitswith(const benchmarkContext *context,
+                                  uint64_t ops, bool legacy){
+  uint64_t checksum = 0;
+
+  for (uint64_t op = 0; op < ops; op++){
+    uint64_t location = locationofOp(context, op);
+    bool *bits = legacy ? legacyReadMultiBits(*context->STORE, location, 0,
+                                              context->width) :
+                          readMultiBitsfromStore(*context->STORE, location,
+                                                 0, context->width);
+    checksum += bits[0];
+    free(bits);
+  }
+
+  return checksum;
+}
+
+static uint64_t runLegacyReadMultiBits(const benchmarkContext *context,
+                                       uint64_t ops){
+  return readMultiBitswith(context, ops, true);
+}
+
+static uint64_t runReadMultiBits(const benchmarkContext *context,
+                                 uint64_t ops){
+  return readMultiBitswith(context, ops, false);
+}
+
+
+
+/* uint64_t runRegisters(const benchmarkContext *context, uint64_t ops,
+                         bool writing):
+ * Reads or writes REGISTERS_PER_OP registers of a register file of
+ * BENCHMARK_REGISTERS registers of the width of the case every operation,
+ * the registers picked by the pattern.
+ */
+static uint64_t runRegisters(const benchmarkContext *context, uint64_t ops,
+                             bool writing){
+  registerFile REGISTERFILE = initializeRegisterFile(BENCHMARK_REGISTERS,
+                                                     context->width);
+  uint64_t indices[REGISTERS_PER_OP], values[REGISTERS_PER_OP];
+  uint64_t checksum = 0;
+
+  for (uint64_t op = 0; op < ops; op++){
+    uint64_t location = locationofOp(context, op);
+    for (unsigned index = 0; index < REGISTERS_PER_OP; index++){
+      indices[index] = (location + index * 7) % BENCHMARK_REGISTERS;
+      values[index] = location + index;
+    }
+    if (writing)
+      checksum += writeRegisters(&REGISTERFILE, indices, values,
+                                 REGISTERS_PER_OP);
+    else{
+      checksum += readRegisters(&REGISTERFILE, indices, values,
+                                REGISTERS_PER_OP);
+      checksum += values[0];
+    }
+  }
+  destroyRegisterFile(&REGISTERFILE);
+
+  return checksum;
+}
+
+static uint64_t runReadRegisters(const benchmarkContext *context,
+                                 uint64_t ops){
+  return runRegisters(context, ops, false);
+}
+
+static uint64_t runWriteRegisters(const benchmarkContext *context,
+                                  uint64_t ops){
+  return runRegisters(context, ops, true);
+}
+
+
+
+/* uint64_t runTakeSnapshot(const benchmarkContext *context, uint64_t ops):
+ * Takes a snapshot, then writes a field, saving its page, every operation.
+ */
+static uint64_t runTakeSnapshot(const benchmarkContext *context,
+                                uint64_t ops){
+  store *STORE = context->STORE;
+  uint64_t checksum = 0;
+
+  for (uint64_t op = 0; op < ops; op++){
+    uint64_t location = locationofOp(context, op);
+    checksum += takeStoreSnapshot(STORE);
+    checksum += writeFieldtoStore(*STORE, location, 0, context->width,
+                                  location);
+  }
+  dropStoreSnapshot(STORE);
+
+  return checksum;
+}
+
+
+
+/* uint64_t runRestoreSnapshot(const benchmarkContext *context,
+                               uint64_t ops):
+ * Writes a field, saving its page, then restores the snapshot taken
+ * before the case every operation.
+ */
+static uint64_t runRestoreSnapshot(const benchmarkContext *context,
+                                   uint64_t ops){
+  store *STORE = context->STORE;
+  uint64_t checksum = takeStoreSnapshot(STORE);
+
+  for (uint64_t op = 0; op < ops; op++){
+    uint64_t location = locationofOp(context, op);
+    checksum += writeFieldtoStore(*STORE, location, 0, context->width,
+                                  location);
+    checksum += restoreStoreSnapshot(STORE);
+  }
+  dropStoreSnapshot(STORE);
+
+  return checksum;
+}
+
+
+
+/* uint64_t runTrackDirtyPages(const benchmarkContext *context,
+                               uint64_t ops):
+ * writeFieldtoStore with dirty pages tracked, to set against the case of
+ * writeFieldtoStore.
+ */
+static uint64_t runTrackDirtyPages(const benchmarkContext *context,
+                                   uint64_t ops){
+  store *STORE = context->STORE;
+  uint64_t checksum = trackDirtyPages(STORE);
+
+  for (uint64_t op = 0; op < ops; op++){
+    uint64_t location = locationofOp(context, op);
+    checksum += writeFieldtoStore(*STORE, location, 0, context->width,
+                                  location);
+  }
+  stopTrackingDirtyPages(STORE);
+
+  return checksum;
+}
+
+
+
+/* uint64_t runNextDirtyRange(const benchmarkContext *context,
+                              uint64_t ops):
+ * Writes a field, walks the dirty ranges, then clears them every
+ * operation.
+ */
+static uint64_t runNextDirtyRange(const benchmarkContext *context,
+                                  uint64_t ops){
+  store *STORE = context->STORE;
+  uint64_t checksum = trackDirtyPages(STORE);
+  uint64_t firstLocation, totalLocations;
+
+  for (uint64_t op = 0; op < ops; op++){
+    uint64_t location = locationofOp(context, op);
+    checksum += writeFieldtoStore(*STORE, location, 0, context->width,
+                                  location);
+    for (uint64_t next = 0;
+         nextDirtyRange(*STORE, next, &firstLocation, &totalLocations) == 1;
+         next = firstLocation + totalLocations)
+      checksum += firstLocation + totalLocations;
+    checksum += clearDirtyPages(*STORE);
+  }
+  stopTrackingDirtyPages(STORE);
+
+  return checksum;
+}
+
+
+
+/* uint64_t runDiffStores(const benchmarkContext *context, uint64_t ops):
+ * Writes a field, then diffs the store with a zeroed one of the same
+ * geometry and kind, both tracking dirty pages, up to BLOCK_LOCATIONS
+ * locations, then clears the dirty pages, every operation.
+ */
+static uint64_t runDiffStores(const benchmarkContext *context, uint64_t ops){
+  store *STORE = context->STORE;
+  store other = initializeStoreofKind(STORE->totalLocations,
+                                      STORE->wordSize, STORE->kind);
+  uint64_t locations[BLOCK_LOCATIONS];
+  uint64_t checksum = trackDirtyPages(STORE) + trackDirtyPages(&other);
+
+  for (uint64_t op = 0; op < ops; op++){
+    uint64_t location = locationofOp(context, op);
+    checksum += writeFieldtoStore(*STORE, location, 0, context->width,
+                                  location);
+    checksum += diffStores(*STORE, other, locations, BLOCK_LOCATIONS);
+    checksum += clearDirtyPages(*STORE);
+  }
+  stopTrackingDirtyPages(STORE);
+  destroyStore(&other);
+
+  return checksum;
+}
+
+
+
+/* uint64_t runHashofStore(const benchmarkContext *context, uint64_t ops):
+ * Hashes the whole store from scratch every operation.
+ */
+static uint64_t runHashofStore(const benchmarkContext *context,
+                               uint64_t ops){
+  store copy = *context->STORE;
+  uint64_t checksum = 0;
+
+  copy.hashes = NULL;
+  for (uint64_t op = 0; op < ops; op++){
+    trackStoreHash(&copy);
+    checksum += hashofStore(copy);
+    stopTrackingStoreHash(&copy);
+  }
+
+  return checksum;
+}
+
+
+
+/* uint64_t saveStoretoNull(const benchmarkContext *context, uint64_t ops,
+                            unsigned options):
+ * Saves the whole store to /dev/null every operation.
+ */
+static uint64_t saveStoretoNull(const benchmarkContext *context,
+                                uint64_t ops, unsigned options){
+  int fd = open("/dev/null", O_WRONLY);
+  uint64_t checksum = 0;
+
+  for (uint64_t op = 0; op < ops; op++)
+    checksum += saveStoretoFile(*context->STORE, fd, options);
+  close(fd);
+
+  return checksum;
+}
+
+static uint64_t runSaveStore(const benchmarkContext *context, uint64_t ops){
+  return saveStoretoNull(context, ops, 0);
+}
+
+static uint64_t runSaveCompressedStore(const benchmarkContext *context,
+                                       uint64_t ops){
+  return saveStoretoNull(context, ops, STORE_FILE_COMPRESSED);
+}
+
+
+
+/* uint64_t loadStoresfromFile(const benchmarkContext *context, uint64_t ops,
+                               bool intoStore):
+ * Saves the whole store to a temporary file, then loads it back every
+ * operation, into the store or as a new store of its kind.
+ */
+static uint64_t loadStoresfromFile(const benchmarkContext *context,
+                                   uint64_t ops, bool intoStore){
+  FILE *file = tmpfile();
+  if (file == NULL)
+    return 0;
+  int fd = fileno(file);
+  uint64_t checksum = saveStoretoFile(*context->STORE, fd, 0);
+
+  for (uint64_t op = 0; op < ops; op++){
+    lseek(fd, 0, SEEK_SET);
+    if (intoStore)
+      checksum += loadFileintoStore(*context->STORE, fd);
+    else{
+      store loaded = loadStorefromFile(fd, context->STORE->kind);
+      checksum += loaded.totalLocations;
+      destroyStore(&loaded);
+    }
+  }
+  fclose(file);
+
+  return checksum;
+}
+
+static uint64_t runLoadStore(const benchmarkContext *context, uint64_t ops){
+  return loadStoresfromFile(context, ops, false);
+}
+
+static uint64_t runLoadFileintoStore(const benchmarkContext *context,
+                                     uint64_t ops){
+  return loadStoresfromFile(context, ops, true);
+}
+
+
+
+/* Cases, a legacy* baseline first, the paths replacing it after it. */
+static const benchmarkCase cases[] = {
+  {"readBitfromStore", runReadBit, NEEDS_NOTHING, ONE_BIT},
+  {"readStoreBit", runReadStoreBit, NEEDS_NOTHING, ONE_BIT},
+  {"writeBittoStore", runWriteBit, NEEDS_NOTHING, ONE_BIT},
+  {"writeStoreBit", runWriteStoreBit, NEEDS_NOTHING, ONE_BIT},
+  {"legacyReadMultiBits", runLegacyReadMultiBits, NEEDS_NOTHING,
+   FIELD_BITS},
+  {"readMultiBitsfromStore", runReadMultiBits, NEEDS_NOTHING, FIELD_BITS},
+  {"readMultiBitsintoBuffer", runReadMultiBitsintoBuffer, NEEDS_NOTHING,
+   FIELD_BITS},
+  {"legacyReadNumBits", runLegacyReadNumBits, NEEDS_NOTHING, FIELD_BITS},
+  {"readNumBitsfromStore", runReadNumBits, NEEDS_NOTHING, FIELD_BITS},
+  {"readFieldfromStore", runReadField, NEEDS_NOTHING, FIELD_BITS},
+  {"readStoreField", runReadStoreField, NEEDS_NOTHING, FIELD_BITS},
+  {"writeMultiBitstoStore", runWriteMultiBits, NEEDS_NOTHING, FIELD_BITS},
+  {"legacyWriteNumBits", runLegacyWriteNumBits, NEEDS_NOTHING, FIELD_BITS},
+  {"writeNumBitstoStore", runWriteNumBits, NEEDS_NOTHING, FIELD_BITS},
+  {"writeFieldtoStore", runWriteField, NEEDS_NOTHING, FIELD_BITS},
+  {"writeStoreField", runWriteStoreField, NEEDS_NOTHING, FIELD_BITS},
+  {"legacyReadBytes", runLegacyReadBytes, NEEDS_BYTES, BYTE_BITS},
+  {"readBytesfromStore", runReadBytes, NEEDS_BYTES, BYTE_BITS},
+  {"readLittleEndianBytesfromStore", runReadLittleEndianBytes, NEEDS_BYTES,
+   BYTE_BITS},
+  {"readBigEndianBytesfromStore", runReadBigEndianBytes, NEEDS_BYTES,
+   BYTE_BITS},
+  {"readValuefromStore", runReadValue, NEEDS_BYTES, BYTE_BITS},
+  {"legacyWriteBytes", runLegacyWriteBytes, NEEDS_BYTES, BYTE_BITS},
+  {"writeBytestoStore", runWriteBytes, NEEDS_BYTES, BYTE_BITS},
+  {"writeLittleEndianBytestoStore", runWriteLittleEndianBytes, NEEDS_BYTES,
+   BYTE_BITS},
+  {"writeValuetoStore", runWriteValue, NEEDS_BYTES, BYTE_BITS},
+  {"legacyInvertEndian", runLegacyInvertEndian, NEEDS_BYTES, BYTE_BITS},
+  {"invertEndian", runInvertEndian, NEEDS_BYTES, BYTE_BITS},
+  {"readBlockfromStore", runReadBlock, NEEDS_NOTHING, BLOCK_BITS},
+  {"writeBlocktoStore", runWriteBlock, NEEDS_NOTHING, BLOCK_BITS},
+  {"fillBlockinStore", runFillBlock, NEEDS_NOTHING, BLOCK_BITS},
+  {"copyBlockbetweenStores", runCopyBlock, NEEDS_NOTHING, BLOCK_BITS},
+  {"loadAcquirefromStore", runLoadAcquire, NEEDS_FLAT_WORDS, FIELD_BITS},
+  {"storeReleasetoStore", runStoreRelease, NEEDS_FLAT_WORDS, FIELD_BITS},
+  {"compareAndSwapinStore", runCompareAndSwap, NEEDS_FLAT_WORDS,
+   FIELD_BITS},
+  {"fetchAndOperateinStore add", runFetchAndAdd, NEEDS_FLAT_WORDS,
+   FIELD_BITS},
+  {"addVectors", runAddVectors, NEEDS_VECTOR_WORDS, WORD_BITS},
+  {"compareVectors", runCompareVectors, NEEDS_VECTOR_WORDS, WORD_BITS},
+  {"mergeVectors", runMergeVectors, NEEDS_VECTOR_WORDS, WORD_BITS},
+  {"slideVectorUp", runSlideVectorUp, NEEDS_VECTOR_WORDS, WORD_BITS},
+  {"slideVectorDown", runSlideVectorDown, NEEDS_VECTOR_WORDS, WORD_BITS},
+  {"extractFieldsfromStore", runExtractFields,
+   NEEDS_BYTES | NEEDS_NARROW_WORDS, FIELDS_BITS},
+  {"insertFieldsinStore", runInsertFields, NEEDS_BYTES | NEEDS_NARROW_WORDS,
+   FIELDS_BITS},
+  {"readRegisters", runReadRegisters, NEEDS_PACKED_STORE, REGISTERS_BITS},
+  {"writeRegisters", runWriteRegisters, NEEDS_PACKED_STORE, REGISTERS_BITS},
+  {"takeStoreSnapshot", runTakeSnapshot, NEEDS_NOTHING, FIELD_BITS},
+  {"restoreStoreSnapshot", runRestoreSnapshot, NEEDS_NOTHING, FIELD_BITS},
+  {"trackDirtyPages", runTrackDirtyPages, NEEDS_NOTHING, FIELD_BITS},
+  {"nextDirtyRange", runNextDirtyRange, NEEDS_NOTHING, FIELD_BITS},
+  {"diffStores", runDiffStores, NEEDS_NOTHING, FIELD_BITS},
+  {"hashofStore", runHashofStore, NEEDS_WHOLE_STORE, STORE_BITS},
+  {"saveStoretoFile", runSaveStore, NEEDS_WHOLE_STORE, STORE_BITS},
+  {"saveStoretoFile compressed", runSaveCompressedStore, NEEDS_WHOLE_STORE,
+   STORE_BITS},
+  {"loadStorefromFile", runLoadStore, NEEDS_WHOLE_STORE, STORE_BITS},
+  {"loadFileintoStore", runLoadFileintoStore, NEEDS_WHOLE_STORE, STORE_BITS}
+};
+
+
+
+/* bool caseFits(const benchmarkCase *CASE, const store *STORE):
+ * Returns true if the case can run on the store.
+ */
+static bool caseFits(const benchmarkCase *CASE, const store *STORE){
+  if ((CASE->needs & NEEDS_BYTES) && STORE->wordSize < 8)
+    return false;
+  if ((CASE->needs & NEEDS_FLAT_WORDS) &&
+      (STORE->kind == MATRIX_STORE || STORE->wordSize > 64))
+    return false;
+  if ((CASE->needs & NEEDS_VECTOR_WORDS) &&
+      (STORE->wordSize % VECTOR_ELEMENT_BITS != 0 ||
+       STORE->wordSize > STORE_VECTOR_MAX_BITS))
+    return false;
+  if ((CASE->needs & NEEDS_NARROW_WORDS) && STORE->wordSize > 64)
+    return false;
+  /* register files are PACKED_STOREs of their own, run them once.*/
+  if ((CASE->needs & NEEDS_PACKED_STORE) && STORE->kind != PACKED_STORE)
+    return false;
+  return true;
+}
+
+
+
+/* double bitsperOp(const benchmarkCase *CASE,
+                    const benchmarkContext *context):
+ * Returns bits accessed by one operation of the case.
+ */
+static double bitsperOp(const benchmarkCase *CASE,
+                        const benchmarkContext *context){
+  switch (CASE->bits){
+    case ONE_BIT:
+      return 1;
+    case FIELD_BITS:
+      return context->width;
+    case BYTE_BITS:
+      return 8.0 * context->byteLength;
+    case WORD_BITS:
+      return context->STORE->wordSize;
+    case FIELDS_BITS:
+      return context->fields[0].width + context->fields[1].width;
+    case REGISTERS_BITS:
+      return (double)REGISTERS_PER_OP * context->width;
+    case BLOCK_BITS:
+      return (double)BLOCK_LOCATIONS * context->STORE->wordSize;
+    default:
+      return (double)context->STORE->totalLocations *
+             context->STORE->wordSize;
+  }
+}
+
+
+
+/* void runCase(const benchmarkCase *CASE, benchmarkContext *context,
+                uint64_t ops, bool countingAllocations):
+ * Runs the case once to warm up, then measures it and prints its line.
+ */
+static void runCase(const benchmarkCase *CASE, benchmarkContext *context,
+                    uint64_t ops, bool countingAllocations){
+  const store *STORE = context->STORE;
+
+  CASE->run(context, ops / 16 + 1);
+  resetPeakResident();
+
+  uint64_t allocations = totalAllocations;
+  double start = nowNanoseconds();
+  uint64_t checksum = CASE->run(context, ops);
+  double elapsed = nowNanoseconds() - start;
+  allocations = totalAllocations - allocations;
+
+  printf("%s,%s,%"PRIu64",%"PRIu64",%"PRIu64",%s,%"PRIu64",%.3f,%.3f,%.3f,"
+         "%ld,%016"PRIx64"\n", CASE->name, kindNames[STORE->kind],
+         STORE->wordSize, STORE->totalLocations,
+         (STORE->totalLocations * STORE->wordSize + 7) / 8,
+         patternNames[context->pattern], ops, elapsed / ops,
+         bitsperOp(CASE, context) * ops / 8 / elapsed,
+         countingAllocations ? (double)allocations / ops : -1.0,
+         peakResidentKiB(), checksum);
+  fflush(stdout);
+}
+
+
+
+/* void runStore(const storeKind kind, const uint64_t wordSize,
+                 const uint64_t storeBytes, const uint64_t ops,
+                 const char *filter, bool countingAllocations):
+ * Runs every case fitting a store of about storeBytes bytes of packed
+ * bits, its totalLocations rounded down to a power of two.
+ */
+static void runStore(const storeKind kind, const uint64_t wordSize,
+                     const uint64_t storeBytes, const uint64_t ops,
+                     const char *filter, bool countingAllocations){
+  unsigned locationBits = 63 - __builtin_clzll(storeBytes * 8 / wordSize);
+  uint64_t totalLocations = (uint64_t)1 << locationBits;
+
+  if (kind == MATRIX_STORE && totalLocations > MATRIX_LOCATION_LIMIT)
+    return;
+
+  store STORE = initializeStoreofKind(totalLocations, wordSize, kind);
+  uint64_t bufferBytes = BLOCK_LOCATIONS * wordSize / 8 + 64;
+  uint8_t *buffer = calloc(1, bufferBytes);
+  if (!STORE.set || buffer == NULL){
+    fprintf(stderr, "unable to create %s store of %"PRIu64" locations\n",
+            kindNames[kind], totalLocations);
+    destroyStore(&STORE);
+    free(buffer);
+    return;
+  }
+  /* every page touched, so no case measures first touches.*/
+  fillBlockinStore(STORE, 0, totalLocations, 0x5a5a5a5a5a5a5a5aULL);
+
+  benchmarkContext context = {&STORE, SEQUENTIAL_ACCESS, totalLocations - 1,
+                              locationBits, (wordSize < 64) ? wordSize : 64,
+                              (wordSize / 8 < 8) ? wordSize / 8 : 8, buffer,
+                              {0}, {{0}}};
+  for (unsigned bit = 0; bit < 64; bit++)
+    context.bits[bit] = (bit * 37) & 1;
+  /* a scattered, sign extended field as the B immediate of RISC-V, and a
+   * contiguous one, for words of 8 to 64 bits.*/
+  if (wordSize >= 8 && wordSize <= 64){
+    uint8_t top = wordSize - 1;
+    fieldFragment scattered[] = {{top, top}, {wordSize / 4 - 1, 0},
+                                 {top - 1, wordSize / 2}};
+    fieldFragment contiguous[] = {{wordSize / 2 - 1, wordSize / 4}};
+    compileFieldDescriptor(&context.fields[0], scattered, 3, 1, true);
+    compileFieldDescriptor(&context.fields[1], contiguous, 1, 0, false);
+  }
+
+  for (size_t index = 0; index < sizeof(cases) / sizeof(cases[0]);
+       index++){
+    const benchmarkCase *CASE = &cases[index];
+    if (!caseFits(CASE, &STORE) ||
+        (filter != NULL && strstr(CASE->name, filter) == NULL))
+      continue;
+    if (CASE->needs & NEEDS_WHOLE_STORE){
+      context.pattern = WHOLE_STORE;
+      runCase(CASE, &context, WHOLE_STORE_PASSES, countingAllocations);
+      continue;
+    }
+    for (accessPattern pattern = SEQUENTIAL_ACCESS; pattern <= RANDOM_ACCESS;
+         pattern++){
+      context.pattern = pattern;
+      runCase(CASE, &context, ops, countingAllocations);
+    }
+  }
+
+  destroyStore(&STORE);
+  free(buffer);
+}
+
+
+
+int main(int argc, char *argv[]){
+  uint64_t largestBytes = (uint64_t)256 << 20;
+  uint64_t ops = (uint64_t)1 << 20;
+  const char *filter = NULL;
+
+  if (argc > 1)
+    largestBytes = strtoull(argv[1], NULL, 10) << 20;
+  if (argc > 2)
+    ops = strtoull(argv[2], NULL, 10);
+  if (argc > 3)
+    filter = argv[3];
+  if (largestBytes < MEDIUM_STORE_BYTES || ops == 0){
+    fprintf(stderr, "usage: %s [largest store in MiB, at least 1] "
+            "[operations per case] [case filter]\n", argv[0]);
+    return 1;
+  }
+
+  uint64_t allocations = totalAllocations;
+  free(malloc(1));
+  bool countingAllocations = totalAllocations != allocations;
+
+  const uint64_t storeBytes[] = {SMALL_STORE_BYTES, MEDIUM_STORE_BYTES,
+                                 largestBytes};
+  unsigned totalSizes = (largestBytes > MEDIUM_STORE_BYTES) ? 3 : 2;
+
+  printf("case,kind,wordSize,locations,storeBytes,pattern,operations,"
+         "nsPerOp,gbPerSecond,allocationsPerOp,peakResidentKiB,checksum\n");
+  for (unsigned size = 0; size < totalSizes; size++)
+    for (size_t word = 0; word < sizeof(wordSizes) / sizeof(wordSizes[0]);
+         word++)
+      for (storeKind kind = MATRIX_STORE; kind <= PAGED_STORE; kind++)
+        runStore(kind, wordSizes[word], storeBytes[size], ops, filter,
+                 countingAllocations);
+
+  return 0;
+}
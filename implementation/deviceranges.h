@@ -0,0 +1,84 @@
+#ifndef LIB_STORE_IMPLEMENTATION_DEVICERANGES_H
+#define LIB_STORE_IMPLEMENTATION_DEVICERANGES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+#include "store/storedevice.h"
+
+/* struct deviceRange:
+ * A device attached to totalLocations locations from firstLocation, a
+ * NULL handler leaves accesses of its kind to the store.
+ */
+struct deviceRange{
+  uint64_t firstLocation;
+  uint64_t totalLocations;
+  storeDeviceRead read;
+  storeDeviceWrite write;
+  void *context;
+};
+
+/* struct storeDeviceTable:
+ * Devices of a store, see storedevice.h: ranges sorted by firstLocation,
+ * none overlapping, and a bit per page of 1 << pageShift locations, set
+ * if a range holds any location of the page, bit page % 64 of
+ * pages[page / 64] counted from the least significant bit.
+ */
+struct storeDeviceTable{
+  unsigned pageShift;
+  uint64_t totalPages;
+  uint64_t totalRanges;
+  uint64_t maxRanges;
+  struct deviceRange *ranges;
+  uint64_t pages[];
+};
+
+/* int deviceofAccess(const struct storeDeviceTable *devices,
+                      uint64_t firstLocation, uint64_t lastLocation,
+                      bool writing, const struct deviceRange **device):
+ * Finds the device handling an access of the locations from firstLocation
+ * to lastLocation, a read unless writing, ranges with no handler for it
+ * left out, and sets *device to it, or to NULL if the store handles it.
+ * Returns 0, or -1 if the access runs out of the range of a device.
+ */
+static inline int deviceofAccess(const struct storeDeviceTable *devices,
+                                 uint64_t firstLocation,
+                                 uint64_t lastLocation, bool writing,
+                                 const struct deviceRange **device){
+  *device = NULL;
+
+  bool marked = false;
+  for (uint64_t page = firstLocation >> devices->pageShift;
+       page <= lastLocation >> devices->pageShift && !marked; page++)
+    marked = (devices->pages[page / 64] >> (page % 64)) & 1;
+  if (!marked)
+    return 0;
+
+  /* first range ending after firstLocation.*/
+  uint64_t low = 0, high = devices->totalRanges;
+  while (low < high){
+    uint64_t middle = low + (high - low) / 2;
+    const struct deviceRange *range = &devices->ranges[middle];
+    if (range->firstLocation + range->totalLocations <= firstLocation)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  for (; low < devices->totalRanges &&
+         devices->ranges[low].firstLocation <= lastLocation; low++){
+    const struct deviceRange *range = &devices->ranges[low];
+    if (writing ? range->write == NULL : range->read == NULL)
+      continue;
+    if (range->firstLocation > firstLocation ||
+        lastLocation - range->firstLocation >= range->totalLocations)
+      return -1;
+    *device = range;
+    return 0;
+  }
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef LIB_STORE_IMPLEMENTATION_DIRTYPAGES_H
+#define LIB_STORE_IMPLEMENTATION_DIRTYPAGES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+#include "pagebitmap.h"
+#include "storepages.h"
+
+/* Dirty pages of a store, see storedirty.h: a page bitmap, see
+ * pagebitmap.h, marking every page of STORE_PAGE_BYTES bytes of its packed
+ * bits written since the last clear.
+ */
+struct storeDirtyMap{
+  struct pageBitmap pages;
+};
+
+/* int markPageDirty(struct storeDirtyMap *dirty, uint64_t pageNumber):
+ * Marks the page dirty, unless marked already.
+ * Returns 0, or -1 if unable to allocate its chunk of the bitmap.
+ */
+static inline int markPageDirty(struct storeDirtyMap *dirty,
+                                uint64_t pageNumber){
+  return markPageinBitmap(&dirty->pages, pageNumber);
+}
+
+#endif
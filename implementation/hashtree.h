@@ -0,0 +1,44 @@
+#ifndef LIB_STORE_IMPLEMENTATION_HASHTREE_H
+#define LIB_STORE_IMPLEMENTATION_HASHTREE_H
+
+#include <stdint.h>
+
+#include "pagebitmap.h"
+
+/* Hash tree of a store, see storehash.h. Level 0 holds the hash of every
+ * page of STORE_PAGE_BYTES bytes of packed bits, each level above the hash
+ * of every pair of nodes below, till a single root. Pages marked in the
+ * 'stale' bitmap by the write paths are rehashed, then the nodes above
+ * them, level by level, gathered in 'staleNodes'.
+ * Like a page table, hashes of a level are kept in chunks of up to
+ * HASH_CHUNK_NODES nodes, found through tables of up to HASH_TABLE_CHUNKS
+ * chunks, found through a directory sized for the level. A chunk is only
+ * allocated when a node of it hashes to something else than it would with
+ * every page under it zeroed, zeroHash, or lastZeroHash for the last node
+ * of the level, which may have a single node below it. So a huge sparse
+ * PAGED_STORE pays only for the pages written.
+ */
+#define STORE_HASH_MAX_LEVELS 64
+#define HASH_CHUNK_SHIFT 9
+#define HASH_CHUNK_NODES ((uint64_t)1 << HASH_CHUNK_SHIFT)
+#define HASH_TABLE_SHIFT 9
+#define HASH_TABLE_CHUNKS ((uint64_t)1 << HASH_TABLE_SHIFT)
+
+struct hashLevel{
+  uint64_t totalNodes;
+  uint64_t zeroHash;
+  uint64_t lastZeroHash;
+  uint64_t totalTables;
+  uint64_t ***tables;
+};
+
+struct storeHashTree{
+  unsigned totalLevels;
+  uint64_t zeroPageHash;
+  struct pageBitmap stale;
+  uint64_t staleCapacity;
+  uint64_t *staleNodes;
+  struct hashLevel levels[STORE_HASH_MAX_LEVELS];
+};
+
+#endif
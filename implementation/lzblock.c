@@ -0,0 +1,192 @@
+#include "lzblock.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#define LZ_HASH_BITS 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+/* as in LZ4, no match starts in the last LZ_MATCH_LIMIT bytes and the last
+ * LZ_LAST_LITERALS bytes are always literals.*/
+#define LZ_MATCH_LIMIT 12
+#define LZ_LAST_LITERALS 5
+
+
+
+/* uint32_t hashSequence(const uint8_t *bytes):
+ * Returns index in the hash table of the 4 bytes at 'bytes'.
+ */
+static inline uint32_t hashSequence(const uint8_t *bytes){
+  uint32_t sequence;
+  memcpy(&sequence, bytes, sizeof(sequence));
+  return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+
+
+/* uint8_t *putLength(uint8_t *output, uint32_t length):
+ * Writes the bytes of a length past the 15 of its token, returns the byte
+ * following them.
+ */
+static inline uint8_t *putLength(uint8_t *output, uint32_t length){
+  for (; length >= 255; length -= 255)
+    *output++ = 255;
+  *output++ = (uint8_t)length;
+  return output;
+}
+
+
+
+/* uint32_t emitSequence(uint8_t *destination, uint32_t written,
+                         uint32_t capacity, const uint8_t *literals,
+                         uint32_t totalLiterals, uint32_t offset,
+                         uint32_t matchLength):
+ * Appends a sequence at 'written' bytes of destination, with no match if
+ * matchLength is 0. Returns bytes written after it, or 0 if it doesn't fit
+ * in capacity.
+ */
+static uint32_t emitSequence(uint8_t *destination, uint32_t written,
+                             uint32_t capacity, const uint8_t *literals,
+                             uint32_t totalLiterals, uint32_t offset,
+                             uint32_t matchLength){
+  uint64_t worstBytes = 1 + totalLiterals / 255 + 1 + totalLiterals + 2 +
+                        matchLength / 255 + 1;
+  if (written + worstBytes > capacity)
+    return 0;
+
+  uint8_t *output = destination + written;
+  uint8_t *token = output++;
+  *token = (uint8_t)((totalLiterals < 15 ? totalLiterals : 15) << 4);
+  if (totalLiterals >= 15)
+    output = putLength(output, totalLiterals - 15);
+  memcpy(output, literals, totalLiterals);
+  output += totalLiterals;
+
+  if (matchLength > 0){
+    *output++ = (uint8_t)offset;
+    *output++ = (uint8_t)(offset >> 8);
+    uint32_t length = matchLength - LZ_MIN_MATCH;
+    *token |= (uint8_t)(length < 15 ? length : 15);
+    if (length >= 15)
+      output = putLength(output, length - 15);
+  }
+
+  return (uint32_t)(output - destination);
+}
+
+
+
+/* uint32_t compressLZBlock(const uint8_t *source, uint32_t sourceBytes,
+                            uint8_t *destination, uint32_t capacity):
+ * Compresses sourceBytes of source into destination.
+ * Returns size of the compressed block, or 0 if it doesn't fit in capacity,
+ * so data which doesn't shrink can be kept as it is.
+ */
+uint32_t compressLZBlock(const uint8_t *source, uint32_t sourceBytes,
+                         uint8_t *destination, uint32_t capacity){
+  uint32_t table[1 << LZ_HASH_BITS] = {0};
+  uint32_t anchor = 0;
+  uint32_t position = 0;
+  uint32_t written = 0;
+
+  if (sourceBytes > LZ_MATCH_LIMIT){
+    uint32_t matchStartLimit = sourceBytes - LZ_MATCH_LIMIT;
+    uint32_t matchEndLimit = sourceBytes - LZ_LAST_LITERALS;
+
+    while (position < matchStartLimit){
+      uint32_t hash = hashSequence(source + position);
+      uint32_t candidate = table[hash];
+      table[hash] = position;
+
+      if (candidate >= position || position - candidate > LZ_MAX_OFFSET ||
+          memcmp(source + candidate, source + position, LZ_MIN_MATCH)){
+        /* skip faster through data which doesn't match, as LZ4 does.*/
+        position += 1 + ((position - anchor) >> 6);
+        continue;
+      }
+
+      uint32_t length = LZ_MIN_MATCH;
+      while (position + length < matchEndLimit &&
+             source[candidate + length] == source[position + length])
+        length++;
+
+      written = emitSequence(destination, written, capacity,
+                             source + anchor, position - anchor,
+                             position - candidate, length);
+      if (written == 0)
+        return 0;
+      position += length;
+      anchor = position;
+    }
+  }
+
+  written = emitSequence(destination, written, capacity, source + anchor,
+                         sourceBytes - anchor, 0, 0);
+
+  return written;
+}
+
+
+
+/* int64_t decompressLZBlock(const uint8_t *source, uint32_t sourceBytes,
+                             uint8_t *destination, uint32_t capacity):
+ * Decompresses a block made by compressLZBlock into destination, checking
+ * every length and offset against the block and capacity.
+ * Returns number of bytes decompressed, or -1 if the block is corrupt or
+ * doesn't fit in capacity.
+ */
+int64_t decompressLZBlock(const uint8_t *source, uint32_t sourceBytes,
+                          uint8_t *destination, uint32_t capacity){
+  uint32_t input = 0;
+  uint32_t output = 0;
+
+  while (input < sourceBytes){
+    uint8_t token = source[input++];
+
+    uint64_t totalLiterals = token >> 4;
+    if (totalLiterals == 15){
+      uint8_t extra;
+      do{
+        if (input >= sourceBytes)
+          return -1;
+        extra = source[input++];
+        totalLiterals += extra;
+      }while (extra == 255);
+    }
+    if (totalLiterals > sourceBytes - input ||
+        totalLiterals > capacity - output)
+      return -1;
+    memcpy(destination + output, source + input, totalLiterals);
+    input += totalLiterals;
+    output += totalLiterals;
+
+    if (input == sourceBytes)
+      break;
+
+    if (sourceBytes - input < 2)
+      return -1;
+    uint32_t offset = source[input] | (uint32_t)source[input + 1] << 8;
+    input += 2;
+    if (offset == 0 || offset > output)
+      return -1;
+
+    uint64_t matchLength = (token & 15) + LZ_MIN_MATCH;
+    if ((token & 15) == 15){
+      uint8_t extra;
+      do{
+        if (input >= sourceBytes)
+          return -1;
+        extra = source[input++];
+        matchLength += extra;
+      }while (extra == 255);
+    }
+    if (matchLength > capacity - output)
+      return -1;
+    /* matches may overlap their own output, copy byte by byte.*/
+    for (uint64_t index = 0; index < matchLength; index++)
+      destination[output + index] = destination[output - offset + index];
+    output += matchLength;
+  }
+
+  return output;
+}
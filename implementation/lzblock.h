@@ -0,0 +1,19 @@
+#ifndef LIB_STORE_IMPLEMENTATION_LZBLOCK_H
+#define LIB_STORE_IMPLEMENTATION_LZBLOCK_H
+
+#include <stdint.h>
+
+/* Bundled LZ77 codec of independent blocks, in the block format of LZ4:
+ * sequences of a token (literal length in its high 4 bits, match length
+ * minus 4 in its low 4 bits, 15 meaning more length bytes follow, added
+ * till one isn't 255), the literals, and a 2 byte little endian offset of
+ * the match back in the output, the last sequence having literals only.
+ * Matches are found through a single hash table of 4 byte sequences,
+ * trading ratio for speed.
+ */
+uint32_t compressLZBlock(const uint8_t *source, uint32_t sourceBytes,
+                         uint8_t *destination, uint32_t capacity);
+int64_t decompressLZBlock(const uint8_t *source, uint32_t sourceBytes,
+                          uint8_t *destination, uint32_t capacity);
+
+#endif
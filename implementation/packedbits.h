@@ -0,0 +1,311 @@
+#ifndef LIB_STORE_IMPLEMENTATION_PACKEDBITS_H
+#define LIB_STORE_IMPLEMENTATION_PACKEDBITS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "store/store.h"
+
+/* Helpers shared by the implementation files to move bit fields in and out
+ * of the packed layout of PACKED_STORE, where bits follow each other from
+ * the most significant bit of each byte. A field is addressed by a pointer
+ * to the byte holding its first bit, the offset of that bit in the byte
+ * (0 to 7) and its width (1 to 64); first bit of the field is its most
+ * significant bit, same as readNumBitsfromStore.
+ * 'availableBytes' is the number of bytes that can be touched from 'bytes',
+ * whole 8 byte loads are used only when that many bytes are available.
+ */
+
+/* uint64_t loadBigEndian64(const uint8_t *bytes):
+ * Returns 8 bytes from 'bytes' as a number, first byte most significant.
+ */
+static inline uint64_t loadBigEndian64(const uint8_t *bytes){
+  uint64_t value;
+  memcpy(&value, bytes, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  value = __builtin_bswap64(value);
+#endif
+  return value;
+}
+
+/* void storeBigEndian64(uint8_t *bytes, uint64_t value):
+ * Stores value in 8 bytes from 'bytes', most significant byte first.
+ */
+static inline void storeBigEndian64(uint8_t *bytes, uint64_t value){
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  value = __builtin_bswap64(value);
+#endif
+  memcpy(bytes, &value, sizeof(value));
+}
+
+/* uint64_t loadBigEndianBytes(const uint8_t *bytes, unsigned byteLength):
+ * Returns byteLength (1 to 8) bytes from 'bytes' as a number, first byte
+ * most significant. Lengths of 1, 2, 4 and 8 are single loads.
+ */
+static inline uint64_t loadBigEndianBytes(const uint8_t *bytes,
+                                          unsigned byteLength){
+  uint16_t value16;
+  uint32_t value32;
+
+  switch (byteLength){
+    case 1:
+      return bytes[0];
+    case 2:
+      memcpy(&value16, bytes, sizeof(value16));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      value16 = __builtin_bswap16(value16);
+#endif
+      return value16;
+    case 4:
+      memcpy(&value32, bytes, sizeof(value32));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      value32 = __builtin_bswap32(value32);
+#endif
+      return value32;
+    case 8:
+      return loadBigEndian64(bytes);
+  }
+
+  uint64_t value = 0;
+  for (unsigned index = 0; index < byteLength; index++)
+    value = (value << 8) | bytes[index];
+  return value;
+}
+
+/* void storeBigEndianBytes(uint8_t *bytes, unsigned byteLength,
+                            uint64_t value):
+ * Stores lowest byteLength (1 to 8) bytes of value from 'bytes', most
+ * significant byte first. Lengths of 1, 2, 4 and 8 are single stores.
+ */
+static inline void storeBigEndianBytes(uint8_t *bytes, unsigned byteLength,
+                                       uint64_t value){
+  uint16_t value16 = value;
+  uint32_t value32 = value;
+
+  switch (byteLength){
+    case 1:
+      bytes[0] = value;
+      return;
+    case 2:
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      value16 = __builtin_bswap16(value16);
+#endif
+      memcpy(bytes, &value16, sizeof(value16));
+      return;
+    case 4:
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      value32 = __builtin_bswap32(value32);
+#endif
+      memcpy(bytes, &value32, sizeof(value32));
+      return;
+    case 8:
+      storeBigEndian64(bytes, value);
+      return;
+  }
+
+  for (unsigned index = byteLength; index-- > 0; value >>= 8)
+    bytes[index] = value;
+}
+
+/* uint64_t widthMask(unsigned width):
+ * Returns number with lowest 'width' bits set, width from 1 to 64.
+ */
+static inline uint64_t widthMask(unsigned width){
+  return ~(uint64_t)0 >> (64 - width);
+}
+
+/* uint64_t readPackedBits(const uint8_t *bytes, uint64_t availableBytes,
+                           unsigned bitOffset, unsigned width):
+ * Returns the field of 'width' bits starting at bit 'bitOffset' of 'bytes'.
+ */
+static inline uint64_t readPackedBits(const uint8_t *bytes,
+                                      uint64_t availableBytes,
+                                      unsigned bitOffset, unsigned width){
+  unsigned endBit = bitOffset + width;
+
+  if (availableBytes >= 9 || (availableBytes >= 8 && endBit <= 64)){
+    uint64_t value = loadBigEndian64(bytes) << bitOffset;
+    if (endBit > 64)
+      value |= bytes[8] >> (8 - bitOffset);
+    return value >> (64 - width);
+  }
+
+  uint64_t value = 0;
+  for (unsigned index = 0; index * 8 < endBit; index++){
+    unsigned low = (index * 8 > bitOffset) ? index * 8 : bitOffset;
+    unsigned high = (index * 8 + 8 < endBit) ? index * 8 + 8 : endBit;
+    unsigned chunk = (bytes[index] >> (index * 8 + 8 - high)) &
+                     ((1u << (high - low)) - 1);
+    value = (value << (high - low)) | chunk;
+  }
+
+  return value;
+}
+
+/* void writePackedBits(uint8_t *bytes, uint64_t availableBytes,
+                        unsigned bitOffset, unsigned width, uint64_t value):
+ * Writes lowest 'width' bits of value as the field of 'width' bits starting
+ * at bit 'bitOffset' of 'bytes', leaving the bits around it untouched.
+ */
+static inline void writePackedBits(uint8_t *bytes, uint64_t availableBytes,
+                                   unsigned bitOffset, unsigned width,
+                                   uint64_t value){
+  unsigned endBit = bitOffset + width;
+  value &= widthMask(width);
+
+  if (availableBytes >= 8 && endBit <= 64){
+    uint64_t mask = widthMask(width) << (64 - endBit);
+    uint64_t word = loadBigEndian64(bytes);
+    word = (word & ~mask) | (value << (64 - endBit));
+    storeBigEndian64(bytes, word);
+    return;
+  }
+
+  for (unsigned index = 0; index * 8 < endBit; index++){
+    unsigned low = (index * 8 > bitOffset) ? index * 8 : bitOffset;
+    unsigned high = (index * 8 + 8 < endBit) ? index * 8 + 8 : endBit;
+    unsigned shift = index * 8 + 8 - high;
+    uint8_t mask = ((1u << (high - low)) - 1) << shift;
+    uint8_t chunk = (value >> (endBit - high)) << shift;
+    bytes[index] = (bytes[index] & ~mask) | (chunk & mask);
+  }
+}
+
+/* uint64_t swapBigEndian64(uint64_t value):
+ * Converts between a number and its big endian byte order in memory,
+ * both ways, a byte swap on little endian hosts.
+ */
+static inline uint64_t swapBigEndian64(uint64_t value){
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  value = __builtin_bswap64(value);
+#endif
+  return value;
+}
+
+/* uint64_t atomicReadPackedBits(const uint8_t *unit, unsigned bitOffset,
+                                 unsigned width):
+ * Same as readPackedBits for a field lying inside the 8 bytes of an 8 byte
+ * aligned 'unit', read with a single atomic load.
+ */
+static inline uint64_t atomicReadPackedBits(const uint8_t *unit,
+                                            unsigned bitOffset,
+                                            unsigned width){
+  uint64_t word = swapBigEndian64(__atomic_load_n((const uint64_t*)unit,
+                                                  __ATOMIC_RELAXED));
+  return (word << bitOffset) >> (64 - width);
+}
+
+/* void atomicWritePackedBits(uint8_t *unit, unsigned bitOffset,
+                              unsigned width, uint64_t value):
+ * Same as writePackedBits for a field lying inside the 8 bytes of an 8
+ * byte aligned 'unit', with a compare and swap loop so bits of the unit
+ * outside the field written by other threads meanwhile are kept.
+ */
+static inline void atomicWritePackedBits(uint8_t *unit, unsigned bitOffset,
+                                         unsigned width, uint64_t value){
+  uint64_t *word = (uint64_t*)unit;
+  unsigned shift = 64 - bitOffset - width;
+  uint64_t mask = swapBigEndian64(widthMask(width) << shift);
+  uint64_t bits = swapBigEndian64((value & widthMask(width)) << shift);
+
+  if (width == 64){
+    __atomic_store_n(word, bits, __ATOMIC_RELAXED);
+    return;
+  }
+
+  uint64_t old = __atomic_load_n(word, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(word, &old, (old & ~mask) | bits, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+/* uint64_t readFlatBits(const uint8_t *bytes, uint64_t totalBytes,
+                         uint64_t bit, unsigned width):
+ * Returns the field of 'width' bits starting at bit 'bit' of the packed
+ * bits held in the totalBytes bytes of 'bytes'. Byte aligned fields of 8,
+ * 16, 32 or 64 bits are single loads.
+ */
+static inline uint64_t readFlatBits(const uint8_t *bytes, uint64_t totalBytes,
+                                    uint64_t bit, unsigned width){
+  if (bit % 8 == 0 && width % 8 == 0 && (width & (width - 1)) == 0)
+    return loadBigEndianBytes(bytes + bit / 8, width / 8);
+
+  return readPackedBits(bytes + bit / 8, totalBytes - bit / 8, bit % 8,
+                        width);
+}
+
+/* void writeFlatBits(uint8_t *bytes, uint64_t totalBytes, uint64_t bit,
+                      unsigned width, uint64_t value):
+ * Same as readFlatBits, but writes lowest 'width' bits of value as the
+ * field.
+ */
+static inline void writeFlatBits(uint8_t *bytes, uint64_t totalBytes,
+                                 uint64_t bit, unsigned width,
+                                 uint64_t value){
+  if (bit % 8 == 0 && width % 8 == 0 && (width & (width - 1)) == 0){
+    storeBigEndianBytes(bytes + bit / 8, width / 8, value);
+    return;
+  }
+
+  writePackedBits(bytes + bit / 8, totalBytes - bit / 8, bit % 8, width,
+                  value);
+}
+
+/* uint64_t packedBytesforGeometry(uint64_t totalLocations,
+                                   uint64_t wordSize):
+ * Returns number of bytes of the single allocation holding the packed bits
+ * of a store of that geometry, whole uint64_t words as allocated by
+ * createPackedWords, or mapped for a MAPPED_STORE.
+ */
+static inline uint64_t packedBytesforGeometry(uint64_t totalLocations,
+                                              uint64_t wordSize){
+  uint64_t totalWords = (totalLocations * wordSize + 63) / 64;
+  return (totalWords ? totalWords : 1) * sizeof(uint64_t);
+}
+
+/* uint64_t packedBytesofStore(const store *STORE):
+ * Returns packedBytesforGeometry of the store.
+ */
+static inline uint64_t packedBytesofStore(const store *STORE){
+  return packedBytesforGeometry(STORE->totalLocations, STORE->wordSize);
+}
+
+/* bool storeWatchesWrites(const store *STORE):
+ * Returns true if pages written in the store have to be noted, for its
+ * snapshot, dirty pages or hash, so its bytes can't be written in place
+ * without going through storeBytesforWrite or writeStoreBits.
+ */
+static inline bool storeWatchesWrites(const store *STORE){
+  return STORE->snapshot != NULL || STORE->dirty != NULL ||
+         STORE->hashes != NULL;
+}
+
+/* bool storeTracesAccesses(const store *STORE):
+ * Returns true if accesses of the store have to be recorded, so they must
+ * all go through readStoreBits and writeStoreBits, neither in place nor
+ * through storeBytesforRead and storeBytesforWrite.
+ */
+static inline bool storeTracesAccesses(const store *STORE){
+  return STORE->traced;
+}
+
+/* Access to the packed bits of every kind but MATRIX_STORE alike,
+ * readStoreBits and writeStoreBits work on every kind, defined in store.c.
+ */
+const uint8_t *storeBytesforRead(const store *STORE, uint64_t byteIndex,
+                                 uint64_t *availableBytes);
+uint8_t *storeBytesforWrite(const store *STORE, uint64_t byteIndex,
+                            uint64_t *availableBytes);
+uint64_t readStoreBits(const store *STORE, uint64_t bit, unsigned width);
+int writeStoreBits(const store *STORE, uint64_t bit, unsigned width,
+                   uint64_t value);
+
+/* Defined in storemap.c. */
+void unmapStore(store *STORE);
+
+/* Defined in storetrace.c. */
+void recordStoreAccess(const store *STORE, uint64_t bit, unsigned width,
+                       uint64_t value, bool writing);
+
+#endif
@@ -0,0 +1,300 @@
+#include "pagebitmap.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "store/storeerror.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+#define WORDS_PER_SUMMARY 64
+
+
+
+/* int createPageBitmap(struct pageBitmap *bitmap, uint64_t totalPages):
+ * Sets up bitmap for totalPages pages, none marked, allocating only its
+ * directory.
+ * Returns 0, or -1 if unable to allocate the directory.
+ */
+int createPageBitmap(struct pageBitmap *bitmap, uint64_t totalPages){
+  uint64_t totalTables = totalPages ? BITMAP_TABLE(totalPages - 1) + 1 : 1;
+
+  *bitmap = (struct pageBitmap){0};
+  bitmap->tables = calloc(totalTables, sizeof(struct pageBitmapTable*));
+  bitmap->marked = calloc((totalTables + 63) / 64, sizeof(uint64_t));
+  if (bitmap->tables == NULL || bitmap->marked == NULL){
+    destroyPageBitmap(bitmap);
+    return -1;
+  }
+
+  bitmap->totalPages = totalPages;
+  bitmap->totalTables = totalTables;
+
+  return 0;
+}
+
+
+
+/* void destroyPageBitmap(struct pageBitmap *bitmap):
+ * Frees every chunk, table and the directory of the bitmap.
+ */
+void destroyPageBitmap(struct pageBitmap *bitmap){
+  if (bitmap->tables != NULL)
+    for (uint64_t tableNumber = 0; tableNumber < bitmap->totalTables;
+         tableNumber++){
+      struct pageBitmapTable *table = bitmap->tables[tableNumber];
+      if (table == NULL)
+        continue;
+      for (uint64_t chunk = 0; chunk < BITMAP_TABLE_CHUNKS; chunk++)
+        free(table->chunks[chunk]);
+      free(table);
+    }
+
+  free(bitmap->tables);
+  free(bitmap->marked);
+  *bitmap = (struct pageBitmap){0};
+}
+
+
+
+/* void setBit(uint64_t *word, unsigned bit):
+ * Sets the bit of word with an atomic or, unless set already.
+ */
+static inline void setBit(uint64_t *word, unsigned bit){
+  uint64_t mask = (uint64_t)1 << bit;
+  if (!(__atomic_load_n(word, __ATOMIC_RELAXED) & mask))
+    __atomic_fetch_or(word, mask, __ATOMIC_RELAXED);
+}
+
+
+
+/* unsigned takeLowestBit(uint64_t *word):
+ * Clears the lowest bit set in word, not 0, and returns its index.
+ */
+static inline unsigned takeLowestBit(uint64_t *word){
+  unsigned bit = __builtin_ctzll(*word);
+  *word &= *word - 1;
+  return bit;
+}
+
+
+
+/* struct pageBitmapTable *claimTable(struct pageBitmap *bitmap,
+                                      uint64_t tableNumber):
+ * Returns the table, allocating it zeroed and publishing it with compare
+ * and swap if it isn't yet, freeing it if another thread did first.
+ * Returns NULL if unable to allocate.
+ */
+static struct pageBitmapTable *claimTable(struct pageBitmap *bitmap,
+                                          uint64_t tableNumber){
+  struct pageBitmapTable **entry = &bitmap->tables[tableNumber];
+  struct pageBitmapTable *current = __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+  if (current != NULL)
+    return current;
+
+  struct pageBitmapTable *fresh = calloc(1, sizeof(struct pageBitmapTable));
+  if (fresh == NULL)
+    return NULL;
+  if (__atomic_compare_exchange_n(entry, &current, fresh, false,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    return fresh;
+
+  free(fresh);
+  return current;
+}
+
+
+
+/* struct pageBitmapChunk *claimChunk(struct pageBitmapTable *table,
+                                      uint64_t chunkNumber):
+ * Same as claimTable, for a chunk of the table.
+ */
+static struct pageBitmapChunk *claimChunk(struct pageBitmapTable *table,
+                                          uint64_t chunkNumber){
+  struct pageBitmapChunk **entry = &table->chunks[chunkNumber];
+  struct pageBitmapChunk *current = __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+  if (current != NULL)
+    return current;
+
+  struct pageBitmapChunk *fresh = calloc(1, sizeof(struct pageBitmapChunk));
+  if (fresh == NULL)
+    return NULL;
+  if (__atomic_compare_exchange_n(entry, &current, fresh, false,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    return fresh;
+
+  free(fresh);
+  return current;
+}
+
+
+
+/* int markPageSlowly(struct pageBitmap *bitmap, uint64_t pageNumber):
+ * Slow path of markPageinBitmap: allocates the table and chunk of the page
+ * if needed, marks the page, then the summaries leading to it.
+ * Returns 0, or -1 if unable to allocate.
+ */
+int markPageSlowly(struct pageBitmap *bitmap, uint64_t pageNumber){
+  uint64_t tableNumber = BITMAP_TABLE(pageNumber);
+  uint64_t chunkNumber = BITMAP_CHUNK(pageNumber);
+
+  struct pageBitmapTable *table = claimTable(bitmap, tableNumber);
+  struct pageBitmapChunk *chunk = (table == NULL) ? NULL :
+                                  claimChunk(table, chunkNumber);
+  if (chunk == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("markPageSlowly",
+                                   "unable to allocate bitmap of pages",
+                                   "-1"));
+    return -1;
+  }
+
+  setBit(&chunk->bits[BITMAP_WORD(pageNumber)], pageNumber % 64);
+  setBit(&chunk->summary, BITMAP_WORD(pageNumber));
+  setBit(&table->marked[chunkNumber / 64], chunkNumber % 64);
+  setBit(&table->summary, chunkNumber / 64);
+  setBit(&bitmap->marked[tableNumber / 64], tableNumber % 64);
+
+  return 0;
+}
+
+
+
+/* void clearPageBitmap(struct pageBitmap *bitmap):
+ * Unmarks every page, following the summaries to the words marked. Chunks
+ * and tables are kept for the next marks.
+ */
+void clearPageBitmap(struct pageBitmap *bitmap){
+  for (uint64_t word = 0; word < (bitmap->totalTables + 63) / 64; word++){
+    uint64_t tables = bitmap->marked[word];
+    bitmap->marked[word] = 0;
+    while (tables != 0){
+      struct pageBitmapTable *table = bitmap->tables[word * 64 +
+                                                     takeLowestBit(&tables)];
+      uint64_t markedWords = table->summary;
+      table->summary = 0;
+      while (markedWords != 0){
+        unsigned markedWord = takeLowestBit(&markedWords);
+        uint64_t chunks = table->marked[markedWord];
+        table->marked[markedWord] = 0;
+        while (chunks != 0){
+          struct pageBitmapChunk *chunk = table->chunks[markedWord * 64 +
+                                                        takeLowestBit(&chunks)];
+          uint64_t bitsWords = chunk->summary;
+          chunk->summary = 0;
+          while (bitsWords != 0)
+            chunk->bits[takeLowestBit(&bitsWords)] = 0;
+        }
+      }
+    }
+  }
+}
+
+
+
+/* uint64_t nextSummarisedBit(const uint64_t words[], uint64_t summary,
+                              uint64_t bit):
+ * Returns the first bit from 'bit' on set in the WORDS_PER_SUMMARY words,
+ * searching only words whose bit is set in summary, or
+ * 64 * WORDS_PER_SUMMARY if there is none.
+ */
+static uint64_t nextSummarisedBit(const uint64_t words[], uint64_t summary,
+                                  uint64_t bit){
+  uint64_t index = bit / 64;
+  uint64_t word = words[index] & (~(uint64_t)0 << (bit % 64));
+  if (word != 0)
+    return index * 64 + __builtin_ctzll(word);
+
+  summary &= (index + 1 < WORDS_PER_SUMMARY) ?
+             ~(uint64_t)0 << (index + 1) : 0;
+  while (summary != 0){
+    index = takeLowestBit(&summary);
+    if (words[index] != 0)
+      return index * 64 + __builtin_ctzll(words[index]);
+  }
+
+  return 64 * WORDS_PER_SUMMARY;
+}
+
+
+
+/* uint64_t nextMarkedPage(const struct pageBitmap *bitmap,
+                           uint64_t pageNumber):
+ * Returns the first page from pageNumber on marked, or totalPages if there
+ * is none.
+ */
+uint64_t nextMarkedPage(const struct pageBitmap *bitmap,
+                        uint64_t pageNumber){
+  while (pageNumber < bitmap->totalPages){
+    uint64_t tableNumber = BITMAP_TABLE(pageNumber);
+    uint64_t tables = bitmap->marked[tableNumber / 64] &
+                      (~(uint64_t)0 << (tableNumber % 64));
+    if (tables == 0){
+      pageNumber = (tableNumber / 64 + 1) * 64 <<
+                   (BITMAP_CHUNK_SHIFT + BITMAP_TABLE_SHIFT);
+      continue;
+    }
+
+    uint64_t markedTable = tableNumber / 64 * 64 + __builtin_ctzll(tables);
+    uint64_t tableStart = markedTable << (BITMAP_CHUNK_SHIFT +
+                                          BITMAP_TABLE_SHIFT);
+    if (markedTable != tableNumber)
+      pageNumber = tableStart;
+
+    const struct pageBitmapTable *table = bitmap->tables[markedTable];
+    uint64_t chunkNumber = nextSummarisedBit(table->marked, table->summary,
+                                             BITMAP_CHUNK(pageNumber));
+    if (chunkNumber == BITMAP_TABLE_CHUNKS){
+      pageNumber = tableStart + (BITMAP_TABLE_CHUNKS << BITMAP_CHUNK_SHIFT);
+      continue;
+    }
+
+    uint64_t chunkStart = tableStart + (chunkNumber << BITMAP_CHUNK_SHIFT);
+    if (chunkStart > pageNumber)
+      pageNumber = chunkStart;
+
+    const struct pageBitmapChunk *chunk = table->chunks[chunkNumber];
+    uint64_t page = nextSummarisedBit(chunk->bits, chunk->summary,
+                                      pageNumber - chunkStart);
+    if (page < BITMAP_CHUNK_PAGES)
+      return chunkStart + page;
+    pageNumber = chunkStart + BITMAP_CHUNK_PAGES;
+  }
+
+  return bitmap->totalPages;
+}
+
+
+
+/* uint64_t nextUnmarkedPage(const struct pageBitmap *bitmap,
+                             uint64_t pageNumber):
+ * Returns the first page from pageNumber on not marked, or totalPages if
+ * there is none. Walks the run of marked pages from pageNumber.
+ */
+uint64_t nextUnmarkedPage(const struct pageBitmap *bitmap,
+                          uint64_t pageNumber){
+  while (pageNumber < bitmap->totalPages){
+    const struct pageBitmapTable *table = bitmap->tables[BITMAP_TABLE(
+                                                           pageNumber)];
+    if (table == NULL)
+      return pageNumber;
+    const struct pageBitmapChunk *chunk = table->chunks[BITMAP_CHUNK(
+                                                          pageNumber)];
+    if (chunk == NULL)
+      return pageNumber;
+
+    uint64_t clean = ~chunk->bits[BITMAP_WORD(pageNumber)] &
+                     (~(uint64_t)0 << (pageNumber % 64));
+    if (clean != 0){
+      pageNumber = pageNumber / 64 * 64 + __builtin_ctzll(clean);
+      return (pageNumber < bitmap->totalPages) ? pageNumber :
+                                                 bitmap->totalPages;
+    }
+    pageNumber = (pageNumber / 64 + 1) * 64;
+  }
+
+  return bitmap->totalPages;
+}
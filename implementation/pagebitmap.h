@@ -0,0 +1,87 @@
+#ifndef LIB_STORE_IMPLEMENTATION_PAGEBITMAP_H
+#define LIB_STORE_IMPLEMENTATION_PAGEBITMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bitmap of the pages of STORE_PAGE_BYTES bytes of a store, e.g. its dirty
+ * pages. Like a page table, bits are kept in chunks of BITMAP_CHUNK_PAGES
+ * pages, found through tables of BITMAP_TABLE_CHUNKS chunks, found through
+ * a directory sized for the store; chunks and tables are allocated on the
+ * first page marked under them, so sparse PAGED_STOREs pay only for pages
+ * written.
+ * Each level keeps a summary: bit i of the summary of a chunk is set if
+ * word i of its bits may hold a marked page, a table sets a bit of
+ * 'marked' for each chunk with a summary set and a bit of its summary for
+ * each word of 'marked' set, and the directory sets a bit of 'marked' for
+ * each table with a summary set. Clearing and finding marked pages follow
+ * the summaries, so they cost in proportion to the pages marked, not to
+ * the store. Pages are marked with atomic ors and allocations published
+ * with compare and swap, so concurrent stores can mark them too, but
+ * clearing and finding must not run along with marking.
+ */
+#define BITMAP_CHUNK_SHIFT 12
+#define BITMAP_CHUNK_PAGES ((uint64_t)1 << BITMAP_CHUNK_SHIFT)
+#define BITMAP_TABLE_SHIFT 12
+#define BITMAP_TABLE_CHUNKS ((uint64_t)1 << BITMAP_TABLE_SHIFT)
+
+#define BITMAP_WORD(pageNumber) (((pageNumber) >> 6) &\
+                                 (BITMAP_CHUNK_PAGES / 64 - 1))
+#define BITMAP_CHUNK(pageNumber) (((pageNumber) >> BITMAP_CHUNK_SHIFT) &\
+                                  (BITMAP_TABLE_CHUNKS - 1))
+#define BITMAP_TABLE(pageNumber) ((pageNumber) >> (BITMAP_CHUNK_SHIFT +\
+                                                   BITMAP_TABLE_SHIFT))
+
+struct pageBitmapChunk{
+  uint64_t summary;
+  uint64_t bits[BITMAP_CHUNK_PAGES / 64];
+};
+
+struct pageBitmapTable{
+  uint64_t summary;
+  uint64_t marked[BITMAP_TABLE_CHUNKS / 64];
+  struct pageBitmapChunk *chunks[BITMAP_TABLE_CHUNKS];
+};
+
+struct pageBitmap{
+  uint64_t totalPages;
+  uint64_t totalTables;
+  uint64_t *marked;
+  struct pageBitmapTable **tables;
+};
+
+int createPageBitmap(struct pageBitmap *bitmap, uint64_t totalPages);
+void destroyPageBitmap(struct pageBitmap *bitmap);
+int markPageSlowly(struct pageBitmap *bitmap, uint64_t pageNumber);
+void clearPageBitmap(struct pageBitmap *bitmap);
+uint64_t nextMarkedPage(const struct pageBitmap *bitmap,
+                        uint64_t pageNumber);
+uint64_t nextUnmarkedPage(const struct pageBitmap *bitmap,
+                          uint64_t pageNumber);
+
+/* int markPageinBitmap(struct pageBitmap *bitmap, uint64_t pageNumber):
+ * Marks the page, unless marked already, allocating its chunk if needed.
+ * Returns 0, or -1 if unable to allocate.
+ */
+static inline int markPageinBitmap(struct pageBitmap *bitmap,
+                                   uint64_t pageNumber){
+  const struct pageBitmapTable *table = __atomic_load_n(
+                                          &bitmap->tables[BITMAP_TABLE(
+                                                            pageNumber)],
+                                          __ATOMIC_ACQUIRE);
+  if (table != NULL){
+    const struct pageBitmapChunk *chunk = __atomic_load_n(
+                                            &table->chunks[BITMAP_CHUNK(
+                                                             pageNumber)],
+                                            __ATOMIC_ACQUIRE);
+    if (chunk != NULL &&
+        ((__atomic_load_n(&chunk->bits[BITMAP_WORD(pageNumber)],
+                          __ATOMIC_RELAXED) >> (pageNumber % 64)) & 1))
+      return 0;
+  }
+
+  return markPageSlowly(bitmap, pageNumber);
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef LIB_STORE_IMPLEMENTATION_PAGEWRITES_H
+#define LIB_STORE_IMPLEMENTATION_PAGEWRITES_H
+
+#include <stdint.h>
+
+#include "store/store.h"
+#include "dirtypages.h"
+#include "hashtree.h"
+#include "snapshotpages.h"
+
+/* int markPageChanged(const store *STORE, uint64_t pageNumber):
+ * Marks the page dirty and its hash stale, for those the store tracks.
+ * Returns 0, or -1 if unable to allocate the chunk of the dirty or stale
+ * bitmap holding the page.
+ */
+static inline int markPageChanged(const store *STORE, uint64_t pageNumber){
+  if (STORE->dirty != NULL && markPageDirty(STORE->dirty, pageNumber))
+    return -1;
+  if (STORE->hashes != NULL &&
+      markPageinBitmap(&STORE->hashes->stale, pageNumber))
+    return -1;
+
+  return 0;
+}
+
+/* int notePageWrite(const store *STORE, uint64_t pageNumber):
+ * Called by the write paths before writing in the page of a store for
+ * which storeWatchesWrites is true: saves the page for its snapshot and
+ * marks it changed.
+ * Returns 0, or -1 if the page couldn't be saved or marked, and must not
+ * be written.
+ */
+static inline int notePageWrite(const store *STORE, uint64_t pageNumber){
+  if (STORE->snapshot != NULL && preservePageofStore(STORE, pageNumber))
+    return -1;
+
+  return markPageChanged(STORE, pageNumber);
+}
+
+#endif
@@ -0,0 +1,186 @@
+#include "store/registerfile.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "store/storeutil.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+
+
+/* registerFile initializeRegisterFile(const uint64_t totalRegisters,
+                                       const uint64_t wordSize):
+ * Takes number of registers and their size in bits (1 to 64), returns a
+ * register file with all of them visible and zeroed.
+ * Returns register file with uninitiated store if unable to create it.
+ */
+registerFile initializeRegisterFile(const uint64_t totalRegisters,
+                                    const uint64_t wordSize){
+  return initializeWindowedRegisterFile(totalRegisters, totalRegisters,
+                                        wordSize);
+}
+
+
+
+/* registerFile initializeWindowedRegisterFile(
+                                       const uint64_t windowRegisters,
+                                       const uint64_t totalRegisters,
+                                       const uint64_t wordSize):
+ * Same as initializeRegisterFile for totalRegisters physical registers,
+ * of which windowRegisters are visible at a time, from the first one until
+ * selectRegisterWindow is called. E.g. 2 banks of 16 registers are 32
+ * registers with a window of 16, switched by bases 0 and 16.
+ * Returns register file with uninitiated store if unable to create it.
+ */
+registerFile initializeWindowedRegisterFile(const uint64_t windowRegisters,
+                                            const uint64_t totalRegisters,
+                                            const uint64_t wordSize){
+  registerFile REGISTERFILE = {0};
+
+  if (STORE_CHECK_FAILS(wordSize == 0 || wordSize > 64)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("initializeWindowedRegisterFile",
+                                   "registers must be 1 to 64 bits",
+                                   "uninitiated store"));
+    return REGISTERFILE;
+  }
+  if (STORE_CHECK_FAILS(windowRegisters == 0 ||
+                        windowRegisters > totalRegisters)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("initializeWindowedRegisterFile",
+                                   "window must have 1 to totalRegisters "
+                                   "registers", "uninitiated store"));
+    return REGISTERFILE;
+  }
+
+  REGISTERFILE.registers = initializeStoreofKind(totalRegisters, wordSize,
+                                                 PACKED_STORE);
+  if (!REGISTERFILE.registers.set)
+    return REGISTERFILE;
+  REGISTERFILE.windowRegisters = windowRegisters;
+
+  return REGISTERFILE;
+}
+
+
+
+/* void destroyRegisterFile(registerFile *REGISTERFILE):
+ * Frees the store of the register file and leaves it uninitiated.
+ */
+void destroyRegisterFile(registerFile *REGISTERFILE){
+  destroyStore(&REGISTERFILE->registers);
+  *REGISTERFILE = (registerFile){0};
+}
+
+
+
+/* int hardwireZeroRegister(registerFile *REGISTERFILE,
+                            const uint64_t index):
+ * Makes visible register index (0 to 63) always read 0 and ignore writes,
+ * as x0 of RISC-V or r0 of MIPS, whichever window is selected.
+ * Returns 0, or -1 if index is out of the window or above 63.
+ */
+int hardwireZeroRegister(registerFile *REGISTERFILE, const uint64_t index){
+  if (STORE_CHECK_FAILS(index >= REGISTERFILE->windowRegisters ||
+                        index >= 64)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("hardwireZeroRegister",
+                                   "register %"PRIu64" can't be hardwired",
+                                   "-1"), index);
+    return -1;
+  }
+
+  REGISTERFILE->zeroRegisters |= (uint64_t)1 << index;
+  return 0;
+}
+
+
+
+/* int selectRegisterWindow(registerFile *REGISTERFILE,
+                            const uint64_t base):
+ * Makes visible register 0 the physical register base, and following ones
+ * the next physical registers, wrapping around past the last one. Nothing
+ * is copied, registers of the previous window keep their values.
+ * Returns 0, or -1 if base is not a physical register.
+ */
+int selectRegisterWindow(registerFile *REGISTERFILE, const uint64_t base){
+  if (STORE_CHECK_FAILS(base >= REGISTERFILE->registers.totalLocations)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("selectRegisterWindow",
+                                   "base %"PRIu64" is not a register", "-1"),
+                     base);
+    return -1;
+  }
+
+  REGISTERFILE->base = base;
+  return 0;
+}
+
+
+
+/* int readRegisters(const registerFile *REGISTERFILE,
+                     const uint64_t indices[], uint64_t values[],
+                     const unsigned count):
+ * Reads count visible registers in one call, values[i] getting register
+ * indices[i], e.g. rs1, rs2 and rs3 of an instruction.
+ * Returns 0, or -1 without reading any if one of them is out of the window.
+ */
+int readRegisters(const registerFile *REGISTERFILE, const uint64_t indices[],
+                  uint64_t values[], const unsigned count){
+  for (unsigned index = 0; index < count; index++)
+    if (STORE_CHECK_FAILS(indices[index] >= REGISTERFILE->windowRegisters)){
+      reportStoreError(STORE_OUT_OF_BOUND,
+                       ERROR_MESSAGE("readRegisters",
+                                     "register %"PRIu64" out of the window",
+                                     "-1"), indices[index]);
+      return -1;
+    }
+
+  const store *registers = &REGISTERFILE->registers;
+  for (unsigned index = 0; index < count; index++)
+    values[index] = isZeroRegister(REGISTERFILE, indices[index]) ? 0 :
+                    readStoreWord(registers,
+                                  physicalRegister(REGISTERFILE,
+                                                   indices[index]));
+
+  return 0;
+}
+
+
+
+/* int writeRegisters(registerFile *REGISTERFILE, const uint64_t indices[],
+                      const uint64_t values[], const unsigned count):
+ * Writes count visible registers in one call, register indices[i] getting
+ * lowest wordSize bits of values[i], in order, so the last write to a
+ * register repeated in indices wins. Writes to zero registers are dropped.
+ * Returns 0, or -1 without writing any if one of them is out of the window,
+ * or -1 on the first write that fails, e.g. unable to save a page of a
+ * snapshot, those before it done.
+ */
+int writeRegisters(registerFile *REGISTERFILE, const uint64_t indices[],
+                   const uint64_t values[], const unsigned count){
+  for (unsigned index = 0; index < count; index++)
+    if (STORE_CHECK_FAILS(indices[index] >= REGISTERFILE->windowRegisters)){
+      reportStoreError(STORE_OUT_OF_BOUND,
+                       ERROR_MESSAGE("writeRegisters",
+                                     "register %"PRIu64" out of the window",
+                                     "-1"), indices[index]);
+      return -1;
+    }
+
+  store *registers = &REGISTERFILE->registers;
+  for (unsigned index = 0; index < count; index++)
+    if (!isZeroRegister(REGISTERFILE, indices[index]) &&
+        writeStoreWord(registers, physicalRegister(REGISTERFILE,
+                                                   indices[index]),
+                       values[index]))
+      return -1;
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef LIB_STORE_IMPLEMENTATION_SNAPSHOTPAGES_H
+#define LIB_STORE_IMPLEMENTATION_SNAPSHOTPAGES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+#include "storepages.h"
+
+/* Snapshot of a store, see storesnapshot.h. The packed bits of any kind of
+ * store are cut in pages of STORE_PAGE_BYTES bytes, as in a PAGED_STORE, a
+ * MATRIX_STORE counting its bits the same way. Before a page is written
+ * for the first time since the snapshot (or last restore), its bytes are
+ * saved in a buffer of the 'saved' list, so restoring copies back only
+ * those pages.
+ * A page is saved in the current generation if its entry of 'epochs' holds
+ * 'epoch', so taking a snapshot just starts a new generation, while a
+ * restore clears the entries of the pages it copies back.
+ * Entries are kept in chunks of SNAPSHOT_CHUNK_PAGES pages allocated on the
+ * first save in them, so sparse PAGED_STORE pay only for pages written.
+ */
+#define SNAPSHOT_CHUNK_SHIFT 12
+#define SNAPSHOT_CHUNK_PAGES ((uint64_t)1 << SNAPSHOT_CHUNK_SHIFT)
+
+struct savedPage{
+  uint64_t pageNumber;
+  uint8_t *bytes;
+};
+
+struct storeSnapshot{
+  uint64_t totalPages;
+  uint32_t epoch;
+  uint64_t totalSaved;
+  uint64_t savedCapacity;
+  struct savedPage *saved;
+  uint64_t totalChunks;
+  uint32_t *epochs[];
+};
+
+int savePageforSnapshot(const store *STORE, uint64_t pageNumber);
+void copyPageoutofStore(const store *STORE, uint64_t pageNumber,
+                        uint8_t *bytes);
+
+/* int preservePageofStore(const store *STORE, uint64_t pageNumber):
+ * Called before writing in the page of a store having a snapshot, saves
+ * the page unless it is saved in the current generation already.
+ * Returns 0, or -1 if unable to allocate the saved copy.
+ */
+static inline int preservePageofStore(const store *STORE,
+                                      uint64_t pageNumber){
+  const struct storeSnapshot *snapshot = STORE->snapshot;
+  const uint32_t *epochs = snapshot->epochs[pageNumber >>
+                                            SNAPSHOT_CHUNK_SHIFT];
+  if (epochs != NULL &&
+      epochs[pageNumber & (SNAPSHOT_CHUNK_PAGES - 1)] == snapshot->epoch)
+    return 0;
+
+  return savePageforSnapshot(STORE, pageNumber);
+}
+
+#endif
@@ -6,6 +6,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <string.h>
+
+#include "store/storeerror.h"
+#include "store/storedevice.h"
+#include "store/storedirty.h"
+#include "store/storehash.h"
+#include "store/storesnapshot.h"
+#include "packedbits.h"
+#include "pagewrites.h"
+#include "storepages.h"
 
 
 #define ERROR_MESSAGE(location,reason,returnValue) ("\nin" location ":\n" reason ", returning " returnValue "\n")
@@ -16,6 +26,16 @@
 
 
 
+/* void destroyMatrix(bool **matrix, uint64_t totalRows):
+ * Takes pointer returned by createMatrix and number of rows allocated in it,
+ * and frees every row and the matrix itself.
+ */
+void destroyMatrix(bool **matrix, uint64_t totalRows){
+  for (uint64_t index = 0; index < totalRows; index++)
+    free(matrix[index]);
+  free(matrix);
+}
+
 /* bool **createMatrix(uint64_t totalRows, uint64_t totalColumns):
  * Takes total number of rows and columns, and returns a pointer
  * pointing to two dimensional bool array. Returns NULL if unable to
@@ -24,28 +44,50 @@
  * for integer to unsigned integer conversions.
  */
 bool **createMatrix(uint64_t totalRows, uint64_t totalColumns){
-  bool **matrix = (bool**)malloc(sizeof(bool*) * totalColumns);
+  bool **matrix = (bool**)malloc(sizeof(bool*) * totalRows);
   if(matrix == NULL){
-    printf(ERROR_MESSAGE("createMatrix",
-           "unable to allocate space to data matrix", "NULL"));
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("createMatrix",
+                     "unable to allocate space to data matrix", "NULL"));
     return NULL;
   }
 
-  bool NULLcheck = false;
   for (uint64_t index = 0; index < totalRows; index++){
-    matrix[index] = (bool*)malloc(sizeof(bool) * totalColumns);
+    matrix[index] = (bool*)calloc(totalColumns ? totalColumns : 1,
+                                  sizeof(bool));
     if(matrix[index] == NULL){
-      NULLcheck = true;
-      break;
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("createMatrix",
+                       "unable to allocate space to data matrix", "NULL"));
+      destroyMatrix(matrix, index);
+      return NULL;
     }
   }
-  if (NULLcheck == true){
-    printf(ERROR_MESSAGE("createMatrix",
-           "unable to allocate space to data matrix", "NULL"));
+
+  return matrix;
+}
+
+/* uint64_t *createPackedWords(uint64_t totalBits):
+ * Takes total number of bits to hold, and returns a single zeroed
+ * allocation of uint64_t words large enough to hold all of them.
+ * Bits are packed word-major: bit 'bitinWord' of 'location' is bit number
+ * location * wordSize + bitinWord of the allocation, counted from the most
+ * significant bit of its first byte, so consecutive locations and the bytes
+ * of the words follow each other in memory.
+ * Returns NULL if unable to allocate the words.
+ */
+uint64_t *createPackedWords(uint64_t totalBits){
+  uint64_t totalWords = (totalBits + 63) / 64;
+  uint64_t *words = (uint64_t*)calloc(totalWords ? totalWords : 1,
+                                      sizeof(uint64_t));
+  if (words == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("createPackedWords",
+                     "unable to allocate space to packed words", "NULL"));
     return NULL;
   }
 
-  return matrix;
+  return words;
 }
 
 /* store initializeStore(uint64_t wordSize, uint64_t totalLocations):
@@ -58,14 +100,61 @@ bool **createMatrix(uint64_t totalRows, uint64_t totalColumns){
  */
 store initializeStore(const uint64_t totalLocations,
                         const uint64_t wordSize){
-  store STORE;
+  return initializeStoreofKind(totalLocations, wordSize, MATRIX_STORE);
+}
 
-  STORE.matrix = createMatrix(wordSize, totalLocations);
-  if (STORE.matrix == NULL){
-    printf(INITIALIZE_ERROR_MESSAGE("unable to allocate space to data matrix"));
+/* store initializeStoreofKind(const uint64_t totalLocations,
+                               const uint64_t wordSize, const storeKind kind):
+ * Same as initializeStore, but takes the kind of layout to hold the
+ * data in, MATRIX_STORE, PACKED_STORE or PAGED_STORE.
+ * Returns uninitiated store object if kind is unknown or unable to
+ * allocate space for the data.
+ */
+store initializeStoreofKind(const uint64_t totalLocations,
+                            const uint64_t wordSize, const storeKind kind){
+  store STORE = {0};
+
+  if (wordSize != 0 && totalLocations > UINT64_MAX / wordSize){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     INITIALIZE_ERROR_MESSAGE("total bits of the store overflow 64 bits"));
     return STORE;
   }
 
+  switch (kind){
+    case MATRIX_STORE:
+      STORE.matrix = createMatrix(totalLocations, wordSize);
+      if (STORE.matrix == NULL){
+        reportStoreError(STORE_ALLOCATION_FAILED,
+                         INITIALIZE_ERROR_MESSAGE("unable to allocate space to data matrix"));
+        return STORE;
+      }
+      break;
+
+    case PACKED_STORE:
+      STORE.words = createPackedWords(totalLocations * wordSize);
+      if (STORE.words == NULL){
+        reportStoreError(STORE_ALLOCATION_FAILED,
+                         INITIALIZE_ERROR_MESSAGE("unable to allocate space to packed words"));
+        return STORE;
+      }
+      break;
+
+    case PAGED_STORE:
+      STORE.pages = createPageTable((totalLocations * wordSize + 7) / 8);
+      if (STORE.pages == NULL){
+        reportStoreError(STORE_ALLOCATION_FAILED,
+                         INITIALIZE_ERROR_MESSAGE("unable to allocate page table"));
+        return STORE;
+      }
+      break;
+
+    default:
+      reportStoreError(STORE_INVALID_ARGUMENT,
+                       INITIALIZE_ERROR_MESSAGE("unknown store kind"));
+      return STORE;
+  }
+
+  STORE.kind = kind;
   STORE.wordSize = wordSize;
   STORE.totalLocations = totalLocations;
   STORE.set = true;
@@ -73,6 +162,34 @@ store initializeStore(const uint64_t totalLocations,
   return STORE;
 }
 
+/* void destroyStore(store *STORE):
+ * Takes pointer to a store object, releases everything allocated to hold
+ * its data and leaves it as an uninitiated store, so later calls on it
+ * fail instead of touching freed memory. Does nothing for an uninitiated
+ * store. Packed bits of a store of an arena are left to destroyStoreArena.
+ */
+void destroyStore(store *STORE){
+  if (STORE == NULL || !STORE->set)
+    return;
+
+  dropStoreSnapshot(STORE);
+  stopTrackingDirtyPages(STORE);
+  stopTrackingStoreHash(STORE);
+  detachAllDevicesfromStore(STORE);
+  if (STORE->kind == PACKED_STORE){
+    if (!STORE->inArena)
+      free(STORE->words);
+  }
+  else if (STORE->kind == MAPPED_STORE)
+    unmapStore(STORE);
+  else if (STORE->kind == PAGED_STORE)
+    destroyPageTable(STORE->pages);
+  else
+    destroyMatrix(STORE->matrix, STORE->totalLocations);
+
+  *STORE = (store){0};
+}
+
 /* bool writeBittoStore (store givenStore, const uint64_t location,
                           const uint64_t bitinWord, const bool value):
  * Takes a store object, location in the matrix with row no. = location,
@@ -84,20 +201,55 @@ store initializeStore(const uint64_t totalLocations,
 int writeBittoStore (store givenStore, const uint64_t location,
                       const uint64_t bitinWord, const bool value){
 
-  if (!givenStore.set){
-    printf(WRITE_ERROR_MESSAGE("givenStore isn't formally initialized yet"));
+  if (STORE_CHECK_FAILS(!givenStore.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     WRITE_ERROR_MESSAGE("givenStore isn't formally initialized yet"));
+    return -1;
+  }
+
+  if (STORE_CHECK_FAILS(location >= givenStore.totalLocations)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     WRITE_ERROR_MESSAGE("requested 'location' %"PRIu64" out of bound"),
+                     location);
     return -1;
   }
 
-  if (location >= givenStore.totalLocations){
-    printf(WRITE_ERROR_MESSAGE("requested 'location' %"PRIu64" out of bound"),
-           location);
+  if (STORE_CHECK_FAILS(bitinWord >= givenStore.wordSize)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     WRITE_ERROR_MESSAGE("requested 'bit in Word' %"PRIu64" out of bound"),
+                     bitinWord);
     return -1;
   }
 
-  if (bitinWord >= givenStore.wordSize){
-    printf(WRITE_ERROR_MESSAGE("requested 'bit in Word' %"PRIu64" out of bound"),
-           bitinWord);
+  if (givenStore.kind != MATRIX_STORE ||
+      storeTracesAccesses(&givenStore)){
+    uint64_t bit = location * givenStore.wordSize + bitinWord;
+    bool failed;
+    if (givenStore.concurrent || storeTracesAccesses(&givenStore))
+      failed = writeStoreBits(&givenStore, bit, 1, value);
+    else{
+      uint64_t availableBytes;
+      uint8_t *byte = storeBytesforWrite(&givenStore, bit / 8,
+                                         &availableBytes);
+      failed = (byte == NULL);
+      if (byte != NULL){
+        uint8_t mask = 0x80 >> (bit % 8);
+        *byte = value ? (*byte | mask) : (*byte & ~mask);
+      }
+    }
+    if (failed){
+      reportStoreError(STORE_WRITE_FAILED,
+                       WRITE_ERROR_MESSAGE("store is read only or unable to allocate page"));
+      return -1;
+    }
+    return 0;
+  }
+
+  if (storeWatchesWrites(&givenStore) &&
+      notePageWrite(&givenStore, (location * givenStore.wordSize +
+                                  bitinWord) >> (STORE_PAGE_SHIFT + 3))){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     WRITE_ERROR_MESSAGE("unable to save page for snapshot or mark it"));
     return -1;
   }
 
@@ -115,23 +267,37 @@ int writeBittoStore (store givenStore, const uint64_t location,
 int readBitfromStore (const store givenStore, const uint64_t location,
                        const uint64_t bitinWord){
 
-  if(!givenStore.set){
-    printf(READ_ERROR_MESSAGE("givenStore is not formally initialized yet"));
+  if (STORE_CHECK_FAILS(!givenStore.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     READ_ERROR_MESSAGE("givenStore is not formally initialized yet"));
     return -1;
   }
 
-  if (location >= givenStore.totalLocations){
-    printf(READ_ERROR_MESSAGE("given 'location' %"PRIu64" is out of bound"),
-              location);
+  if (STORE_CHECK_FAILS(location >= givenStore.totalLocations)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     READ_ERROR_MESSAGE("given 'location' %"PRIu64" is out of bound"),
+                        location);
     return -1;
   }
 
-  if (bitinWord >= givenStore.wordSize){
-    printf(READ_ERROR_MESSAGE("given 'bit in word' %"PRIu64" is out of bound"),
-           bitinWord);
+  if (STORE_CHECK_FAILS(bitinWord >= givenStore.wordSize)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     READ_ERROR_MESSAGE("given 'bit in word' %"PRIu64" is out of bound"),
+                     bitinWord);
     return -1;
   }
 
+  if (givenStore.kind != MATRIX_STORE ||
+      storeTracesAccesses(&givenStore)){
+    uint64_t bit = location * givenStore.wordSize + bitinWord;
+    if (givenStore.concurrent || storeTracesAccesses(&givenStore))
+      return readStoreBits(&givenStore, bit, 1);
+    uint64_t availableBytes;
+    const uint8_t *byte = storeBytesforRead(&givenStore, bit / 8,
+                                            &availableBytes);
+    return (*byte >> (7 - bit % 8)) & 1;
+  }
+
   bool value = givenStore.matrix[location][bitinWord];
 
   return value;
@@ -145,8 +311,10 @@ int readBitfromStore (const store givenStore, const uint64_t location,
  */
 size_t sizeofStore(store STORE){
   if (!STORE.set){
-    printf(ERROR_MESSAGE("sizeofStore", "store is not formally initialized",\
-                         "0"));
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("sizeofStore",
+                                   "store is not formally initialized",\
+                                   "0"));
     return 0;
   }
 
@@ -154,3 +322,359 @@ size_t sizeofStore(store STORE){
 
   return storeSize;
 }
+
+
+
+/* size_t footprintofStore(store STORE):
+ * Takes store object.
+ * Returns number of bytes of memory actually allocated to hold the data
+ * of the store, including row pointers of a MATRIX_STORE, returns 0
+ * if the object is not initialized.
+ */
+size_t footprintofStore(store STORE){
+  if (!STORE.set){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("footprintofStore",
+                                   "store is not formally initialized",\
+                                   "0"));
+    return 0;
+  }
+
+  if (STORE.kind == PACKED_STORE || STORE.kind == MAPPED_STORE)
+    return packedBytesofStore(&STORE);
+
+  if (STORE.kind == PAGED_STORE)
+    return footprintofPageTable(STORE.pages);
+
+  return STORE.totalLocations * (sizeof(bool*) + STORE.wordSize * sizeof(bool));
+}
+
+
+
+/* int tlbCountersofStore(store STORE, uint64_t *hits, uint64_t *misses):
+ * Takes a PAGED_STORE, stores in hits and misses how many page lookups
+ * were served by its TLB and how many had to walk the page table, counted
+ * since initialization or resetTLBCountersofStore.
+ * Returns 0, or -1 if the store is not an initialized PAGED_STORE.
+ */
+int tlbCountersofStore(store STORE, uint64_t *hits, uint64_t *misses){
+  if (!STORE.set || STORE.kind != PAGED_STORE){
+    reportStoreError(STORE_WRONG_KIND,
+                     ERROR_MESSAGE("tlbCountersofStore",
+                                   "store is not an initialized paged store",
+                                   "-1"));
+    return -1;
+  }
+
+  *hits = STORE.pages->tlbHits;
+  *misses = STORE.pages->tlbMisses;
+
+  return 0;
+}
+
+
+
+/* int resetTLBCountersofStore(store STORE):
+ * Sets both TLB counters of a PAGED_STORE back to 0.
+ * Returns 0, or -1 if the store is not an initialized PAGED_STORE.
+ */
+int resetTLBCountersofStore(store STORE){
+  if (!STORE.set || STORE.kind != PAGED_STORE){
+    reportStoreError(STORE_WRONG_KIND,
+                     ERROR_MESSAGE("resetTLBCountersofStore",
+                                   "store is not an initialized paged store",
+                                   "-1"));
+    return -1;
+  }
+
+  STORE.pages->tlbHits = 0;
+  STORE.pages->tlbMisses = 0;
+
+  return 0;
+}
+
+
+
+/* int makeStoreConcurrent(store *STORE):
+ * Takes initialized store and makes it safe to share between threads, e.g.
+ * one per simulated hart: writes of fields not filling whole bytes become
+ * compare and swap loops on the aligned 8 byte units holding them, reads
+ * are atomic loads, and pages of a PAGED_STORE are looked up without TLB
+ * and allocated lock free. Whole bytes are still written with plain stores,
+ * they never hold bits of other locations. Cells of a MATRIX_STORE are
+ * separate already. Call it before copies of the store are given to other
+ * threads, they carry the mode. See storeatomic.h for atomic operations.
+ * Returns 0, or -1 if the store is not initialized or has a snapshot.
+ */
+int makeStoreConcurrent(store *STORE){
+  if (!STORE->set){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("makeStoreConcurrent",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+
+  if (STORE->snapshot != NULL){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("makeStoreConcurrent",
+                                   "store has a snapshot", "-1"));
+    return -1;
+  }
+
+  STORE->concurrent = true;
+  if (STORE->kind == PAGED_STORE)
+    makePageTableConcurrent(STORE->pages);
+
+  return 0;
+}
+
+
+
+/* const uint8_t *storeBytesforRead(const store *STORE, uint64_t byteIndex,
+                                    uint64_t *availableBytes):
+ * Takes initialized store other than MATRIX_STORE and index of a byte of its
+ * packed bits. Returns pointer to that byte and stores in availableBytes
+ * how many bytes from it lie contiguously in memory, till the end of the
+ * allocation or page. Untouched pages of a PAGED_STORE read as zeroPage.
+ * No checks are done, byteIndex must be inside the store.
+ */
+const uint8_t *storeBytesforRead(const store *STORE, uint64_t byteIndex,
+                                 uint64_t *availableBytes){
+  if (STORE->kind == PAGED_STORE){
+    uint64_t offset = byteIndex & (STORE_PAGE_BYTES - 1);
+    *availableBytes = STORE_PAGE_BYTES - offset;
+    return pageforRead(STORE->pages, byteIndex >> STORE_PAGE_SHIFT) + offset;
+  }
+
+  *availableBytes = packedBytesofStore(STORE) - byteIndex;
+  return (const uint8_t*)STORE->words + byteIndex;
+}
+
+
+
+/* uint8_t *storeBytesforWrite(const store *STORE, uint64_t byteIndex,
+                               uint64_t *availableBytes):
+ * Same as storeBytesforRead, but returns writable bytes, allocating the
+ * page holding them in a PAGED_STORE if needed. If storeWatchesWrites,
+ * the page is noted first and availableBytes never goes past its end.
+ * Returns NULL if unable to allocate the page or save it, or the store is
+ * read only.
+ */
+uint8_t *storeBytesforWrite(const store *STORE, uint64_t byteIndex,
+                            uint64_t *availableBytes){
+  uint64_t offset = byteIndex & (STORE_PAGE_BYTES - 1);
+
+  if (STORE->kind == PAGED_STORE){
+    if (storeWatchesWrites(STORE) &&
+        notePageWrite(STORE, byteIndex >> STORE_PAGE_SHIFT))
+      return NULL;
+    uint8_t *page = pageforWrite(STORE->pages, byteIndex >> STORE_PAGE_SHIFT);
+    *availableBytes = STORE_PAGE_BYTES - offset;
+    return (page == NULL) ? NULL : page + offset;
+  }
+
+  if (STORE->readOnly)
+    return NULL;
+
+  *availableBytes = packedBytesofStore(STORE) - byteIndex;
+  if (storeWatchesWrites(STORE)){
+    /* only the page noted may be written.*/
+    if (notePageWrite(STORE, byteIndex >> STORE_PAGE_SHIFT))
+      return NULL;
+    if (*availableBytes > STORE_PAGE_BYTES - offset)
+      *availableBytes = STORE_PAGE_BYTES - offset;
+  }
+  return (uint8_t*)STORE->words + byteIndex;
+}
+
+
+
+/* uint64_t readConcurrentBits(const store *STORE, uint64_t bit,
+                               unsigned width):
+ * readStoreBits of a concurrent store: the field is read from the 8 byte
+ * aligned units holding it, one atomic load each.
+ */
+static uint64_t readConcurrentBits(const store *STORE, uint64_t bit,
+                                   unsigned width){
+  uint64_t value = 0;
+
+  while (width > 0){
+    unsigned offset = bit % 64;
+    unsigned part = (64 - offset < width) ? 64 - offset : width;
+    uint64_t availableBytes;
+    const uint8_t *unit = storeBytesforRead(STORE, bit / 64 * 8,
+                                            &availableBytes);
+    value = ((part < 64) ? value << part : 0) |
+            atomicReadPackedBits(unit, offset, part);
+    bit += part;
+    width -= part;
+  }
+
+  return value;
+}
+
+
+
+/* int writeConcurrentBits(const store *STORE, uint64_t bit, unsigned width,
+                           uint64_t value):
+ * writeStoreBits of a concurrent store: the field is written in the 8 byte
+ * aligned units holding it with atomicWritePackedBits, so writes to other
+ * locations sharing a unit are never lost.
+ * Returns 0 if written, -1 if unable to allocate a page or the store is
+ * read only.
+ */
+static int writeConcurrentBits(const store *STORE, uint64_t bit,
+                               unsigned width, uint64_t value){
+  while (width > 0){
+    unsigned offset = bit % 64;
+    unsigned part = (64 - offset < width) ? 64 - offset : width;
+    uint64_t availableBytes;
+    uint8_t *unit = storeBytesforWrite(STORE, bit / 64 * 8, &availableBytes);
+    if (unit == NULL)
+      return -1;
+    width -= part;
+    atomicWritePackedBits(unit, offset, part,
+                          (width > 0) ? value >> width : value);
+    bit += part;
+  }
+
+  return 0;
+}
+
+
+
+/* uint64_t readStoreBits(const store *STORE, uint64_t bit, unsigned width):
+ * Takes initialized store, index of the first bit in its packed bits,
+ * i.e. location * wordSize + bit in word, and width (1 to 64) of the field,
+ * which may span several locations.
+ * Returns the field, first bit as most significant bit, gathering its bytes
+ * when the field crosses a page. No checks are done. Fields of a traced
+ * store are recorded, see storetrace.h.
+ */
+uint64_t readStoreBits(const store *STORE, uint64_t bit, unsigned width){
+  if (storeTracesAccesses(STORE)){
+    store untraced = *STORE;
+    untraced.traced = false;
+    uint64_t value = readStoreBits(&untraced, bit, width);
+    recordStoreAccess(STORE, bit, width, value, false);
+    return value;
+  }
+
+  if (STORE->kind == MATRIX_STORE){
+    uint64_t location = bit / STORE->wordSize;
+    uint64_t bitinWord = bit % STORE->wordSize;
+    uint64_t value = 0;
+    for (unsigned index = 0; index < width; index++){
+      value = (value << 1) | STORE->matrix[location][bitinWord];
+      if (++bitinWord == STORE->wordSize){
+        location++;
+        bitinWord = 0;
+      }
+    }
+    return value;
+  }
+
+  if (STORE->concurrent)
+    return readConcurrentBits(STORE, bit, width);
+
+  uint64_t availableBytes;
+  const uint8_t *bytes = storeBytesforRead(STORE, bit / 8, &availableBytes);
+  unsigned fieldBytes = (bit % 8 + width + 7) / 8;
+
+  if (fieldBytes <= availableBytes)
+    return readPackedBits(bytes, availableBytes, bit % 8, width);
+
+  uint8_t gathered[16] = {0};
+  unsigned copied = 0;
+  while (copied < fieldBytes){
+    if (copied)
+      bytes = storeBytesforRead(STORE, bit / 8 + copied, &availableBytes);
+    unsigned chunk = (fieldBytes - copied < availableBytes) ?
+                     fieldBytes - copied : availableBytes;
+    memcpy(gathered + copied, bytes, chunk);
+    copied += chunk;
+  }
+
+  return readPackedBits(gathered, sizeof(gathered), bit % 8, width);
+}
+
+
+
+/* int writeStoreBits(const store *STORE, uint64_t bit, unsigned width,
+                      uint64_t value):
+ * Same as readStoreBits, but writes lowest 'width' bits of value as the
+ * field. Returns 0 if written, -1 if unable to allocate a page or the
+ * store is read only.
+ */
+int writeStoreBits(const store *STORE, uint64_t bit, unsigned width,
+                   uint64_t value){
+  if (storeTracesAccesses(STORE)){
+    store untraced = *STORE;
+    untraced.traced = false;
+    if (writeStoreBits(&untraced, bit, width, value))
+      return -1;
+    recordStoreAccess(STORE, bit, width, value, true);
+    return 0;
+  }
+
+  if (STORE->kind == MATRIX_STORE){
+    if (storeWatchesWrites(STORE) &&
+        (notePageWrite(STORE, bit >> (STORE_PAGE_SHIFT + 3)) ||
+         notePageWrite(STORE, (bit + width - 1) >> (STORE_PAGE_SHIFT + 3))))
+      return -1;
+    uint64_t location = bit / STORE->wordSize;
+    uint64_t bitinWord = bit % STORE->wordSize;
+    for (unsigned index = 0; index < width; index++){
+      STORE->matrix[location][bitinWord] = (value >> (width - index - 1)) & 1;
+      if (++bitinWord == STORE->wordSize){
+        location++;
+        bitinWord = 0;
+      }
+    }
+    return 0;
+  }
+
+  if (STORE->concurrent)
+    return writeConcurrentBits(STORE, bit, width, value);
+
+  uint64_t availableBytes;
+  uint8_t *bytes = storeBytesforWrite(STORE, bit / 8, &availableBytes);
+  unsigned fieldBytes = (bit % 8 + width + 7) / 8;
+
+  if (bytes == NULL)
+    return -1;
+
+  if (fieldBytes <= availableBytes){
+    writePackedBits(bytes, availableBytes, bit % 8, width, value);
+    return 0;
+  }
+
+  /* field crosses a page, write it to a copy of its bytes first and copy
+   * them back page by page.*/
+  uint8_t gathered[16] = {0};
+  unsigned copied = 0;
+  while (copied < fieldBytes){
+    const uint8_t *source = storeBytesforRead(STORE, bit / 8 + copied,
+                                              &availableBytes);
+    unsigned chunk = (fieldBytes - copied < availableBytes) ?
+                     fieldBytes - copied : availableBytes;
+    memcpy(gathered + copied, source, chunk);
+    copied += chunk;
+  }
+
+  writePackedBits(gathered, sizeof(gathered), bit % 8, width, value);
+
+  copied = 0;
+  while (copied < fieldBytes){
+    bytes = storeBytesforWrite(STORE, bit / 8 + copied, &availableBytes);
+    if (bytes == NULL)
+      return -1;
+    unsigned chunk = (fieldBytes - copied < availableBytes) ?
+                     fieldBytes - copied : availableBytes;
+    memcpy(bytes, gathered + copied, chunk);
+    copied += chunk;
+  }
+
+  return 0;
+}
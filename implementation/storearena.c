@@ -0,0 +1,249 @@
+#include "store/storearena.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "packedbits.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+/* largest arena allocated, leaving room to round sizes up.*/
+#define MAX_ARENA_BYTES (SIZE_MAX / 2)
+
+
+
+/* uint64_t roundUp(uint64_t bytes, uint64_t alignment):
+ * Returns bytes rounded up to a multiple of alignment, a power of 2.
+ */
+static uint64_t roundUp(uint64_t bytes, uint64_t alignment){
+  return (bytes + alignment - 1) & ~(alignment - 1);
+}
+
+
+
+/* void placeStoreinArena(store *STORE, uint64_t totalLocations,
+                          uint64_t wordSize, uint8_t *bytes):
+ * Makes STORE a PACKED_STORE of that geometry holding its packed bits at
+ * bytes, owned by an arena.
+ */
+static void placeStoreinArena(store *STORE, uint64_t totalLocations,
+                              uint64_t wordSize, uint8_t *bytes){
+  *STORE = (store){0};
+  STORE->kind = PACKED_STORE;
+  STORE->wordSize = wordSize;
+  STORE->totalLocations = totalLocations;
+  STORE->words = (uint64_t*)bytes;
+  STORE->inArena = true;
+  STORE->set = true;
+}
+
+
+
+/* uint64_t layOutArena(const storeLayout layouts[], unsigned totalStores,
+                        store stores[], uint8_t *data):
+ * Lays out the packed bits of the stores from data, those of hot stores
+ * back to back, then those of the others, each from a new cache line, and
+ * places the stores there unless stores is NULL.
+ * Returns number of bytes taken from data, or UINT64_MAX if a store is
+ * too large or they don't fit MAX_ARENA_BYTES.
+ */
+static uint64_t layOutArena(const storeLayout layouts[], unsigned totalStores,
+                            store stores[], uint8_t *data){
+  uint64_t dataBytes = 0;
+
+  for (int hot = 1; hot >= 0; hot--){
+    for (unsigned index = 0; index < totalStores; index++){
+      const storeLayout *layout = &layouts[index];
+      if (layout->hot != hot)
+        continue;
+      if (layout->wordSize != 0 &&
+          layout->totalLocations > UINT64_MAX / layout->wordSize)
+        return UINT64_MAX;
+
+      uint64_t bytes = packedBytesforGeometry(layout->totalLocations,
+                                              layout->wordSize);
+      if (!hot)
+        dataBytes = roundUp(dataBytes, STORE_ARENA_ALIGNMENT);
+      if (bytes > MAX_ARENA_BYTES - dataBytes)
+        return UINT64_MAX;
+
+      if (stores != NULL)
+        placeStoreinArena(&stores[index], layout->totalLocations,
+                          layout->wordSize, data + dataBytes);
+      dataBytes += bytes;
+    }
+    /* cold stores start on the line after the hot ones.*/
+    dataBytes = roundUp(dataBytes, STORE_ARENA_ALIGNMENT);
+  }
+
+  return dataBytes;
+}
+
+
+
+/* storeArena allocateArena(unsigned totalStores, uint64_t dataBytes):
+ * Returns an arena of uninitiated stores and dataBytes bytes of data left
+ * as allocated, in a single aligned allocation, or an uninitiated arena if
+ * unable to allocate it.
+ */
+static storeArena allocateArena(unsigned totalStores, uint64_t dataBytes){
+  storeArena ARENA = {0};
+  uint64_t storeBytes = roundUp((uint64_t)totalStores * sizeof(store),
+                                STORE_ARENA_ALIGNMENT);
+
+  if (dataBytes > MAX_ARENA_BYTES - storeBytes)
+    return ARENA;
+  uint8_t *block = aligned_alloc(STORE_ARENA_ALIGNMENT,
+                                 storeBytes + dataBytes);
+  if (block == NULL)
+    return ARENA;
+
+  memset(block, 0, storeBytes);
+  ARENA.stores = (store*)block;
+  ARENA.totalStores = totalStores;
+  ARENA.data = block + storeBytes;
+  ARENA.dataBytes = dataBytes;
+
+  return ARENA;
+}
+
+
+
+/* storeArena initializeStoreArena(const storeLayout layouts[],
+                                   const unsigned totalStores):
+ * Takes the layouts of totalStores stores and returns an arena holding
+ * them, zeroed, see storearena.h.
+ * Returns uninitiated arena, stores NULL, if no store is given, one is
+ * too large, or unable to allocate the arena.
+ */
+storeArena initializeStoreArena(const storeLayout layouts[],
+                                const unsigned totalStores){
+  storeArena ARENA = {0};
+
+  if (STORE_CHECK_FAILS(layouts == NULL || totalStores == 0)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("initializeStoreArena",
+                                   "no store to lay out",
+                                   "uninitiated arena"));
+    return ARENA;
+  }
+
+  uint64_t dataBytes = layOutArena(layouts, totalStores, NULL, NULL);
+  if (dataBytes == UINT64_MAX){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("initializeStoreArena",
+                                   "stores are too large for an arena",
+                                   "uninitiated arena"));
+    return ARENA;
+  }
+
+  ARENA = allocateArena(totalStores, dataBytes);
+  if (ARENA.stores == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("initializeStoreArena",
+                                   "unable to allocate %"PRIu64" bytes",
+                                   "uninitiated arena"), dataBytes);
+    return ARENA;
+  }
+  memset(ARENA.data, 0, dataBytes);
+  layOutArena(layouts, totalStores, ARENA.stores, ARENA.data);
+
+  return ARENA;
+}
+
+
+
+/* int resetStoreArena(storeArena ARENA):
+ * Zeroes every store of the arena with a single memset.
+ * Returns 0, or -1 if the arena is not initialized or a store of it
+ * notes its pages written (snapshot, dirty pages, hash), which a memset
+ * would bypass.
+ */
+int resetStoreArena(storeArena ARENA){
+  if (STORE_CHECK_FAILS(ARENA.stores == NULL)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("resetStoreArena",
+                                   "arena is not initialized", "-1"));
+    return -1;
+  }
+  for (unsigned index = 0; index < ARENA.totalStores; index++){
+    if (storeWatchesWrites(&ARENA.stores[index])){
+      reportStoreError(STORE_INVALID_ARGUMENT,
+                       ERROR_MESSAGE("resetStoreArena",
+                                     "store %u notes its pages written",
+                                     "-1"), index);
+      return -1;
+    }
+  }
+
+  memset(ARENA.data, 0, ARENA.dataBytes);
+
+  return 0;
+}
+
+
+
+/* storeArena cloneStoreArena(const storeArena ARENA):
+ * Returns a new arena of the same layout holding a copy of the stores of
+ * ARENA, made with a single memcpy. Snapshots, dirty pages, hashes,
+ * devices and tracing of the stores are not cloned, nor stores destroyed
+ * with destroyStore.
+ * Returns uninitiated arena if ARENA is not initialized or unable to
+ * allocate the clone.
+ */
+storeArena cloneStoreArena(const storeArena ARENA){
+  storeArena CLONE = {0};
+
+  if (STORE_CHECK_FAILS(ARENA.stores == NULL)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("cloneStoreArena",
+                                   "arena is not initialized",
+                                   "uninitiated arena"));
+    return CLONE;
+  }
+
+  CLONE = allocateArena(ARENA.totalStores, ARENA.dataBytes);
+  if (CLONE.stores == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("cloneStoreArena",
+                                   "unable to allocate %"PRIu64" bytes",
+                                   "uninitiated arena"), ARENA.dataBytes);
+    return CLONE;
+  }
+
+  memcpy(CLONE.data, ARENA.data, ARENA.dataBytes);
+  for (unsigned index = 0; index < ARENA.totalStores; index++){
+    const store *source = &ARENA.stores[index];
+    if (!source->set)
+      continue;
+    uint64_t offset = (uint64_t)((const uint8_t*)source->words - ARENA.data);
+    placeStoreinArena(&CLONE.stores[index], source->totalLocations,
+                      source->wordSize, CLONE.data + offset);
+  }
+
+  return CLONE;
+}
+
+
+
+/* void destroyStoreArena(storeArena *ARENA):
+ * Destroys the stores of the arena, frees it in one call and leaves it
+ * uninitiated. Does nothing for an uninitiated arena.
+ */
+void destroyStoreArena(storeArena *ARENA){
+  if (ARENA == NULL || ARENA->stores == NULL)
+    return;
+
+  for (unsigned index = 0; index < ARENA->totalStores; index++)
+    destroyStore(&ARENA->stores[index]);
+  free(ARENA->stores);
+
+  *ARENA = (storeArena){0};
+}
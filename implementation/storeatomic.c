@@ -0,0 +1,306 @@
+#include "store/storeatomic.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "packedbits.h"
+
+#define ERROR_MESSAGE(location,reason,reaction) ("\nin " location ":\n"\
+                                                 reason ", " reaction "\n")
+
+/* struct atomicWord:
+ * Where a word lies: its 8 byte aligned unit, 'shift' the position of its
+ * least significant bit in the unit read as a big endian number, and
+ * 'mask' its bits there.
+ */
+struct atomicWord{
+  uint64_t *unit;
+  unsigned shift;
+  uint64_t mask;
+};
+
+
+
+/* int findAtomicWord(const store *STORE, const uint64_t location,
+                      const bool writing, struct atomicWord *word):
+ * Checks whether the word at location of the store can be accessed
+ * atomically, see storeatomic.h, and fills word with where it lies.
+ * Returns 0 if so, else -1.
+ */
+static int findAtomicWord(const store *STORE, const uint64_t location,
+                          const bool writing, struct atomicWord *word){
+  if (STORE_CHECK_FAILS(!STORE->set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("findAtomicWord", "STORE not initialized",
+                                   "returning -1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(STORE->kind == MATRIX_STORE)){
+    reportStoreError(STORE_WRONG_KIND,
+                     ERROR_MESSAGE("findAtomicWord",
+                                   "words of a matrix store are not atomic",
+                                   "returning -1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(location >= STORE->totalLocations)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("findAtomicWord",
+                                   "location %"PRIu64" out of bound",
+                                   "returning -1"), location);
+    return -1;
+  }
+
+  uint64_t bit = location * STORE->wordSize;
+  if (STORE_CHECK_FAILS(STORE->wordSize == 0 ||
+                        bit % 64 + STORE->wordSize > 64)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("findAtomicWord",
+                                   "word at location %"PRIu64" crosses an "
+                                   "8 byte unit", "returning -1"), location);
+    return -1;
+  }
+
+  uint64_t availableBytes;
+  word->unit = writing ?
+               (uint64_t*)storeBytesforWrite(STORE, bit / 64 * 8,
+                                             &availableBytes) :
+               (uint64_t*)storeBytesforRead(STORE, bit / 64 * 8,
+                                            &availableBytes);
+  if (word->unit == NULL){
+    reportStoreError(STORE_WRITE_FAILED,
+                     ERROR_MESSAGE("findAtomicWord",
+                                   "store read only or page not allocated",
+                                   "returning -1"));
+    return -1;
+  }
+  word->shift = 64 - bit % 64 - STORE->wordSize;
+  word->mask = widthMask(STORE->wordSize);
+
+  return 0;
+}
+
+
+
+/* uint64_t wordofUnit(const struct atomicWord *word, uint64_t unit):
+ * Returns the word held in a value loaded from its unit.
+ */
+static inline uint64_t wordofUnit(const struct atomicWord *word,
+                                  uint64_t unit){
+  return (swapBigEndian64(unit) >> word->shift) & word->mask;
+}
+
+
+
+/* uint64_t unitwithWord(const struct atomicWord *word, uint64_t unit,
+                         uint64_t number):
+ * Returns a value loaded from the unit of word with the word replaced by
+ * lowest bits of number.
+ */
+static inline uint64_t unitwithWord(const struct atomicWord *word,
+                                    uint64_t unit, uint64_t number){
+  return swapBigEndian64((swapBigEndian64(unit) &
+                          ~(word->mask << word->shift)) |
+                         ((number & word->mask) << word->shift));
+}
+
+
+
+/* void recordAtomicAccess(const store *STORE, uint64_t location,
+                           uint64_t number, bool writing):
+ * Records the word read or written at location if the store is traced.
+ */
+static inline void recordAtomicAccess(const store *STORE, uint64_t location,
+                                      uint64_t number, bool writing){
+  if (storeTracesAccesses(STORE))
+    recordStoreAccess(STORE, location * STORE->wordSize, STORE->wordSize,
+                      number, writing);
+}
+
+
+
+/* uint64_t loadAcquirefromStore(const store STORE,
+                                 const uint64_t location):
+ * Returns the word at location, read with acquire ordering, or 0 if it
+ * can't be accessed atomically.
+ */
+uint64_t loadAcquirefromStore(const store STORE, const uint64_t location){
+  struct atomicWord word;
+  if (findAtomicWord(&STORE, location, false, &word)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("loadAcquirefromStore",
+                                   "findAtomicWord returned -1",
+                                   "returning 0"));
+    return 0;
+  }
+
+  uint64_t number = wordofUnit(&word, __atomic_load_n(word.unit,
+                                                      __ATOMIC_ACQUIRE));
+  recordAtomicAccess(&STORE, location, number, false);
+
+  return number;
+}
+
+
+
+/* int storeReleasetoStore(store STORE, const uint64_t location,
+                           const uint64_t number):
+ * Writes lowest wordSize bits of number as the word at location with
+ * release ordering.
+ * Returns 0 if written, else -1.
+ */
+int storeReleasetoStore(store STORE, const uint64_t location,
+                        const uint64_t number){
+  struct atomicWord word;
+  if (findAtomicWord(&STORE, location, true, &word)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("storeReleasetoStore",
+                                   "findAtomicWord returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  recordAtomicAccess(&STORE, location, number, true);
+  if (STORE.wordSize == 64){
+    __atomic_store_n(word.unit, unitwithWord(&word, 0, number),
+                     __ATOMIC_RELEASE);
+    return 0;
+  }
+
+  uint64_t unit = __atomic_load_n(word.unit, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(word.unit, &unit,
+                                      unitwithWord(&word, unit, number),
+                                      true, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+    ;
+
+  return 0;
+}
+
+
+
+/* int compareAndSwapinStore(store STORE, const uint64_t location,
+                             uint64_t *expected, const uint64_t desired):
+ * Replaces the word at location with lowest wordSize bits of desired if it
+ * equals *expected, else stores the word in *expected, atomically and
+ * sequentially consistent.
+ * Returns 1 if replaced, 0 if not, -1 if the word can't be accessed
+ * atomically.
+ */
+int compareAndSwapinStore(store STORE, const uint64_t location,
+                          uint64_t *expected, const uint64_t desired){
+  struct atomicWord word;
+  if (findAtomicWord(&STORE, location, true, &word)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("compareAndSwapinStore",
+                                   "findAtomicWord returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint64_t unit = __atomic_load_n(word.unit, __ATOMIC_RELAXED);
+  /* the unit may change outside the word, retry till the word itself is
+   * found different or the swap succeeds.*/
+  while (wordofUnit(&word, unit) == (*expected & word.mask)){
+    if (__atomic_compare_exchange_n(word.unit, &unit,
+                                    unitwithWord(&word, unit, desired),
+                                    false, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_SEQ_CST)){
+      recordAtomicAccess(&STORE, location, desired, true);
+      return 1;
+    }
+  }
+
+  *expected = wordofUnit(&word, unit);
+  recordAtomicAccess(&STORE, location, *expected, false);
+  return 0;
+}
+
+
+
+/* uint64_t applyOperation(const atomicOperation operation, uint64_t value,
+                           uint64_t operand, unsigned wordSize):
+ * Returns result of operation between word value and operand, bits above
+ * wordSize ignored, or value unchanged for an unknown operation.
+ */
+static uint64_t applyOperation(const atomicOperation operation,
+                               uint64_t value, uint64_t operand,
+                               unsigned wordSize){
+  uint64_t mask = widthMask(wordSize);
+  uint64_t sign = (uint64_t)1 << (wordSize - 1);
+  value &= mask;
+  operand &= mask;
+
+  switch (operation){
+    case ATOMIC_ADD:
+      return value + operand;
+    case ATOMIC_AND:
+      return value & operand;
+    case ATOMIC_OR:
+      return value | operand;
+    case ATOMIC_XOR:
+      return value ^ operand;
+    case ATOMIC_MIN:
+      return ((value ^ sign) < (operand ^ sign)) ? value : operand;
+    case ATOMIC_MAX:
+      return ((value ^ sign) > (operand ^ sign)) ? value : operand;
+    case ATOMIC_MIN_UNSIGNED:
+      return (value < operand) ? value : operand;
+    case ATOMIC_MAX_UNSIGNED:
+      return (value > operand) ? value : operand;
+    case ATOMIC_SWAP:
+      return operand;
+  }
+
+  return value;
+}
+
+
+
+/* int fetchAndOperateinStore(store STORE, const uint64_t location,
+                              const atomicOperation operation,
+                              const uint64_t operand, uint64_t *previous):
+ * Replaces the word at location with the result of operation between it
+ * and operand, atomically and sequentially consistent, storing the word it
+ * held before in *previous if not NULL, as an AMO instruction.
+ * Returns 0 if done, else -1, e.g. for an operation that is not an
+ * atomicOperation.
+ */
+int fetchAndOperateinStore(store STORE, const uint64_t location,
+                           const atomicOperation operation,
+                           const uint64_t operand, uint64_t *previous){
+  if (STORE_CHECK_FAILS((unsigned)operation > ATOMIC_SWAP)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("fetchAndOperateinStore",
+                                   "unknown operation %u",
+                                   "returning -1"), (unsigned)operation);
+    return -1;
+  }
+
+  struct atomicWord word;
+  if (findAtomicWord(&STORE, location, true, &word)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("fetchAndOperateinStore",
+                                   "findAtomicWord returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint64_t unit = __atomic_load_n(word.unit, __ATOMIC_RELAXED);
+  uint64_t value, result;
+  do{
+    value = wordofUnit(&word, unit);
+    result = applyOperation(operation, value, operand, STORE.wordSize);
+  }while (!__atomic_compare_exchange_n(word.unit, &unit,
+                                       unitwithWord(&word, unit, result),
+                                       true, __ATOMIC_SEQ_CST,
+                                       __ATOMIC_RELAXED));
+  recordAtomicAccess(&STORE, location, result, true);
+
+  if (previous != NULL)
+    *previous = value;
+
+  return 0;
+}
@@ -0,0 +1,324 @@
+#include "store/storeblock.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "packedbits.h"
+
+#define ERROR_MESSAGE(location,reason,reaction) ("\nin " location ":\n"\
+                                                 reason ", " reaction "\n")
+
+/* bytes moved per step when going through an intermediate buffer. */
+#define BLOCK_CHUNK_BYTES 4096
+
+
+
+/* int checkBlock(const store STORE, const uint64_t location,
+                  const uint64_t totalLocations):
+ * Checks whether store is initialized and the range of totalLocations
+ * locations from location lies inside it.
+ * Returns 0 if so, else -1.
+ */
+static int checkBlock(const store STORE, const uint64_t location,
+                      const uint64_t totalLocations){
+  if (STORE_CHECK_FAILS(!STORE.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("checkBlock", "STORE not initialized",
+                                   "returning -1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(location > STORE.totalLocations ||
+                        totalLocations > STORE.totalLocations - location)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("checkBlock",
+                                   "Requested block from location %"PRIu64
+                                   " of %"PRIu64" locations out of bound",
+                                   "returning -1"), location, totalLocations);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int writeBitsfromBuffer(const store *STORE, uint64_t bit,
+                           const uint8_t *buffer, uint64_t totalBits):
+ * Copies totalBits packed bits of buffer to the store from its packed bit
+ * 'bit' on. Whole bytes are copied page by page with memcpy when 'bit'
+ * falls on a byte, else, or if the store is traced, the bits are moved 56
+ * at a time.
+ * Returns 0, or -1 if the store is read only or a page can't be allocated.
+ */
+static int writeBitsfromBuffer(const store *STORE, uint64_t bit,
+                               const uint8_t *buffer, uint64_t totalBits){
+  uint64_t bufferBytes = (totalBits + 7) / 8;
+  uint64_t done = 0;
+
+  if (STORE->kind != MATRIX_STORE && !storeTracesAccesses(STORE) &&
+      bit % 8 == 0){
+    while (done + 8 <= totalBits){
+      uint64_t availableBytes;
+      uint8_t *bytes = storeBytesforWrite(STORE, (bit + done) / 8,
+                                          &availableBytes);
+      if (bytes == NULL)
+        return -1;
+      uint64_t chunk = (totalBits - done) / 8;
+      if (chunk > availableBytes)
+        chunk = availableBytes;
+      memcpy(bytes, buffer + done / 8, chunk);
+      done += chunk * 8;
+    }
+  }
+
+  while (done < totalBits){
+    unsigned width = (totalBits - done < 56) ? totalBits - done : 56;
+    uint64_t value = readPackedBits(buffer + done / 8,
+                                    bufferBytes - done / 8, done % 8, width);
+    if (writeStoreBits(STORE, bit + done, width, value))
+      return -1;
+    done += width;
+  }
+
+  return 0;
+}
+
+
+
+/* void readBitsintoBuffer(const store *STORE, uint64_t bit, uint8_t *buffer,
+                           uint64_t totalBits):
+ * Copies totalBits packed bits of the store from its packed bit 'bit' on
+ * to buffer, the same way as writeBitsfromBuffer. Bits of the last byte of
+ * buffer after totalBits are left untouched.
+ */
+static void readBitsintoBuffer(const store *STORE, uint64_t bit,
+                               uint8_t *buffer, uint64_t totalBits){
+  uint64_t bufferBytes = (totalBits + 7) / 8;
+  uint64_t done = 0;
+
+  if (STORE->kind != MATRIX_STORE && !storeTracesAccesses(STORE) &&
+      bit % 8 == 0){
+    while (done + 8 <= totalBits){
+      uint64_t availableBytes;
+      const uint8_t *bytes = storeBytesforRead(STORE, (bit + done) / 8,
+                                               &availableBytes);
+      uint64_t chunk = (totalBits - done) / 8;
+      if (chunk > availableBytes)
+        chunk = availableBytes;
+      memcpy(buffer + done / 8, bytes, chunk);
+      done += chunk * 8;
+    }
+  }
+
+  while (done < totalBits){
+    unsigned width = (totalBits - done < 56) ? totalBits - done : 56;
+    uint64_t value = readStoreBits(STORE, bit + done, width);
+    writePackedBits(buffer + done / 8, bufferBytes - done / 8, done % 8,
+                    width, value);
+    done += width;
+  }
+}
+
+
+
+/* int writeBlocktoStore(store STORE, const uint64_t location,
+                         const uint64_t totalLocations, const void *buffer):
+ * Takes store object, first location of the block, number of locations in
+ * the block and host buffer holding their packed bits, see storeblock.h.
+ * Copies the buffer into the block, at memcpy speed when the block starts
+ * on a byte of a packed kind of store.
+ * Returns 0 if written, else -1.
+ */
+int writeBlocktoStore(store STORE, const uint64_t location,
+                      const uint64_t totalLocations, const void *buffer){
+  if (checkBlock(STORE, location, totalLocations)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("writeBlocktoStore",
+                                   "checkBlock returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  if (writeBitsfromBuffer(&STORE, location * STORE.wordSize, buffer,
+                          totalLocations * STORE.wordSize)){
+    reportStoreError(STORE_WRITE_FAILED,
+                     ERROR_MESSAGE("writeBlocktoStore",
+                                   "store read only or page not allocated",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int readBlockfromStore(const store STORE, const uint64_t location,
+                          const uint64_t totalLocations, void *buffer):
+ * Same as writeBlocktoStore, but copies the block into the buffer.
+ * Returns 0 if read, else -1.
+ */
+int readBlockfromStore(const store STORE, const uint64_t location,
+                       const uint64_t totalLocations, void *buffer){
+  if (checkBlock(STORE, location, totalLocations)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("readBlockfromStore",
+                                   "checkBlock returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  readBitsintoBuffer(&STORE, location * STORE.wordSize, buffer,
+                     totalLocations * STORE.wordSize);
+
+  return 0;
+}
+
+
+
+/* int fillBlockinStore(store STORE, const uint64_t location,
+                        const uint64_t totalLocations, const uint64_t number):
+ * Writes number in every word of the block, as writeNumBitstoStore with
+ * the whole word would: higher bits of number are dropped when the word is
+ * smaller than 64 bits, leading bits of a wider word are zeroed.
+ * The pattern is built once in a buffer and copied block by block.
+ * Returns 0 if written, else -1.
+ */
+int fillBlockinStore(store STORE, const uint64_t location,
+                     const uint64_t totalLocations, const uint64_t number){
+  if (checkBlock(STORE, location, totalLocations)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("fillBlockinStore", "checkBlock returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+  if (totalLocations == 0)
+    return 0;
+
+  /* 8 words always fill whole bytes, so the pattern repeats byte wise
+   * over a multiple of 8 words.*/
+  uint64_t wordSize = STORE.wordSize;
+  uint64_t patternWords = (wordSize < BLOCK_CHUNK_BYTES) ?
+                          8 * (BLOCK_CHUNK_BYTES / wordSize) : 8;
+  /* short fills build only the words they write.*/
+  if (patternWords > (totalLocations + 7) / 8 * 8)
+    patternWords = (totalLocations + 7) / 8 * 8;
+  uint8_t pattern[BLOCK_CHUNK_BYTES];
+
+  if (patternWords * wordSize / 8 > sizeof(pattern)){
+    /* a single word is wider than the buffer, all its bits but the last
+     * 64 are zero.*/
+    for (uint64_t word = 0; word < totalLocations; word++){
+      uint64_t bit = (location + word) * wordSize;
+      for (uint64_t done = 0; done + 64 < wordSize; done += 64){
+        unsigned width = (wordSize - 64 - done < 64) ?
+                         wordSize - 64 - done : 64;
+        if (writeStoreBits(&STORE, bit + done, width, 0))
+          goto writeFailed;
+      }
+      if (writeStoreBits(&STORE, bit + wordSize - 64, 64, number))
+        goto writeFailed;
+    }
+    return 0;
+  }
+
+  memset(pattern, 0, sizeof(pattern));
+  for (uint64_t word = 0; word < patternWords; word++){
+    uint64_t bit = word * wordSize;
+    unsigned width = (wordSize < 64) ? wordSize : 64;
+    uint64_t fieldBit = bit + wordSize - width;
+    writePackedBits(pattern + fieldBit / 8,
+                    sizeof(pattern) - fieldBit / 8, fieldBit % 8,
+                    width, number);
+  }
+
+  uint64_t done = 0;
+  while (done < totalLocations){
+    uint64_t words = (totalLocations - done < patternWords) ?
+                     totalLocations - done : patternWords;
+    if (writeBitsfromBuffer(&STORE, (location + done) * wordSize, pattern,
+                            words * wordSize))
+      goto writeFailed;
+    done += words;
+  }
+
+  return 0;
+
+writeFailed:
+  reportStoreError(STORE_WRITE_FAILED,
+                   ERROR_MESSAGE("fillBlockinStore",
+                                 "store read only or page not allocated",
+                                 "returning -1"));
+  return -1;
+}
+
+
+
+/* int copyBlockbetweenStores(store destination,
+                              const uint64_t destinationLocation,
+                              const store source,
+                              const uint64_t sourceLocation,
+                              const uint64_t totalLocations):
+ * Copies totalLocations words from sourceLocation of source to
+ * destinationLocation of destination, both stores must have the same
+ * wordSize. Source and destination may be the same store with overlapping
+ * blocks, the copy is done as if through an intermediate buffer, as
+ * memmove does.
+ * Returns 0 if copied, else -1.
+ */
+int copyBlockbetweenStores(store destination,
+                           const uint64_t destinationLocation,
+                           const store source, const uint64_t sourceLocation,
+                           const uint64_t totalLocations){
+  if (checkBlock(destination, destinationLocation, totalLocations) ||
+      checkBlock(source, sourceLocation, totalLocations)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("copyBlockbetweenStores",
+                                   "checkBlock returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(destination.wordSize != source.wordSize)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("copyBlockbetweenStores",
+                                   "wordSize of the stores differ",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint64_t wordSize = source.wordSize;
+  uint64_t totalBits = totalLocations * wordSize;
+  uint64_t sourceBit = sourceLocation * wordSize;
+  uint64_t destinationBit = destinationLocation * wordSize;
+  bool sameData = (destination.matrix == source.matrix &&
+                   destination.words == source.words &&
+                   destination.pages == source.pages);
+  /* copying back to front keeps overlapping source bits unread till they
+   * are copied when the block moves up in the same store.*/
+  bool backwards = sameData && destinationBit > sourceBit;
+  uint8_t chunk[BLOCK_CHUNK_BYTES];
+  uint64_t done = 0;
+
+  while (done < totalBits){
+    uint64_t bits = (totalBits - done < 8 * sizeof(chunk)) ?
+                    totalBits - done : 8 * sizeof(chunk);
+    uint64_t offset = backwards ? totalBits - done - bits : done;
+    readBitsintoBuffer(&source, sourceBit + offset, chunk, bits);
+    if (writeBitsfromBuffer(&destination, destinationBit + offset, chunk,
+                            bits)){
+      reportStoreError(STORE_WRITE_FAILED,
+                       ERROR_MESSAGE("copyBlockbetweenStores",
+                                     "store read only or page not allocated",
+                                     "returning -1"));
+      return -1;
+    }
+    done += bits;
+  }
+
+  return 0;
+}
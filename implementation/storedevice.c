@@ -0,0 +1,202 @@
+#include "store/storedevice.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "deviceranges.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+/* most pages of locations in the map of a store, 8 KiB of bits.*/
+#define MAX_DEVICE_PAGES ((uint64_t)1 << 16)
+
+
+
+/* struct storeDeviceTable *createDeviceTable(uint64_t totalLocations):
+ * Returns an empty table for a store of totalLocations locations, its
+ * pages as small as MAX_DEVICE_PAGES allows, or NULL if allocation fails.
+ */
+static struct storeDeviceTable *createDeviceTable(uint64_t totalLocations){
+  unsigned pageShift = 0;
+  while (((totalLocations - 1) >> pageShift) >= MAX_DEVICE_PAGES)
+    pageShift++;
+
+  uint64_t totalPages = ((totalLocations - 1) >> pageShift) + 1;
+  struct storeDeviceTable *devices = calloc(1, sizeof(*devices) +
+                                            (totalPages + 63) / 64 *
+                                            sizeof(uint64_t));
+  if (devices == NULL)
+    return NULL;
+
+  devices->pageShift = pageShift;
+  devices->totalPages = totalPages;
+  return devices;
+}
+
+
+
+/* void markDevicePages(struct storeDeviceTable *devices):
+ * Sets the bits of the pages holding locations of a range, clearing the
+ * others.
+ */
+static void markDevicePages(struct storeDeviceTable *devices){
+  memset(devices->pages, 0, (devices->totalPages + 63) / 64 *
+                            sizeof(uint64_t));
+  for (uint64_t index = 0; index < devices->totalRanges; index++){
+    const struct deviceRange *range = &devices->ranges[index];
+    uint64_t lastPage = (range->firstLocation + range->totalLocations - 1) >>
+                        devices->pageShift;
+    for (uint64_t page = range->firstLocation >> devices->pageShift;
+         page <= lastPage; page++)
+      devices->pages[page / 64] |= (uint64_t)1 << (page % 64);
+  }
+}
+
+
+
+/* int attachDevicetoStore(store *STORE, const uint64_t firstLocation,
+                           const uint64_t totalLocations,
+                           storeDeviceRead read, storeDeviceWrite write,
+                           void *context):
+ * Takes initialized store and a range of its locations holding no device
+ * yet, and makes byte accesses lying wholly inside the range call read or
+ * write with context, see storedevice.h; one running out of it fails with
+ * STORE_INVALID_ARGUMENT. One of the handlers may be NULL, to leave such
+ * accesses to the store.
+ * Returns 0, or -1 if the range is empty, out of the store or overlaps a
+ * device, both handlers are NULL, or allocation fails.
+ */
+int attachDevicetoStore(store *STORE, const uint64_t firstLocation,
+                        const uint64_t totalLocations, storeDeviceRead read,
+                        storeDeviceWrite write, void *context){
+  if (STORE_CHECK_FAILS(!STORE->set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("attachDevicetoStore",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(totalLocations == 0 ||
+                        firstLocation >= STORE->totalLocations ||
+                        totalLocations > STORE->totalLocations -
+                                         firstLocation)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("attachDevicetoStore",
+                                   "range of %"PRIu64" locations from %"PRIu64
+                                   " is empty or out of the store", "-1"),
+                     totalLocations, firstLocation);
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(read == NULL && write == NULL)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("attachDevicetoStore",
+                                   "device has no handler", "-1"));
+    return -1;
+  }
+
+  if (STORE->devices == NULL){
+    STORE->devices = createDeviceTable(STORE->totalLocations);
+    if (STORE->devices == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("attachDevicetoStore",
+                                     "unable to allocate device table",
+                                     "-1"));
+      return -1;
+    }
+  }
+  struct storeDeviceTable *devices = STORE->devices;
+
+  /* ranges before the new one, the one after must start past its end.*/
+  uint64_t index = 0;
+  while (index < devices->totalRanges &&
+         devices->ranges[index].firstLocation < firstLocation)
+    index++;
+  const struct deviceRange *before = index ? &devices->ranges[index - 1] :
+                                             NULL;
+  if ((before != NULL &&
+       firstLocation - before->firstLocation < before->totalLocations) ||
+      (index < devices->totalRanges &&
+       devices->ranges[index].firstLocation - firstLocation <
+       totalLocations)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("attachDevicetoStore",
+                                   "range overlaps an attached device",
+                                   "-1"));
+    return -1;
+  }
+
+  if (devices->totalRanges == devices->maxRanges){
+    uint64_t maxRanges = devices->maxRanges ? 2 * devices->maxRanges : 4;
+    struct deviceRange *ranges = realloc(devices->ranges, maxRanges *
+                                         sizeof(struct deviceRange));
+    if (ranges == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("attachDevicetoStore",
+                                     "unable to grow device ranges", "-1"));
+      return -1;
+    }
+    devices->ranges = ranges;
+    devices->maxRanges = maxRanges;
+  }
+
+  memmove(&devices->ranges[index + 1], &devices->ranges[index],
+          (devices->totalRanges - index) * sizeof(struct deviceRange));
+  devices->ranges[index] = (struct deviceRange){firstLocation,
+                                                totalLocations, read, write,
+                                                context};
+  devices->totalRanges++;
+  markDevicePages(devices);
+
+  return 0;
+}
+
+
+
+/* int detachDevicefromStore(store *STORE, const uint64_t firstLocation):
+ * Detaches the device whose range starts at firstLocation, accesses of
+ * the range reach the store again.
+ * Returns 0, or -1 if no device range starts there.
+ */
+int detachDevicefromStore(store *STORE, const uint64_t firstLocation){
+  struct storeDeviceTable *devices = STORE->devices;
+  uint64_t index = 0;
+
+  while (devices != NULL && index < devices->totalRanges &&
+         devices->ranges[index].firstLocation != firstLocation)
+    index++;
+  if (devices == NULL || index == devices->totalRanges){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("detachDevicefromStore",
+                                   "no device attached at location %"PRIu64,
+                                   "-1"), firstLocation);
+    return -1;
+  }
+
+  devices->totalRanges--;
+  memmove(&devices->ranges[index], &devices->ranges[index + 1],
+          (devices->totalRanges - index) * sizeof(struct deviceRange));
+  markDevicePages(devices);
+
+  return 0;
+}
+
+
+
+/* void detachAllDevicesfromStore(store *STORE):
+ * Detaches every device of the store and frees its table.
+ */
+void detachAllDevicesfromStore(store *STORE){
+  if (STORE->devices == NULL)
+    return;
+
+  free(STORE->devices->ranges);
+  free(STORE->devices);
+  STORE->devices = NULL;
+}
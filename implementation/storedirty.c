@@ -0,0 +1,317 @@
+#include "store/storedirty.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "dirtypages.h"
+#include "packedbits.h"
+#include "snapshotpages.h"
+#include "storepages.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+#define PAGE_BITS (STORE_PAGE_BYTES * 8)
+
+/* Pages are compared DIFF_CHUNK_BYTES at a time with the vector extensions
+ * of GCC and Clang, in the widest registers enabled for the build, and
+ * only chunks found different are searched for their locations.
+ */
+#if defined(__GNUC__)
+#if defined(__AVX512BW__)
+#define DIFF_CHUNK_BYTES 64
+#elif defined(__AVX2__)
+#define DIFF_CHUNK_BYTES 32
+#else
+#define DIFF_CHUNK_BYTES 16
+#endif
+typedef uint64_t diffLanes __attribute__((vector_size(DIFF_CHUNK_BYTES)));
+#else
+#define DIFF_CHUNK_BYTES 8
+#endif
+
+
+
+/* uint64_t totalPagesofStore(const store *STORE):
+ * Returns number of pages of STORE_PAGE_BYTES bytes the packed bits of the
+ * store take.
+ */
+static uint64_t totalPagesofStore(const store *STORE){
+  uint64_t totalBytes = (STORE->totalLocations * STORE->wordSize + 7) / 8;
+  return (totalBytes + STORE_PAGE_BYTES - 1) / STORE_PAGE_BYTES;
+}
+
+
+
+/* int trackDirtyPages(store *STORE):
+ * Takes initialized store and starts marking the pages written in it, all
+ * pages clean at first. Clears them if tracked already.
+ * Returns 0, or -1 if the store is not initialized or allocation fails.
+ */
+int trackDirtyPages(store *STORE){
+  if (STORE_CHECK_FAILS(!STORE->set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("trackDirtyPages",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+
+  if (STORE->dirty != NULL)
+    return clearDirtyPages(*STORE);
+
+  struct storeDirtyMap *dirty = malloc(sizeof(struct storeDirtyMap));
+  if (dirty == NULL ||
+      createPageBitmap(&dirty->pages, totalPagesofStore(STORE))){
+    free(dirty);
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("trackDirtyPages",
+                                   "unable to allocate dirty bitmap", "-1"));
+    return -1;
+  }
+
+  STORE->dirty = dirty;
+
+  return 0;
+}
+
+
+
+/* void stopTrackingDirtyPages(store *STORE):
+ * Frees the dirty bitmap of the store. Does nothing if it has none.
+ * Called by destroyStore.
+ */
+void stopTrackingDirtyPages(store *STORE){
+  if (STORE->dirty != NULL)
+    destroyPageBitmap(&STORE->dirty->pages);
+  free(STORE->dirty);
+  STORE->dirty = NULL;
+}
+
+
+
+/* int clearDirtyPages(const store STORE):
+ * Marks every page of a store tracking dirty pages clean, in time
+ * proportional to the pages dirty.
+ * Returns 0, or -1 if the store doesn't track them.
+ */
+int clearDirtyPages(const store STORE){
+  if (STORE_CHECK_FAILS(!STORE.set || STORE.dirty == NULL)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("clearDirtyPages",
+                                   "store doesn't track dirty pages", "-1"));
+    return -1;
+  }
+
+  clearPageBitmap(&STORE.dirty->pages);
+
+  return 0;
+}
+
+
+
+/* int nextDirtyRange(const store STORE, const uint64_t location,
+                      uint64_t *firstLocation, uint64_t *totalLocations):
+ * Finds the first range of locations of dirty pages following each other,
+ * from the page holding location on, stores its first location (never
+ * before location) and length in firstLocation and totalLocations.
+ * Walk all ranges by calling it again from firstLocation + totalLocations.
+ * Returns 1 if found, 0 if no page is dirty past location, -1 if the store
+ * doesn't track dirty pages.
+ */
+int nextDirtyRange(const store STORE, const uint64_t location,
+                   uint64_t *firstLocation, uint64_t *totalLocations){
+  if (STORE_CHECK_FAILS(!STORE.set || STORE.dirty == NULL)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("nextDirtyRange",
+                                   "store doesn't track dirty pages", "-1"));
+    return -1;
+  }
+
+  if (location >= STORE.totalLocations || STORE.wordSize == 0)
+    return 0;
+
+  uint64_t totalBits = STORE.totalLocations * STORE.wordSize;
+  const struct pageBitmap *pages = &STORE.dirty->pages;
+  uint64_t first = nextMarkedPage(pages, location * STORE.wordSize /
+                                         PAGE_BITS);
+  if (first == pages->totalPages)
+    return 0;
+  uint64_t end = nextUnmarkedPage(pages, first + 1);
+
+  uint64_t endBit = (end * PAGE_BITS < totalBits) ? end * PAGE_BITS :
+                                                    totalBits;
+  uint64_t start = first * PAGE_BITS / STORE.wordSize;
+  if (start < location)
+    start = location;
+  *firstLocation = start;
+  *totalLocations = (endBit + STORE.wordSize - 1) / STORE.wordSize - start;
+
+  return 1;
+}
+
+
+
+/* const uint8_t *pageforDiff(const store *STORE, uint64_t pageNumber,
+                              uint8_t *buffer):
+ * Returns the packed bits of the page, in place or gathered in buffer of
+ * STORE_PAGE_BYTES bytes for a MATRIX_STORE.
+ */
+static const uint8_t *pageforDiff(const store *STORE, uint64_t pageNumber,
+                                  uint8_t *buffer){
+  if (STORE->kind == MATRIX_STORE){
+    copyPageoutofStore(STORE, pageNumber, buffer);
+    return buffer;
+  }
+
+  uint64_t availableBytes;
+  return storeBytesforRead(STORE, pageNumber * STORE_PAGE_BYTES,
+                           &availableBytes);
+}
+
+
+
+/* uint64_t firstDifferingChunk(const uint8_t *bytes1,
+                                const uint8_t *bytes2, uint64_t totalBytes,
+                                uint64_t done):
+ * Returns offset from 'done' on of the first chunk of DIFF_CHUNK_BYTES
+ * bytes differing between bytes1 and bytes2, or of the last partial chunk
+ * if all whole chunks are equal.
+ */
+static uint64_t firstDifferingChunk(const uint8_t *bytes1,
+                                    const uint8_t *bytes2,
+                                    uint64_t totalBytes, uint64_t done){
+  for (; done + DIFF_CHUNK_BYTES <= totalBytes; done += DIFF_CHUNK_BYTES){
+#if defined(__GNUC__)
+    diffLanes x, y;
+    memcpy(&x, bytes1 + done, sizeof(x));
+    memcpy(&y, bytes2 + done, sizeof(y));
+    x ^= y;
+    uint64_t any = 0;
+    for (unsigned lane = 0; lane < sizeof(x) / sizeof(x[0]); lane++)
+      any |= x[lane];
+#else
+    uint64_t any = loadBigEndian64(bytes1 + done) ^
+                   loadBigEndian64(bytes2 + done);
+#endif
+    if (any != 0)
+      break;
+  }
+
+  return done;
+}
+
+
+
+/* int64_t diffUnits(const uint8_t *bytes1, const uint8_t *bytes2,
+                     uint64_t totalBytes, uint64_t firstBit,
+                     const store *STORE, uint64_t locations[],
+                     int64_t found, const uint64_t maxLocations,
+                     uint64_t *lastLocation):
+ * Appends to locations, from index found on, every location having a bit
+ * differing in the totalBytes (at most 8 times a whole number) bytes
+ * compared, bit firstBit of the store being their first bit, skipping
+ * lastLocation, the one appended last.
+ * Returns the new number of locations found, at most maxLocations.
+ */
+static int64_t diffUnits(const uint8_t *bytes1, const uint8_t *bytes2,
+                         uint64_t totalBytes, uint64_t firstBit,
+                         const store *STORE, uint64_t locations[],
+                         int64_t found, const uint64_t maxLocations,
+                         uint64_t *lastLocation){
+  for (uint64_t done = 0; done < totalBytes; done += 8){
+    uint64_t unitBytes = (totalBytes - done < 8) ? totalBytes - done : 8;
+    uint64_t difference = loadBigEndianBytes(bytes1 + done, unitBytes) ^
+                          loadBigEndianBytes(bytes2 + done, unitBytes);
+    difference <<= 64 - 8 * unitBytes;
+    uint64_t unitBit = firstBit + 8 * done;
+
+    while (difference != 0 && (uint64_t)found < maxLocations){
+      uint64_t bit = unitBit + __builtin_clzll(difference);
+      uint64_t location = bit / STORE->wordSize;
+      if (location >= STORE->totalLocations)
+        return found;
+      if (location != *lastLocation){
+        locations[found++] = location;
+        *lastLocation = location;
+      }
+      uint64_t endBit = (location + 1) * STORE->wordSize - unitBit;
+      difference = (endBit >= 64) ? 0 : difference & (~(uint64_t)0 >> endBit);
+    }
+  }
+
+  return found;
+}
+
+
+
+/* int64_t diffStores(const store first, const store second,
+                      uint64_t locations[], const uint64_t maxLocations):
+ * Takes two stores of the same geometry, of any kinds, and stores in
+ * locations, in increasing order, the locations whose words differ
+ * between them, stopping at maxLocations. If both track dirty pages, only
+ * pages dirty in either are compared, so clear them when the stores are
+ * known equal; else whole stores are compared.
+ * Returns number of locations stored, or -1 if the stores don't match.
+ */
+int64_t diffStores(const store first, const store second,
+                   uint64_t locations[], const uint64_t maxLocations){
+  if (STORE_CHECK_FAILS(!first.set || !second.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("diffStores",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+
+  if (STORE_CHECK_FAILS(first.wordSize != second.wordSize ||
+                        first.totalLocations != second.totalLocations)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("diffStores",
+                                   "geometries of the stores differ", "-1"));
+    return -1;
+  }
+
+  bool onlyDirty = (first.dirty != NULL && second.dirty != NULL);
+  uint64_t totalBytes = (first.totalLocations * first.wordSize + 7) / 8;
+  uint64_t totalPages = totalPagesofStore(&first);
+  uint64_t lastLocation = UINT64_MAX;
+  uint8_t buffer1[STORE_PAGE_BYTES], buffer2[STORE_PAGE_BYTES];
+  int64_t found = 0;
+
+  for (uint64_t page = 0; page < totalPages &&
+                          (uint64_t)found < maxLocations; page++){
+    if (onlyDirty){
+      uint64_t firstDirty = nextMarkedPage(&first.dirty->pages, page);
+      uint64_t secondDirty = nextMarkedPage(&second.dirty->pages, page);
+      page = (firstDirty < secondDirty) ? firstDirty : secondDirty;
+      if (page == totalPages)
+        break;
+    }
+
+    const uint8_t *bytes1 = pageforDiff(&first, page, buffer1);
+    const uint8_t *bytes2 = pageforDiff(&second, page, buffer2);
+    uint64_t pageBytes = totalBytes - page * STORE_PAGE_BYTES;
+    if (pageBytes > STORE_PAGE_BYTES)
+      pageBytes = STORE_PAGE_BYTES;
+
+    uint64_t done = 0;
+    while (done < pageBytes && (uint64_t)found < maxLocations){
+      done = firstDifferingChunk(bytes1, bytes2, pageBytes, done);
+      uint64_t chunk = (pageBytes - done < DIFF_CHUNK_BYTES) ?
+                       pageBytes - done : DIFF_CHUNK_BYTES;
+      found = diffUnits(bytes1 + done, bytes2 + done, chunk,
+                        page * PAGE_BITS + 8 * done, &first, locations,
+                        found, maxLocations, &lastLocation);
+      done += chunk;
+    }
+  }
+
+  return found;
+}
@@ -0,0 +1,98 @@
+#include "store/storeerror.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+/* longest message passed to the handler, longer ones are cut. */
+#define MESSAGE_LENGTH 256
+
+static _Thread_local storeError threadError = STORE_OK;
+static storeErrorHandler errorHandler = NULL;
+static void *errorContext = NULL;
+
+
+
+/* storeError lastStoreError(void):
+ * Returns the error of the last failing call on this thread, STORE_OK if
+ * none since the thread started or clearStoreError.
+ */
+storeError lastStoreError(void){
+  return threadError;
+}
+
+
+
+/* void clearStoreError(void):
+ * Sets error of this thread back to STORE_OK.
+ */
+void clearStoreError(void){
+  threadError = STORE_OK;
+}
+
+
+
+/* const char *storeErrorName(storeError error):
+ * Returns name of the error as a constant string.
+ */
+const char *storeErrorName(storeError error){
+  switch (error){
+    case STORE_OK: return "STORE_OK";
+    case STORE_NOT_INITIALIZED: return "STORE_NOT_INITIALIZED";
+    case STORE_OUT_OF_BOUND: return "STORE_OUT_OF_BOUND";
+    case STORE_INVALID_ARGUMENT: return "STORE_INVALID_ARGUMENT";
+    case STORE_TRUNCATED: return "STORE_TRUNCATED";
+    case STORE_ALLOCATION_FAILED: return "STORE_ALLOCATION_FAILED";
+    case STORE_WRITE_FAILED: return "STORE_WRITE_FAILED";
+    case STORE_WRONG_KIND: return "STORE_WRONG_KIND";
+    case STORE_IO_FAILED: return "STORE_IO_FAILED";
+  }
+
+  return "unknown store error";
+}
+
+
+
+/* void setStoreErrorHandler(storeErrorHandler handler, void *context):
+ * Sets the callback to log errors with, NULL to log nothing, which is the
+ * default. context is passed back to every call of the handler.
+ */
+void setStoreErrorHandler(storeErrorHandler handler, void *context){
+  errorHandler = handler;
+  errorContext = context;
+}
+
+
+
+/* void printStoreError(storeError error, const char *message,
+                        void *context):
+ * Handler printing every message to stdout, as the library used to do
+ * before errors were reported through storeError.
+ */
+void printStoreError(storeError error, const char *message, void *context){
+  (void)error;
+  (void)context;
+  fputs(message, stdout);
+}
+
+
+
+/* void reportStoreError(storeError error, const char *format, ...):
+ * Used by the library to report an error: sets the error of this thread,
+ * and only if a handler is set, formats the printf style message and
+ * passes it to the handler. Failing calls cost no formatting or I/O
+ * otherwise.
+ */
+void reportStoreError(storeError error, const char *format, ...){
+  threadError = error;
+
+  if (errorHandler == NULL)
+    return;
+
+  char message[MESSAGE_LENGTH];
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(message, sizeof(message), format, arguments);
+  va_end(arguments);
+
+  errorHandler(error, message, errorContext);
+}
@@ -0,0 +1,375 @@
+#include "store/storefield.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+#include "store/storeblock.h"
+#include "store/storeerror.h"
+#include "store/storeutil.h"
+#include "packedbits.h"
+
+#define ERROR_MESSAGE(location,reason,reaction) ("\nin " location ":\n"\
+                                                 reason ", " reaction "\n")
+
+/* bytes of words read per step by extractFieldsfromBlock. */
+#define FIELD_CHUNK_BYTES 4096
+
+/* pext and pdep are used through functions built for BMI2 whatever the
+ * flags of the library, and only called once the CPU is known to have it.
+ */
+#if defined(__x86_64__) && defined(__GNUC__)
+#define FIELD_PEXT
+#include <immintrin.h>
+
+__attribute__((target("bmi2")))
+static uint64_t extractGroups(const fieldDescriptor *descriptor,
+                              uint64_t word){
+  uint64_t value = 0;
+  for (unsigned index = 0; index < descriptor->totalGroups; index++)
+    value |= _pext_u64(word, descriptor->groups[index].mask) <<
+             descriptor->groups[index].shift;
+  return value;
+}
+
+__attribute__((target("bmi2")))
+static uint64_t insertGroups(const fieldDescriptor *descriptor,
+                             uint64_t word, uint64_t value){
+  word &= ~descriptor->wordMask;
+  for (unsigned index = 0; index < descriptor->totalGroups; index++)
+    word |= _pdep_u64(value >> descriptor->groups[index].shift,
+                      descriptor->groups[index].mask);
+  return word;
+}
+
+/* bool cpuHasBMI2(void):
+ * Returns true if pext and pdep can be run on this CPU.
+ */
+static bool cpuHasBMI2(void){
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+}
+#endif
+
+
+
+/* int compileFieldDescriptor(fieldDescriptor *descriptor,
+                              const fieldFragment fragments[],
+                              const unsigned totalFragments,
+                              const unsigned valueShift,
+                              const bool signExtend):
+ * Takes the fragments of a field, most significant first (see
+ * storefield.h), number of zero bits below them in the value and whether
+ * the value is signed, and compiles them in descriptor.
+ * Returns 0, or -1 if there are no fragments or more than
+ * FIELD_MAX_FRAGMENTS, a fragment is not inside 64 bits, fragments overlap,
+ * or the value is wider than 64 bits.
+ */
+int compileFieldDescriptor(fieldDescriptor *descriptor,
+                           const fieldFragment fragments[],
+                           const unsigned totalFragments,
+                           const unsigned valueShift, const bool signExtend){
+  if (STORE_CHECK_FAILS(totalFragments == 0 ||
+                        totalFragments > FIELD_MAX_FRAGMENTS)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("compileFieldDescriptor",
+                                   "field needs 1 to %d fragments",
+                                   "returning -1"), FIELD_MAX_FRAGMENTS);
+    return -1;
+  }
+
+  fieldDescriptor compiled = {0};
+  unsigned width = valueShift;
+  for (unsigned index = 0; index < totalFragments; index++){
+    const fieldFragment fragment = fragments[index];
+    if (STORE_CHECK_FAILS(fragment.highBit > 63 ||
+                          fragment.lowBit > fragment.highBit)){
+      reportStoreError(STORE_INVALID_ARGUMENT,
+                       ERROR_MESSAGE("compileFieldDescriptor",
+                                     "fragment %u is not bits of a word",
+                                     "returning -1"), index);
+      return -1;
+    }
+    uint64_t mask = widthMask(fragment.highBit - fragment.lowBit + 1) <<
+                    fragment.lowBit;
+    if (STORE_CHECK_FAILS(compiled.wordMask & mask)){
+      reportStoreError(STORE_INVALID_ARGUMENT,
+                       ERROR_MESSAGE("compileFieldDescriptor",
+                                     "fragment %u overlaps another",
+                                     "returning -1"), index);
+      return -1;
+    }
+    compiled.wordMask |= mask;
+    width += fragment.highBit - fragment.lowBit + 1;
+    if (fragment.highBit > compiled.highestBit)
+      compiled.highestBit = fragment.highBit;
+  }
+  if (STORE_CHECK_FAILS(width > 64)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("compileFieldDescriptor",
+                                   "field of %u bits is wider than 64 bits",
+                                   "returning -1"), width);
+    return -1;
+  }
+
+  /* place fragments from the least significant one, a fragment joins the
+   * group of the one below it in the value if it's just above it in the
+   * word too.*/
+  unsigned shift = valueShift;
+  for (unsigned index = totalFragments; index-- > 0;){
+    const fieldFragment fragment = fragments[index];
+    unsigned fragmentWidth = fragment.highBit - fragment.lowBit + 1;
+    uint64_t mask = widthMask(fragmentWidth) << fragment.lowBit;
+
+    compiled.fragments[index].lowBit = fragment.lowBit;
+    compiled.fragments[index].width = fragmentWidth;
+    compiled.fragments[index].shift = shift;
+
+    if (index + 1 < totalFragments &&
+        fragments[index + 1].highBit < fragment.lowBit)
+      compiled.groups[compiled.totalGroups - 1].mask |= mask;
+    else{
+      compiled.groups[compiled.totalGroups].mask = mask;
+      compiled.groups[compiled.totalGroups].shift = shift;
+      compiled.totalGroups++;
+    }
+    shift += fragmentWidth;
+  }
+
+  compiled.totalFragments = totalFragments;
+  compiled.width = width;
+  compiled.signExtend = signExtend;
+#ifdef FIELD_PEXT
+  compiled.usePext = compiled.totalGroups < totalFragments && cpuHasBMI2();
+#endif
+
+  *descriptor = compiled;
+  return 0;
+}
+
+
+
+/* uint64_t signExtendField(const fieldDescriptor *descriptor,
+                            uint64_t value):
+ * Returns value of a field sign extended to 64 bits if its descriptor was
+ * compiled as signed, else value.
+ */
+static inline uint64_t signExtendField(const fieldDescriptor *descriptor,
+                                       uint64_t value){
+  if (descriptor->signExtend && descriptor->width < 64){
+    uint64_t sign = (uint64_t)1 << (descriptor->width - 1);
+    value = (value ^ sign) - sign;
+  }
+
+  return value;
+}
+
+
+
+/* uint64_t extractField(const fieldDescriptor *descriptor, uint64_t word):
+ * Returns the field described by descriptor in word, sign extended to 64
+ * bits if it was compiled as signed.
+ */
+uint64_t extractField(const fieldDescriptor *descriptor, uint64_t word){
+#ifdef FIELD_PEXT
+  if (descriptor->usePext)
+    return signExtendField(descriptor, extractGroups(descriptor, word));
+#endif
+
+  uint64_t value = 0;
+  for (unsigned index = 0; index < descriptor->totalFragments; index++)
+    value |= ((word >> descriptor->fragments[index].lowBit) &
+              widthMask(descriptor->fragments[index].width)) <<
+             descriptor->fragments[index].shift;
+
+  return signExtendField(descriptor, value);
+}
+
+
+
+/* uint64_t insertField(const fieldDescriptor *descriptor, uint64_t word,
+                        uint64_t value):
+ * Returns word with the bits of the field described by descriptor taken
+ * from value, bits of value outside the field are ignored.
+ */
+uint64_t insertField(const fieldDescriptor *descriptor, uint64_t word,
+                     uint64_t value){
+#ifdef FIELD_PEXT
+  if (descriptor->usePext)
+    return insertGroups(descriptor, word, value);
+#endif
+
+  word &= ~descriptor->wordMask;
+  for (unsigned index = 0; index < descriptor->totalFragments; index++)
+    word |= ((value >> descriptor->fragments[index].shift) &
+             widthMask(descriptor->fragments[index].width)) <<
+            descriptor->fragments[index].lowBit;
+
+  return word;
+}
+
+
+
+/* int checkFields(const store STORE, const uint64_t location,
+                   const uint64_t totalLocations,
+                   const fieldDescriptor descriptors[],
+                   const unsigned totalDescriptors):
+ * Checks whether store is initialized with words of at most 64 bits, the
+ * range of totalLocations locations from location lies inside it and every
+ * descriptor fits in its words.
+ * Returns 0 if so, else -1.
+ */
+static int checkFields(const store STORE, const uint64_t location,
+                       const uint64_t totalLocations,
+                       const fieldDescriptor descriptors[],
+                       const unsigned totalDescriptors){
+  if (STORE_CHECK_FAILS(!STORE.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("checkFields", "STORE not initialized",
+                                   "returning -1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(STORE.wordSize == 0 || STORE.wordSize > 64)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("checkFields",
+                                   "words of %"PRIu64" bits are not 1 to 64 "
+                                   "bits", "returning -1"), STORE.wordSize);
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(location > STORE.totalLocations ||
+                        totalLocations > STORE.totalLocations - location)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("checkFields",
+                                   "Requested %"PRIu64" locations from "
+                                   "location %"PRIu64" out of bound",
+                                   "returning -1"), totalLocations, location);
+    return -1;
+  }
+  for (unsigned index = 0; index < totalDescriptors; index++)
+    if (STORE_CHECK_FAILS(descriptors[index].highestBit >= STORE.wordSize)){
+      reportStoreError(STORE_OUT_OF_BOUND,
+                       ERROR_MESSAGE("checkFields",
+                                     "descriptor %u doesn't fit in the word",
+                                     "returning -1"), index);
+      return -1;
+    }
+
+  return 0;
+}
+
+
+
+/* int extractFieldsfromStore(const store STORE, const uint64_t location,
+                              const fieldDescriptor descriptors[],
+                              const unsigned totalDescriptors,
+                              uint64_t values[]):
+ * Reads the word at location once and extracts every field of descriptors
+ * from it, values[i] getting the field of descriptors[i].
+ * Returns 0, or -1 if checks fail.
+ */
+int extractFieldsfromStore(const store STORE, const uint64_t location,
+                           const fieldDescriptor descriptors[],
+                           const unsigned totalDescriptors,
+                           uint64_t values[]){
+  if (checkFields(STORE, location, 1, descriptors, totalDescriptors)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("extractFieldsfromStore",
+                                   "checkFields returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint64_t word = readStoreBits(&STORE, location * STORE.wordSize,
+                                STORE.wordSize);
+  for (unsigned index = 0; index < totalDescriptors; index++)
+    values[index] = extractField(&descriptors[index], word);
+
+  return 0;
+}
+
+
+
+/* int insertFieldsinStore(store STORE, const uint64_t location,
+                           const fieldDescriptor descriptors[],
+                           const unsigned totalDescriptors,
+                           const uint64_t values[]):
+ * Reads the word at location once, inserts every field of descriptors in
+ * it from values, in order, and writes it back once.
+ * Returns 0, or -1 if checks fail or the store can't be written.
+ */
+int insertFieldsinStore(store STORE, const uint64_t location,
+                        const fieldDescriptor descriptors[],
+                        const unsigned totalDescriptors,
+                        const uint64_t values[]){
+  if (checkFields(STORE, location, 1, descriptors, totalDescriptors)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("insertFieldsinStore",
+                                   "checkFields returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint64_t bit = location * STORE.wordSize;
+  uint64_t word = readStoreBits(&STORE, bit, STORE.wordSize);
+  for (unsigned index = 0; index < totalDescriptors; index++)
+    word = insertField(&descriptors[index], word, values[index]);
+
+  if (writeStoreBits(&STORE, bit, STORE.wordSize, word)){
+    reportStoreError(STORE_WRITE_FAILED,
+                     ERROR_MESSAGE("insertFieldsinStore",
+                                   "store read only or page not allocated",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int extractFieldsfromBlock(const store STORE, const uint64_t location,
+                              const uint64_t totalLocations,
+                              const fieldDescriptor descriptors[],
+                              const unsigned totalDescriptors,
+                              uint64_t values[]):
+ * Same as extractFieldsfromStore for totalLocations locations from
+ * location on, e.g. to predecode a page of code, values getting the
+ * totalDescriptors fields of each location after each other. Words are
+ * read a block at a time.
+ * Returns 0, or -1 if checks fail.
+ */
+int extractFieldsfromBlock(const store STORE, const uint64_t location,
+                           const uint64_t totalLocations,
+                           const fieldDescriptor descriptors[],
+                           const unsigned totalDescriptors,
+                           uint64_t values[]){
+  if (checkFields(STORE, location, totalLocations, descriptors,
+                  totalDescriptors)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("extractFieldsfromBlock",
+                                   "checkFields returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint8_t buffer[FIELD_CHUNK_BYTES];
+  /* whole bytes per step, so every step starts on a byte of the buffer. */
+  uint64_t chunkLocations = FIELD_CHUNK_BYTES / STORE.wordSize * 8;
+  uint64_t done = 0;
+
+  while (done < totalLocations){
+    uint64_t chunk = (totalLocations - done < chunkLocations) ?
+                     totalLocations - done : chunkLocations;
+    readBlockfromStore(STORE, location + done, chunk, buffer);
+    for (uint64_t index = 0; index < chunk; index++){
+      uint64_t word = readFlatBits(buffer, sizeof(buffer),
+                                   index * STORE.wordSize, STORE.wordSize);
+      for (unsigned field = 0; field < totalDescriptors; field++)
+        *values++ = extractField(&descriptors[field], word);
+    }
+    done += chunk;
+  }
+
+  return 0;
+}
@@ -0,0 +1,511 @@
+#include "store/storefile.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "lzblock.h"
+#include "packedbits.h"
+#include "snapshotpages.h"
+#include "storepages.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+#define LOAD_ERROR_MESSAGE(reason) ERROR_MESSAGE("loadStorefromFile",\
+                                                 reason, "uninitiated store")
+
+#define PAGE_BITS (STORE_PAGE_BYTES * 8)
+#define HEADER_BYTES 32
+#define RECORD_BYTES 13
+#define END_OF_PAGES UINT64_MAX
+
+enum pageEncoding{
+  RAW_PAGE,
+  LZ_PAGE
+};
+
+/* struct fileStream:
+ * Store file being written through a chunk, 'used' bytes of it written,
+ * or read, with no chunk.
+ */
+struct fileStream{
+  int fd;
+  uint8_t *chunk;
+  uint32_t used;
+};
+
+
+
+/* void putLittleEndian(uint8_t *bytes, uint64_t number, unsigned length):
+ * Stores lowest 'length' bytes of number, least significant first.
+ */
+static void putLittleEndian(uint8_t *bytes, uint64_t number, unsigned length){
+  for (unsigned index = 0; index < length; index++)
+    bytes[index] = (uint8_t)(number >> (8 * index));
+}
+
+
+
+/* uint64_t getLittleEndian(const uint8_t *bytes, unsigned length):
+ * Returns number of 'length' bytes stored by putLittleEndian.
+ */
+static uint64_t getLittleEndian(const uint8_t *bytes, unsigned length){
+  uint64_t number = 0;
+  for (unsigned index = length; index > 0; index--)
+    number = (number << 8) | bytes[index - 1];
+  return number;
+}
+
+
+
+/* int flushStream(struct fileStream *stream):
+ * Writes the used bytes of the chunk to the file, retrying partial and
+ * interrupted writes.
+ * Returns 0, or -1 if the write fails.
+ */
+static int flushStream(struct fileStream *stream){
+  uint32_t done = 0;
+
+  while (done < stream->used){
+    ssize_t written = write(stream->fd, stream->chunk + done,
+                            stream->used - done);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return -1;
+    done += (uint32_t)written;
+  }
+
+  stream->used = 0;
+  return 0;
+}
+
+
+
+/* uint8_t *reserveStream(struct fileStream *stream, uint32_t length):
+ * Returns room for 'length' (at most STORE_FILE_CHUNK_BYTES) bytes at the
+ * end of the chunk, flushing it first if they don't fit.
+ * Returns NULL if the flush fails.
+ */
+static uint8_t *reserveStream(struct fileStream *stream, uint32_t length){
+  if (STORE_FILE_CHUNK_BYTES - stream->used < length &&
+      flushStream(stream))
+    return NULL;
+
+  uint8_t *room = stream->chunk + stream->used;
+  stream->used += length;
+  return room;
+}
+
+
+
+/* int readStream(struct fileStream *stream, uint8_t *bytes,
+                  uint32_t length):
+ * Reads exactly the next 'length' bytes of the file into bytes, retrying
+ * partial and interrupted reads, so the file is left just past them, e.g.
+ * at the next store saved to the same pipe.
+ * Returns 0, or -1 if the file fails or ends before.
+ */
+static int readStream(struct fileStream *stream, uint8_t *bytes,
+                      uint32_t length){
+  while (length > 0){
+    ssize_t got = read(stream->fd, bytes, length);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return -1;
+    bytes += got;
+    length -= (uint32_t)got;
+  }
+
+  return 0;
+}
+
+
+
+/* uint64_t pageBytesinFile(const store *STORE, uint64_t pageNumber):
+ * Returns how many bytes of the page are saved, less than STORE_PAGE_BYTES
+ * only for the last page.
+ */
+static uint64_t pageBytesinFile(const store *STORE, uint64_t pageNumber){
+  uint64_t totalBytes = (STORE->totalLocations * STORE->wordSize + 7) / 8;
+  uint64_t firstByte = pageNumber * STORE_PAGE_BYTES;
+
+  return (totalBytes - firstByte < STORE_PAGE_BYTES) ?
+         totalBytes - firstByte : STORE_PAGE_BYTES;
+}
+
+
+
+/* bool bytesAreZero(const uint8_t *bytes, uint64_t length):
+ * Returns true if every byte is 0.
+ */
+static bool bytesAreZero(const uint8_t *bytes, uint64_t length){
+  uint64_t any = 0;
+  uint64_t index = 0;
+
+  for (; index + 8 <= length; index += 8){
+    uint64_t word;
+    memcpy(&word, bytes + index, sizeof(word));
+    any |= word;
+  }
+  for (; index < length; index++)
+    any |= bytes[index];
+
+  return any == 0;
+}
+
+
+
+/* const uint8_t *pageinStore(const store *STORE, uint64_t pageNumber,
+                              uint8_t *buffer):
+ * Returns the packed bits of the page, in place or gathered in buffer of
+ * STORE_PAGE_BYTES bytes for a MATRIX_STORE.
+ */
+static const uint8_t *pageinStore(const store *STORE, uint64_t pageNumber,
+                                  uint8_t *buffer){
+  if (STORE->kind == MATRIX_STORE){
+    copyPageoutofStore(STORE, pageNumber, buffer);
+    return buffer;
+  }
+
+  uint64_t availableBytes;
+  return storeBytesforRead(STORE, pageNumber * STORE_PAGE_BYTES,
+                           &availableBytes);
+}
+
+
+
+/* int writePageofStore(const store *STORE, uint64_t pageNumber,
+                        const uint8_t *bytes, uint64_t length):
+ * Writes 'length' bytes, as counted by pageBytesinFile, to the page
+ * through the write paths, so snapshots, dirty pages and hashes of the
+ * store see them.
+ * Returns 0, or -1 if the store can't be written.
+ */
+static int writePageofStore(const store *STORE, uint64_t pageNumber,
+                            const uint8_t *bytes, uint64_t length){
+  if (STORE->kind != MATRIX_STORE){
+    uint64_t done = 0;
+    while (done < length){
+      uint64_t availableBytes;
+      uint8_t *destination = storeBytesforWrite(STORE, pageNumber *
+                                                STORE_PAGE_BYTES + done,
+                                                &availableBytes);
+      if (destination == NULL)
+        return -1;
+      uint64_t part = (length - done < availableBytes) ?
+                      length - done : availableBytes;
+      memcpy(destination, bytes + done, part);
+      done += part;
+    }
+    return 0;
+  }
+
+  /* a load is not an access to trace.*/
+  store untraced = *STORE;
+  untraced.traced = false;
+  uint64_t firstBit = pageNumber * PAGE_BITS;
+  uint64_t totalBits = STORE->totalLocations * STORE->wordSize - firstBit;
+  if (totalBits > PAGE_BITS)
+    totalBits = PAGE_BITS;
+  for (uint64_t done = 0; done < totalBits; done += 64){
+    unsigned width = (totalBits - done < 64) ? totalBits - done : 64;
+    if (writeStoreBits(&untraced, firstBit + done, width,
+                       readPackedBits(bytes + done / 8, length - done / 8, 0,
+                                      width)))
+      return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int saveStoretoFile(const store STORE, const int fd,
+                       const unsigned options):
+ * Takes initialized store, open file descriptor, and options, 0 or
+ * STORE_FILE_COMPRESSED, and writes the store to fd in the format given in
+ * storefile.h, skipping pages of zeros without reading untouched pages of
+ * a PAGED_STORE.
+ * Returns 0, or -1 if the store is not initialized, allocation or a write
+ * fails.
+ */
+int saveStoretoFile(const store STORE, const int fd, const unsigned options){
+  if (STORE_CHECK_FAILS(!STORE.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("saveStoretoFile",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+
+  struct fileStream stream = {fd, malloc(STORE_FILE_CHUNK_BYTES), 0};
+  uint8_t *buffer = malloc(2 * STORE_PAGE_BYTES);
+  if (stream.chunk == NULL || buffer == NULL){
+    free(stream.chunk);
+    free(buffer);
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("saveStoretoFile",
+                                   "unable to allocate chunk", "-1"));
+    return -1;
+  }
+  uint8_t *compressed = buffer + STORE_PAGE_BYTES;
+
+  uint8_t *header = reserveStream(&stream, HEADER_BYTES);
+  memcpy(header, "STOR", 4);
+  putLittleEndian(header + 4, STORE_FILE_VERSION, 4);
+  putLittleEndian(header + 8, STORE_PAGE_BYTES, 4);
+  putLittleEndian(header + 12, options, 4);
+  putLittleEndian(header + 16, STORE.wordSize, 8);
+  putLittleEndian(header + 24, STORE.totalLocations, 8);
+
+  uint64_t totalBytes = (STORE.totalLocations * STORE.wordSize + 7) / 8;
+  uint64_t totalPages = (totalBytes + STORE_PAGE_BYTES - 1) / STORE_PAGE_BYTES;
+  bool failed = false;
+
+  for (uint64_t page = 0; page < totalPages && !failed; page++){
+    const uint8_t *bytes = pageinStore(&STORE, page, buffer);
+    uint64_t length = pageBytesinFile(&STORE, page);
+    if (bytes == zeroPage || bytesAreZero(bytes, length))
+      continue;
+
+    uint8_t encoding = RAW_PAGE;
+    if (options & STORE_FILE_COMPRESSED){
+      uint32_t compressedBytes = compressLZBlock(bytes, length, compressed,
+                                                 length - 1);
+      if (compressedBytes != 0){
+        encoding = LZ_PAGE;
+        bytes = compressed;
+        length = compressedBytes;
+      }
+    }
+
+    uint8_t *record = reserveStream(&stream, RECORD_BYTES + length);
+    failed = (record == NULL);
+    if (!failed){
+      putLittleEndian(record, page, 8);
+      record[8] = encoding;
+      putLittleEndian(record + 9, length, 4);
+      memcpy(record + RECORD_BYTES, bytes, length);
+    }
+  }
+
+  if (!failed){
+    uint8_t *record = reserveStream(&stream, RECORD_BYTES);
+    failed = (record == NULL);
+    if (!failed){
+      putLittleEndian(record, END_OF_PAGES, 8);
+      memset(record + 8, 0, RECORD_BYTES - 8);
+      failed = flushStream(&stream);
+    }
+  }
+
+  free(stream.chunk);
+  free(buffer);
+
+  if (failed){
+    reportStoreError(STORE_IO_FAILED,
+                     ERROR_MESSAGE("saveStoretoFile",
+                                   "unable to write to the file", "-1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int readHeader(struct fileStream *stream, uint64_t *wordSize,
+                  uint64_t *totalLocations):
+ * Reads and checks the header of a store file, storing its geometry.
+ * Returns 0, or -1 if it isn't a store file this version can read.
+ */
+static int readHeader(struct fileStream *stream, uint64_t *wordSize,
+                      uint64_t *totalLocations){
+  uint8_t header[HEADER_BYTES];
+
+  if (readStream(stream, header, HEADER_BYTES) ||
+      memcmp(header, "STOR", 4) ||
+      getLittleEndian(header + 4, 4) != STORE_FILE_VERSION ||
+      getLittleEndian(header + 8, 4) != STORE_PAGE_BYTES)
+    return -1;
+
+  *wordSize = getLittleEndian(header + 16, 8);
+  *totalLocations = getLittleEndian(header + 24, 8);
+  if (*wordSize != 0 && *totalLocations > UINT64_MAX / *wordSize)
+    return -1;
+
+  return 0;
+}
+
+
+
+/* int clearPagesofStore(const store *STORE, uint64_t firstPage,
+                         uint64_t endPage, const uint8_t *zeros,
+                         uint8_t *buffer):
+ * Zeroes the pages from firstPage to endPage (excluded) holding a bit set,
+ * zeros being STORE_PAGE_BYTES zeroed bytes, and buffer as many to gather
+ * pages of a MATRIX_STORE.
+ * Returns 0, or -1 if the store can't be written.
+ */
+static int clearPagesofStore(const store *STORE, uint64_t firstPage,
+                             uint64_t endPage, const uint8_t *zeros,
+                             uint8_t *buffer){
+  for (uint64_t page = firstPage; page < endPage; page++){
+    uint64_t length = pageBytesinFile(STORE, page);
+    const uint8_t *bytes = pageinStore(STORE, page, buffer);
+    if (bytes != zeroPage && !bytesAreZero(bytes, length) &&
+        writePageofStore(STORE, page, zeros, length))
+      return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int readPages(struct fileStream *stream, const store *STORE,
+                 bool clearGaps):
+ * Reads the page records following the header into the store, of the
+ * geometry of the file, zeroing pages not in the file if clearGaps.
+ * Returns 0, or -1 if the file is corrupt or the store can't be written.
+ */
+static int readPages(struct fileStream *stream, const store *STORE,
+                     bool clearGaps){
+  uint64_t totalBytes = (STORE->totalLocations * STORE->wordSize + 7) / 8;
+  uint64_t totalPages = (totalBytes + STORE_PAGE_BYTES - 1) / STORE_PAGE_BYTES;
+  uint8_t *buffers = calloc(4, STORE_PAGE_BYTES);
+  uint8_t *payload = buffers + STORE_PAGE_BYTES;
+  uint8_t *page = buffers + 2 * STORE_PAGE_BYTES;
+  uint8_t *scratch = buffers + 3 * STORE_PAGE_BYTES;
+  uint64_t nextPage = 0;
+  int failed = -1;
+
+  if (buffers == NULL)
+    return -1;
+
+  while (true){
+    uint8_t record[RECORD_BYTES];
+    if (readStream(stream, record, RECORD_BYTES))
+      break;
+    uint64_t pageNumber = getLittleEndian(record, 8);
+    uint8_t encoding = record[8];
+    uint64_t length = getLittleEndian(record + 9, 4);
+
+    if (pageNumber == END_OF_PAGES){
+      if (!clearGaps || !clearPagesofStore(STORE, nextPage, totalPages,
+                                           buffers, scratch))
+        failed = 0;
+      break;
+    }
+
+    uint64_t pageBytes = (pageNumber < totalPages) ?
+                         pageBytesinFile(STORE, pageNumber) : 0;
+    if (pageNumber < nextPage || pageNumber >= totalPages ||
+        length > pageBytes || (encoding == RAW_PAGE && length != pageBytes) ||
+        encoding > LZ_PAGE || readStream(stream, payload, length))
+      break;
+
+    if (encoding == LZ_PAGE &&
+        decompressLZBlock(payload, length, page, pageBytes) !=
+        (int64_t)pageBytes)
+      break;
+
+    if (clearGaps && clearPagesofStore(STORE, nextPage, pageNumber,
+                                       buffers, scratch))
+      break;
+    if (writePageofStore(STORE, pageNumber,
+                         (encoding == LZ_PAGE) ? page : payload, pageBytes))
+      break;
+    nextPage = pageNumber + 1;
+  }
+
+  free(buffers);
+  return failed;
+}
+
+
+
+/* store loadStorefromFile(const int fd, const storeKind kind):
+ * Reads a store file written by saveStoretoFile from fd into a new store
+ * of the given kind, any but MAPPED_STORE, of the geometry of the file.
+ * Returns uninitiated store object if the file can't be read, is corrupt,
+ * or the store can't be initialized.
+ */
+store loadStorefromFile(const int fd, const storeKind kind){
+  store STORE = {0};
+  struct fileStream stream = {fd, NULL, 0};
+  uint64_t wordSize, totalLocations;
+
+  if (readHeader(&stream, &wordSize, &totalLocations)){
+    reportStoreError(STORE_IO_FAILED,
+                     LOAD_ERROR_MESSAGE("not a store file of this version"));
+    return STORE;
+  }
+
+  STORE = initializeStoreofKind(totalLocations, wordSize, kind);
+  if (!STORE.set){
+    reportStoreError(lastStoreError(),
+                     LOAD_ERROR_MESSAGE("unable to initialize the store"));
+    return STORE;
+  }
+
+  if (readPages(&stream, &STORE, false)){
+    destroyStore(&STORE);
+    reportStoreError(STORE_IO_FAILED,
+                     LOAD_ERROR_MESSAGE("file is truncated or corrupt"));
+  }
+
+  return STORE;
+}
+
+
+
+/* int loadFileintoStore(store STORE, const int fd):
+ * Same as loadStorefromFile, but reads the file into an initialized store
+ * of the same geometry, zeroing its pages the file doesn't hold, e.g. to
+ * restore a checkpoint in the stores of a running machine. Pages are
+ * written as by any write, so a snapshot of the store can undo the load.
+ * Returns 0, or -1 if the geometry differs, or the file can't be read or
+ * is corrupt, the store being then partly loaded.
+ */
+int loadFileintoStore(store STORE, const int fd){
+  if (STORE_CHECK_FAILS(!STORE.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("loadFileintoStore",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+
+  struct fileStream stream = {fd, NULL, 0};
+  uint64_t wordSize, totalLocations;
+  int failed = -1;
+
+  if (readHeader(&stream, &wordSize, &totalLocations))
+    reportStoreError(STORE_IO_FAILED,
+                     ERROR_MESSAGE("loadFileintoStore",
+                                   "not a store file of this version", "-1"));
+  else if (wordSize != STORE.wordSize ||
+           totalLocations != STORE.totalLocations)
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("loadFileintoStore",
+                                   "geometry of the file differs", "-1"));
+  else if (readPages(&stream, &STORE, true))
+    reportStoreError(STORE_IO_FAILED,
+                     ERROR_MESSAGE("loadFileintoStore",
+                                   "file is truncated, corrupt or store "
+                                   "read only", "-1"));
+  else
+    failed = 0;
+
+  return failed;
+}
@@ -0,0 +1,482 @@
+#include "store/storehash.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "hashtree.h"
+#include "packedbits.h"
+#include "snapshotpages.h"
+#include "storepages.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+#define HASH_PRIME1 0x9e3779b185ebca87ULL
+#define HASH_PRIME2 0xc2b2ae3d27d4eb4fULL
+#define HASH_PRIME3 0x165667b19e3779f9ULL
+
+/* Pages are hashed in stripes of 64 bytes, 8 lanes of 64 bits each
+ * accumulating the product of the halves of their bits keyed by lane and
+ * stripe, plus the bits themselves: 32 by 32 bit multiplies and adds only,
+ * as the vector extensions of GCC and Clang turn into the widest vector
+ * instructions enabled for the build.
+ */
+#define HASH_LANES 8
+
+static const uint64_t laneKeys[HASH_LANES] = {
+  0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL,
+  0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+  0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL,
+  0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL
+};
+
+#if defined(__GNUC__)
+typedef uint64_t hashLanes __attribute__((vector_size(8 * HASH_LANES)));
+#endif
+
+
+
+/* uint64_t avalanche(uint64_t hash):
+ * Mixes every bit of hash into every other.
+ */
+static inline uint64_t avalanche(uint64_t hash){
+  hash ^= hash >> 33;
+  hash *= HASH_PRIME2;
+  hash ^= hash >> 29;
+  hash *= HASH_PRIME3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+
+
+/* uint64_t mixHashes(uint64_t left, uint64_t right):
+ * Returns hash of the pair of hashes, order mattering.
+ */
+static inline uint64_t mixHashes(uint64_t left, uint64_t right){
+  return avalanche(left * HASH_PRIME1 +
+                   ((right << 31) | (right >> 33)) * HASH_PRIME2 +
+                   HASH_PRIME3);
+}
+
+
+
+/* uint64_t hashPageBytes(const uint8_t *bytes):
+ * Returns hash of STORE_PAGE_BYTES bytes.
+ */
+static uint64_t hashPageBytes(const uint8_t *bytes){
+  uint64_t lanes[HASH_LANES];
+
+#if defined(__GNUC__)
+  hashLanes keys, accumulator;
+  memcpy(&keys, laneKeys, sizeof(keys));
+  accumulator = keys;
+  for (uint64_t stripe = 0; stripe < STORE_PAGE_BYTES / sizeof(keys);
+       stripe++){
+    hashLanes data;
+    memcpy(&data, bytes + stripe * sizeof(data), sizeof(data));
+    hashLanes keyed = data ^ (keys + stripe * HASH_PRIME1);
+    accumulator += (keyed & 0xffffffff) * (keyed >> 32);
+    accumulator += data;
+  }
+  memcpy(lanes, &accumulator, sizeof(lanes));
+#else
+  memcpy(lanes, laneKeys, sizeof(lanes));
+  for (uint64_t stripe = 0; stripe < STORE_PAGE_BYTES / sizeof(lanes);
+       stripe++){
+    for (unsigned lane = 0; lane < HASH_LANES; lane++){
+      uint64_t data;
+      memcpy(&data, bytes + stripe * sizeof(lanes) + lane * sizeof(data),
+             sizeof(data));
+      uint64_t keyed = data ^ (laneKeys[lane] + stripe * HASH_PRIME1);
+      lanes[lane] += (keyed & 0xffffffff) * (keyed >> 32) + data;
+    }
+  }
+#endif
+
+  uint64_t hash = STORE_PAGE_BYTES * HASH_PRIME1;
+  for (unsigned lane = 0; lane < HASH_LANES; lane++)
+    hash = mixHashes(hash, lanes[lane]);
+
+  return hash;
+}
+
+
+
+/* uint64_t hashPageofStore(const store *STORE, uint64_t pageNumber,
+                            uint8_t *buffer):
+ * Returns hash of the page of the store, its bytes past the end of the
+ * store taken as 0, using buffer of STORE_PAGE_BYTES bytes to gather it
+ * when not held in place.
+ */
+static uint64_t hashPageofStore(const store *STORE, uint64_t pageNumber,
+                                uint8_t *buffer){
+  if (STORE->kind == PAGED_STORE){
+    const uint8_t *page = pageforRead(STORE->pages, pageNumber);
+    return (page == zeroPage) ? STORE->hashes->zeroPageHash :
+                                hashPageBytes(page);
+  }
+
+  if (STORE->kind == MATRIX_STORE){
+    copyPageoutofStore(STORE, pageNumber, buffer);
+    return hashPageBytes(buffer);
+  }
+
+  uint64_t totalBytes = (STORE->totalLocations * STORE->wordSize + 7) / 8;
+  uint64_t firstByte = pageNumber * STORE_PAGE_BYTES;
+  if (totalBytes - firstByte >= STORE_PAGE_BYTES)
+    return hashPageBytes((const uint8_t*)STORE->words + firstByte);
+
+  memset(buffer, 0, STORE_PAGE_BYTES);
+  memcpy(buffer, (const uint8_t*)STORE->words + firstByte,
+         totalBytes - firstByte);
+  return hashPageBytes(buffer);
+}
+
+
+
+/* uint64_t zeroHashofNode(const struct hashLevel *level, uint64_t node):
+ * Returns hash of the node with every page under it zeroed.
+ */
+static inline uint64_t zeroHashofNode(const struct hashLevel *level,
+                                      uint64_t node){
+  return (node + 1 == level->totalNodes) ? level->lastZeroHash :
+                                           level->zeroHash;
+}
+
+
+
+/* uint64_t hashofNode(const struct hashLevel *level, uint64_t node):
+ * Returns hash of the node, from its chunk if allocated.
+ */
+static uint64_t hashofNode(const struct hashLevel *level, uint64_t node){
+  uint64_t **table = level->tables[node >> (HASH_CHUNK_SHIFT +
+                                            HASH_TABLE_SHIFT)];
+  const uint64_t *chunk = (table == NULL) ? NULL :
+                          table[(node >> HASH_CHUNK_SHIFT) &
+                                (HASH_TABLE_CHUNKS - 1)];
+
+  return (chunk == NULL) ? zeroHashofNode(level, node) :
+                           chunk[node & (HASH_CHUNK_NODES - 1)];
+}
+
+
+
+/* int setNodeHash(struct hashLevel *level, uint64_t node, uint64_t hash):
+ * Stores hash of the node, allocating its table and chunk, the chunk
+ * holding the zero hashes of its nodes, unless hash is its zero hash.
+ * Chunks and tables of the last ones of a level only hold the nodes and
+ * chunks of the level.
+ * Returns 0, or -1 if unable to allocate.
+ */
+static int setNodeHash(struct hashLevel *level, uint64_t node,
+                       uint64_t hash){
+  uint64_t chunkNumber = node >> HASH_CHUNK_SHIFT;
+  uint64_t tableNumber = chunkNumber >> HASH_TABLE_SHIFT;
+  uint64_t **table = level->tables[tableNumber];
+  uint64_t *chunk = (table == NULL) ? NULL :
+                    table[chunkNumber & (HASH_TABLE_CHUNKS - 1)];
+
+  if (chunk == NULL){
+    if (hash == zeroHashofNode(level, node))
+      return 0;
+
+    if (table == NULL){
+      uint64_t totalChunks = ((level->totalNodes - 1) >> HASH_CHUNK_SHIFT) +
+                             1 - (tableNumber << HASH_TABLE_SHIFT);
+      table = calloc((totalChunks < HASH_TABLE_CHUNKS) ? totalChunks :
+                                                         HASH_TABLE_CHUNKS,
+                     sizeof(uint64_t*));
+      if (table == NULL)
+        return -1;
+      level->tables[tableNumber] = table;
+    }
+
+    uint64_t firstNode = chunkNumber << HASH_CHUNK_SHIFT;
+    uint64_t totalNodes = level->totalNodes - firstNode;
+    if (totalNodes > HASH_CHUNK_NODES)
+      totalNodes = HASH_CHUNK_NODES;
+    chunk = malloc(totalNodes * sizeof(uint64_t));
+    if (chunk == NULL)
+      return -1;
+    for (uint64_t index = 0; index < totalNodes; index++)
+      chunk[index] = zeroHashofNode(level, firstNode + index);
+    table[chunkNumber & (HASH_TABLE_CHUNKS - 1)] = chunk;
+  }
+
+  chunk[node & (HASH_CHUNK_NODES - 1)] = hash;
+
+  return 0;
+}
+
+
+
+/* void freeHashTree(struct storeHashTree *tree):
+ * Frees every chunk, table and level of the tree, its bitmap of stale
+ * pages and the tree.
+ */
+static void freeHashTree(struct storeHashTree *tree){
+  for (unsigned levelNumber = 0; levelNumber < tree->totalLevels;
+       levelNumber++){
+    struct hashLevel *level = &tree->levels[levelNumber];
+    if (level->tables == NULL)
+      continue;
+    uint64_t totalChunks = ((level->totalNodes - 1) >> HASH_CHUNK_SHIFT) + 1;
+    for (uint64_t tableNumber = 0; tableNumber < level->totalTables;
+         tableNumber++){
+      uint64_t **table = level->tables[tableNumber];
+      if (table == NULL)
+        continue;
+      uint64_t firstChunk = tableNumber << HASH_TABLE_SHIFT;
+      for (uint64_t chunk = 0; chunk < HASH_TABLE_CHUNKS &&
+                               firstChunk + chunk < totalChunks; chunk++)
+        free(table[chunk]);
+      free(table);
+    }
+    free(level->tables);
+  }
+
+  destroyPageBitmap(&tree->stale);
+  free(tree->staleNodes);
+  free(tree);
+}
+
+
+
+/* int buildHashTree(struct storeHashTree *tree, uint64_t totalNodes):
+ * Sets up the levels of the tree over totalNodes pages, every node
+ * holding its zero hash, and its bitmap of stale pages, none stale.
+ * Returns 0, or -1 if unable to allocate.
+ */
+static int buildHashTree(struct storeHashTree *tree, uint64_t totalNodes){
+  if (createPageBitmap(&tree->stale, totalNodes))
+    return -1;
+
+  uint64_t zeroHash = tree->zeroPageHash;
+  uint64_t lastZeroHash = tree->zeroPageHash;
+  while (true){
+    struct hashLevel *level = &tree->levels[tree->totalLevels++];
+    level->totalNodes = totalNodes;
+    level->zeroHash = zeroHash;
+    level->lastZeroHash = lastZeroHash;
+    level->totalTables = ((totalNodes - 1) >> (HASH_CHUNK_SHIFT +
+                                               HASH_TABLE_SHIFT)) + 1;
+    level->tables = calloc(level->totalTables, sizeof(uint64_t**));
+    if (level->tables == NULL)
+      return -1;
+    if (totalNodes == 1)
+      return 0;
+
+    /* the last node above is unpaired if this level has an odd count.*/
+    lastZeroHash = (totalNodes % 2 == 0) ?
+                   mixHashes(zeroHash, lastZeroHash) :
+                   mixHashes(lastZeroHash, 0);
+    zeroHash = mixHashes(zeroHash, zeroHash);
+    totalNodes = (totalNodes + 1) / 2;
+  }
+}
+
+
+
+/* int trackStoreHash(store *STORE):
+ * Takes initialized store and gives it a hash tree, every page stale, so
+ * the first hashofStore hashes the whole store, except the pages of a
+ * PAGED_STORE not allocated yet, zeroed. Does nothing if it has one
+ * already.
+ * Returns 0, or -1 if the store is not initialized or allocation fails.
+ */
+int trackStoreHash(store *STORE){
+  if (STORE_CHECK_FAILS(!STORE->set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("trackStoreHash",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+
+  if (STORE->hashes != NULL)
+    return 0;
+
+  struct storeHashTree *tree = calloc(1, sizeof(struct storeHashTree));
+  if (tree == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("trackStoreHash",
+                                   "unable to allocate hash tree", "-1"));
+    return -1;
+  }
+
+  uint64_t totalBytes = (STORE->totalLocations * STORE->wordSize + 7) / 8;
+  uint64_t totalNodes = (totalBytes + STORE_PAGE_BYTES - 1) /
+                        STORE_PAGE_BYTES;
+  if (totalNodes == 0)
+    totalNodes = 1;
+
+  tree->zeroPageHash = hashPageBytes(zeroPage);
+  int failed = buildHashTree(tree, totalNodes);
+  if (STORE->kind == PAGED_STORE)
+    for (uint64_t page = nextAllocatedPage(STORE->pages, 0);
+         !failed && page < totalNodes;
+         page = nextAllocatedPage(STORE->pages, page + 1))
+      failed = markPageinBitmap(&tree->stale, page);
+  else
+    for (uint64_t page = 0; !failed && page < totalNodes; page++)
+      failed = markPageinBitmap(&tree->stale, page);
+
+  if (failed){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("trackStoreHash",
+                                   "unable to allocate level of hash tree",
+                                   "-1"));
+    freeHashTree(tree);
+    return -1;
+  }
+
+  STORE->hashes = tree;
+
+  return 0;
+}
+
+
+
+/* void stopTrackingStoreHash(store *STORE):
+ * Frees the hash tree of the store. Does nothing if it has none. Called by
+ * destroyStore.
+ */
+void stopTrackingStoreHash(store *STORE){
+  if (STORE->hashes == NULL)
+    return;
+
+  freeHashTree(STORE->hashes);
+  STORE->hashes = NULL;
+}
+
+
+
+/* int64_t takeStalePages(struct storeHashTree *tree):
+ * Moves the stale pages of the tree, in increasing order, to the start of
+ * staleNodes, leaving room after them for as many nodes again.
+ * Returns number of pages moved, or -1 if unable to grow staleNodes, none
+ * moved.
+ */
+static int64_t takeStalePages(struct storeHashTree *tree){
+  const struct pageBitmap *stale = &tree->stale;
+  uint64_t totalStale = 0;
+
+  for (uint64_t page = nextMarkedPage(stale, 0); page < stale->totalPages;
+       page = nextMarkedPage(stale, page + 1)){
+    if (2 * (totalStale + 1) > tree->staleCapacity){
+      uint64_t capacity = tree->staleCapacity ? 2 * tree->staleCapacity : 64;
+      uint64_t *nodes = realloc(tree->staleNodes,
+                                capacity * sizeof(uint64_t));
+      if (nodes == NULL)
+        return -1;
+      tree->staleNodes = nodes;
+      tree->staleCapacity = capacity;
+    }
+    tree->staleNodes[totalStale++] = page;
+  }
+  clearPageBitmap(&tree->stale);
+
+  return (int64_t)totalStale;
+}
+
+
+
+/* uint64_t hashofStore(const store STORE):
+ * Takes store tracking its hash and returns the hash of its geometry and
+ * contents, rehashing stale pages and the nodes above them, level by
+ * level. Must not run along with writes to the store.
+ * Returns 0 if the store doesn't track its hash or allocation fails, the
+ * stale pages kept for the next call.
+ */
+uint64_t hashofStore(const store STORE){
+  if (STORE_CHECK_FAILS(!STORE.set || STORE.hashes == NULL)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("hashofStore",
+                                   "store doesn't track its hash", "0"));
+    return 0;
+  }
+
+  struct storeHashTree *tree = STORE.hashes;
+  int64_t totalPages = takeStalePages(tree);
+  if (totalPages < 0){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("hashofStore",
+                                   "unable to list stale pages", "0"));
+    return 0;
+  }
+
+  /* pages stay at the start of staleNodes, nodes above go after them.*/
+  const uint64_t *pages = tree->staleNodes;
+  uint64_t *nodes = tree->staleNodes + totalPages;
+  uint64_t totalNodes = (uint64_t)totalPages;
+  uint8_t buffer[STORE_PAGE_BYTES];
+
+  for (unsigned levelNumber = 0; levelNumber < tree->totalLevels;
+       levelNumber++){
+    struct hashLevel *level = &tree->levels[levelNumber];
+    for (uint64_t index = 0; index < totalNodes; index++){
+      uint64_t node, hash;
+      if (levelNumber == 0){
+        node = pages[index];
+        hash = hashPageofStore(&STORE, node, buffer);
+      }
+      else{
+        const struct hashLevel *below = level - 1;
+        node = nodes[index];
+        hash = mixHashes(hashofNode(below, 2 * node),
+                         (2 * node + 1 < below->totalNodes) ?
+                         hashofNode(below, 2 * node + 1) : 0);
+      }
+      if (setNodeHash(level, node, hash)){
+        /* chunks of the stale pages are kept, marking can't fail.*/
+        for (int64_t page = 0; page < totalPages; page++)
+          markPageinBitmap(&tree->stale, pages[page]);
+        reportStoreError(STORE_ALLOCATION_FAILED,
+                         ERROR_MESSAGE("hashofStore",
+                                       "unable to allocate hashes", "0"));
+        return 0;
+      }
+    }
+
+    uint64_t totalParents = 0;
+    for (uint64_t index = 0; index < totalNodes; index++){
+      uint64_t parent = ((levelNumber == 0) ? pages[index] :
+                                              nodes[index]) / 2;
+      if (totalParents == 0 || nodes[totalParents - 1] != parent)
+        nodes[totalParents++] = parent;
+    }
+    totalNodes = totalParents;
+  }
+
+  uint64_t root = hashofNode(&tree->levels[tree->totalLevels - 1], 0);
+  return mixHashes(mixHashes(root, STORE.totalLocations), STORE.wordSize);
+}
+
+
+
+/* uint64_t hashofStores(store *stores[], const unsigned totalStores):
+ * Returns hash of the hashes of the stores, in order, e.g. the memory and
+ * registers of a machine, or 0 if any of them doesn't track its hash.
+ */
+uint64_t hashofStores(store *stores[], const unsigned totalStores){
+  uint64_t hash = HASH_PRIME3;
+
+  for (unsigned index = 0; index < totalStores; index++){
+    if (STORE_CHECK_FAILS(!stores[index]->set ||
+                          stores[index]->hashes == NULL)){
+      reportStoreError(STORE_INVALID_ARGUMENT,
+                       ERROR_MESSAGE("hashofStores",
+                                     "store doesn't track its hash", "0"));
+      return 0;
+    }
+    hash = mixHashes(hash, hashofStore(*stores[index]));
+  }
+
+  return hash;
+}
@@ -0,0 +1,163 @@
+#define _DEFAULT_SOURCE
+#include "store/store.h"
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "store/storeerror.h"
+#include "packedbits.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+#define MAP_ERROR_MESSAGE(reason) ERROR_MESSAGE("initializeMappedStore",\
+                                                reason, "uninitiated store")
+
+
+
+/* void *mapFile(int fd, uint64_t fileBytes, uint64_t totalBytes,
+                 const storeMapping mapping):
+ * Maps totalBytes of memory with the first fileBytes of them taken from
+ * the open file fd. When the file is shorter than the store, the rest is
+ * zeroed anonymous memory mapped first, with the file mapped over its
+ * beginning, so no access past the end of the file can fault.
+ * Returns the address of the mapping, or MAP_FAILED.
+ */
+static void *mapFile(int fd, uint64_t fileBytes, uint64_t totalBytes,
+                     const storeMapping mapping){
+  int protection = (mapping == ROM_MAPPING) ? PROT_READ :
+                                              PROT_READ | PROT_WRITE;
+  int flags = (mapping == SHARED_MAPPING) ? MAP_SHARED : MAP_PRIVATE;
+
+  if (fileBytes == totalBytes)
+    return mmap(NULL, totalBytes, protection, flags, fd, 0);
+
+  void *base = mmap(NULL, totalBytes, protection,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED || fileBytes == 0)
+    return base;
+
+  if (mmap(base, fileBytes, protection, flags | MAP_FIXED, fd, 0)
+      == MAP_FAILED){
+    munmap(base, totalBytes);
+    return MAP_FAILED;
+  }
+
+  return base;
+}
+
+
+
+/* store initializeMappedStore(const char *path,
+                               const uint64_t totalLocations,
+                               const uint64_t wordSize,
+                               const storeMapping mapping):
+ * Same as initializeStoreofKind for a PACKED_STORE, but the packed bits
+ * are the contents of the file at path mapped in memory, so the file is
+ * loaded by page faults on access instead of a copy up front.
+ * File holds the packed bits as laid out by PACKED_STORE, for a wordSize
+ * of 8 it's simply one byte per location. A file shorter than the store
+ * reads as zero past its end. With SHARED_MAPPING the file is created or
+ * extended to the size of the store if needed, with ROM_MAPPING the store
+ * is read only and every write to it fails.
+ * Returns uninitiated store object if unable to open or map the file.
+ */
+store initializeMappedStore(const char *path, const uint64_t totalLocations,
+                            const uint64_t wordSize,
+                            const storeMapping mapping){
+  store STORE = {0};
+
+  if (wordSize != 0 && totalLocations > UINT64_MAX / wordSize){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     MAP_ERROR_MESSAGE("total bits of the store overflow 64 bits"));
+    return STORE;
+  }
+
+  STORE.kind = MAPPED_STORE;
+  STORE.wordSize = wordSize;
+  STORE.totalLocations = totalLocations;
+  STORE.readOnly = (mapping == ROM_MAPPING);
+  uint64_t totalBytes = packedBytesofStore(&STORE);
+
+  int fd = open(path, (mapping == SHARED_MAPPING) ? O_RDWR | O_CREAT :
+                                                    O_RDONLY, 0644);
+  if (fd < 0){
+    reportStoreError(STORE_IO_FAILED,
+                     MAP_ERROR_MESSAGE("unable to open the file"));
+    return (store){0};
+  }
+
+  struct stat fileStatus;
+  if (fstat(fd, &fileStatus)){
+    reportStoreError(STORE_IO_FAILED,
+                     MAP_ERROR_MESSAGE("unable to get size of the file"));
+    close(fd);
+    return (store){0};
+  }
+
+  uint64_t fileBytes = fileStatus.st_size;
+  if (mapping == SHARED_MAPPING && fileBytes < totalBytes){
+    if (ftruncate(fd, totalBytes)){
+      reportStoreError(STORE_IO_FAILED,
+                       MAP_ERROR_MESSAGE("unable to extend the file to store size"));
+      close(fd);
+      return (store){0};
+    }
+    fileBytes = totalBytes;
+  }
+  if (fileBytes > totalBytes)
+    fileBytes = totalBytes;
+
+  void *base = mapFile(fd, fileBytes, totalBytes, mapping);
+  close(fd);
+  if (base == MAP_FAILED){
+    reportStoreError(STORE_IO_FAILED,
+                     MAP_ERROR_MESSAGE("unable to map the file"));
+    return (store){0};
+  }
+
+  STORE.words = base;
+  STORE.set = true;
+
+  return STORE;
+}
+
+
+
+/* int syncMappedStore(store STORE):
+ * Takes a MAPPED_STORE and waits till its writes reach the file, only
+ * meaningful for SHARED_MAPPING.
+ * Returns 0, or -1 if the store is not an initialized MAPPED_STORE or the
+ * sync fails.
+ */
+int syncMappedStore(store STORE){
+  if (!STORE.set || STORE.kind != MAPPED_STORE){
+    reportStoreError(STORE_WRONG_KIND,
+                     ERROR_MESSAGE("syncMappedStore",
+                                   "store is not an initialized mapped store",
+                                   "-1"));
+    return -1;
+  }
+
+  if (msync(STORE.words, packedBytesofStore(&STORE), MS_SYNC)){
+    reportStoreError(STORE_IO_FAILED,
+                     ERROR_MESSAGE("syncMappedStore", "msync failed", "-1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* void unmapStore(store *STORE):
+ * Unmaps the memory of a MAPPED_STORE, used by destroyStore.
+ */
+void unmapStore(store *STORE){
+  munmap(STORE->words, packedBytesofStore(STORE));
+}
@@ -0,0 +1,353 @@
+#include "storepages.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "store/storeerror.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+#define LEAF_INDEX(pageNumber) ((pageNumber) & (PAGE_TABLE_ENTRIES - 1))
+#define MIDDLE_INDEX(pageNumber) (((pageNumber) >> PAGE_TABLE_SHIFT)\
+                                  & (PAGE_TABLE_ENTRIES - 1))
+#define DIRECTORY_INDEX(pageNumber) ((pageNumber) >> (2 * PAGE_TABLE_SHIFT))
+
+#define TLB_ENTRY(pages, pageNumber) (&(pages)->tlb[(pageNumber)\
+                                      & (STORE_TLB_ENTRIES - 1)])
+
+_Static_assert((STORE_TLB_ENTRIES & (STORE_TLB_ENTRIES - 1)) == 0,
+               "STORE_TLB_ENTRIES must be a power of 2");
+
+_Alignas(uint64_t) const uint8_t zeroPage[STORE_PAGE_BYTES];
+
+
+
+/* struct storePageTable *createPageTable(uint64_t totalBytes):
+ * Takes number of bytes the packed bits of the store take, and returns
+ * a page table able to hold them, with only its directory allocated.
+ * Returns NULL if unable to allocate the directory.
+ */
+struct storePageTable *createPageTable(uint64_t totalBytes){
+  uint64_t totalPages = (totalBytes >> STORE_PAGE_SHIFT) +
+                        ((totalBytes & (STORE_PAGE_BYTES - 1)) != 0);
+  uint64_t directoryEntries = totalPages ?
+                              DIRECTORY_INDEX(totalPages - 1) + 1 : 1;
+
+  struct storePageTable *pages = calloc(1, sizeof(struct storePageTable) +
+                                        directoryEntries * sizeof(uint8_t***));
+  if (pages == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("createPageTable",
+                                   "unable to allocate page directory",
+                                   "NULL"));
+    return NULL;
+  }
+
+  pages->totalPages = totalPages;
+  pages->directoryEntries = directoryEntries;
+  flushTLB(pages);
+
+  return pages;
+}
+
+
+
+/* void destroyPageTable(struct storePageTable *pages):
+ * Frees every page, table and the directory of the page table.
+ */
+void destroyPageTable(struct storePageTable *pages){
+  if (pages == NULL)
+    return;
+
+  for (uint64_t top = 0; top < pages->directoryEntries; top++){
+    uint8_t ***middle = pages->directory[top];
+    if (middle == NULL)
+      continue;
+    for (uint64_t mid = 0; mid < PAGE_TABLE_ENTRIES; mid++){
+      uint8_t **leaf = middle[mid];
+      if (leaf == NULL)
+        continue;
+      for (uint64_t low = 0; low < PAGE_TABLE_ENTRIES; low++)
+        free(leaf[low]);
+      free(leaf);
+    }
+    free(middle);
+  }
+
+  free(pages);
+}
+
+
+
+/* uint8_t *walkPageTable(const struct storePageTable *pages,
+                          uint64_t pageNumber):
+ * Returns the page with given number found through the tables, or NULL if
+ * it isn't allocated yet.
+ */
+static uint8_t *walkPageTable(const struct storePageTable *pages,
+                              uint64_t pageNumber){
+  uint8_t ***middle = pages->directory[DIRECTORY_INDEX(pageNumber)];
+  if (middle == NULL)
+    return NULL;
+
+  uint8_t **leaf = middle[MIDDLE_INDEX(pageNumber)];
+  if (leaf == NULL)
+    return NULL;
+
+  return leaf[LEAF_INDEX(pageNumber)];
+}
+
+
+
+/* uint8_t *allocatePage(struct storePageTable *pages, uint64_t pageNumber):
+ * Returns the page with given number, allocating it zeroed, along with
+ * the tables leading to it, if it isn't allocated yet.
+ * Returns NULL if unable to allocate.
+ */
+static uint8_t *allocatePage(struct storePageTable *pages,
+                             uint64_t pageNumber){
+  uint8_t ****middle = &pages->directory[DIRECTORY_INDEX(pageNumber)];
+  if (*middle == NULL){
+    *middle = calloc(PAGE_TABLE_ENTRIES, sizeof(uint8_t**));
+    if (*middle == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("allocatePage",
+                                     "unable to allocate middle page table",
+                                     "NULL"));
+      return NULL;
+    }
+    pages->allocatedTables++;
+  }
+
+  uint8_t ***leaf = &(*middle)[MIDDLE_INDEX(pageNumber)];
+  if (*leaf == NULL){
+    *leaf = calloc(PAGE_TABLE_ENTRIES, sizeof(uint8_t*));
+    if (*leaf == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("allocatePage",
+                                     "unable to allocate leaf page table",
+                                     "NULL"));
+      return NULL;
+    }
+    pages->allocatedTables++;
+  }
+
+  uint8_t **page = &(*leaf)[LEAF_INDEX(pageNumber)];
+  if (*page == NULL){
+    *page = calloc(STORE_PAGE_BYTES, 1);
+    if (*page == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("allocatePage", "unable to allocate page",
+                                     "NULL"));
+      return NULL;
+    }
+    pages->allocatedPages++;
+  }
+
+  return *page;
+}
+
+
+
+/* uint8_t *walkConcurrently(const struct storePageTable *pages,
+                             uint64_t pageNumber):
+ * walkPageTable of a concurrent page table, every level read with an
+ * acquire load, pairing with the release of CLAIM_ENTRY.
+ */
+static uint8_t *walkConcurrently(const struct storePageTable *pages,
+                                 uint64_t pageNumber){
+  uint8_t ***middle = __atomic_load_n(
+                        &pages->directory[DIRECTORY_INDEX(pageNumber)],
+                        __ATOMIC_ACQUIRE);
+  if (middle == NULL)
+    return NULL;
+
+  uint8_t **leaf = __atomic_load_n(&middle[MIDDLE_INDEX(pageNumber)],
+                                   __ATOMIC_ACQUIRE);
+  if (leaf == NULL)
+    return NULL;
+
+  return __atomic_load_n(&leaf[LEAF_INDEX(pageNumber)], __ATOMIC_ACQUIRE);
+}
+
+
+
+/* CLAIM_ENTRY(entry, current, bytes, counter, what):
+ * Makes sure the table entry points to a zeroed allocation of 'bytes'
+ * bytes and leaves it in current: a new allocation is published with
+ * compare and swap, and freed if another thread published one first.
+ * Returns NULL from the enclosing function if unable to allocate.
+ */
+#define CLAIM_ENTRY(entry, current, bytes, counter, what)                    \
+  do{                                                                        \
+    (current) = __atomic_load_n((entry), __ATOMIC_ACQUIRE);                  \
+    if ((current) == NULL){                                                  \
+      __typeof__(current) fresh = calloc(1, (bytes));                        \
+      if (fresh == NULL){                                                    \
+        reportStoreError(STORE_ALLOCATION_FAILED,                            \
+                         ERROR_MESSAGE("allocateConcurrently",               \
+                                       "unable to allocate " what, "NULL")); \
+        return NULL;                                                         \
+      }                                                                      \
+      if (__atomic_compare_exchange_n((entry), &(current), fresh, false,     \
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){  \
+        __atomic_fetch_add((counter), 1, __ATOMIC_RELAXED);                  \
+        (current) = fresh;                                                   \
+      }                                                                      \
+      else                                                                   \
+        free(fresh);                                                         \
+    }                                                                        \
+  }while (0)
+
+
+
+/* uint8_t *allocateConcurrently(struct storePageTable *pages,
+                                 uint64_t pageNumber):
+ * allocatePage of a concurrent page table, lock free.
+ * Returns NULL if unable to allocate.
+ */
+static uint8_t *allocateConcurrently(struct storePageTable *pages,
+                                     uint64_t pageNumber){
+  uint8_t ***middle;
+  CLAIM_ENTRY(&pages->directory[DIRECTORY_INDEX(pageNumber)], middle,
+              PAGE_TABLE_ENTRIES * sizeof(uint8_t**),
+              &pages->allocatedTables, "middle page table");
+
+  uint8_t **leaf;
+  CLAIM_ENTRY(&middle[MIDDLE_INDEX(pageNumber)], leaf,
+              PAGE_TABLE_ENTRIES * sizeof(uint8_t*),
+              &pages->allocatedTables, "leaf page table");
+
+  uint8_t *page;
+  CLAIM_ENTRY(&leaf[LEAF_INDEX(pageNumber)], page, STORE_PAGE_BYTES,
+              &pages->allocatedPages, "page");
+
+  return page;
+}
+
+
+
+/* const uint8_t *pageforRead(struct storePageTable *pages,
+                              uint64_t pageNumber):
+ * Returns the page with given number, or zeroPage if it isn't allocated
+ * yet. Never allocates, only refills the TLB entry of the page on a miss.
+ */
+const uint8_t *pageforRead(struct storePageTable *pages,
+                           uint64_t pageNumber){
+  if (pages->concurrent){
+    uint8_t *page = walkConcurrently(pages, pageNumber);
+    return (page == NULL) ? zeroPage : page;
+  }
+
+  struct storeTLBEntry *entry = TLB_ENTRY(pages, pageNumber);
+  if (entry->pageNumber == pageNumber){
+    pages->tlbHits++;
+    return entry->page;
+  }
+
+  pages->tlbMisses++;
+  uint8_t *page = walkPageTable(pages, pageNumber);
+  entry->pageNumber = pageNumber;
+  entry->page = (page == NULL) ? (uint8_t*)zeroPage : page;
+  entry->writable = (page != NULL);
+
+  return entry->page;
+}
+
+
+
+/* uint8_t *pageforWrite(struct storePageTable *pages, uint64_t pageNumber):
+ * Returns the page with given number, allocating it if it isn't allocated
+ * yet, through the TLB like pageforRead.
+ * Returns NULL if unable to allocate.
+ */
+uint8_t *pageforWrite(struct storePageTable *pages, uint64_t pageNumber){
+  if (pages->concurrent)
+    return allocateConcurrently(pages, pageNumber);
+
+  struct storeTLBEntry *entry = TLB_ENTRY(pages, pageNumber);
+  if (entry->pageNumber == pageNumber && entry->writable){
+    pages->tlbHits++;
+    return entry->page;
+  }
+
+  pages->tlbMisses++;
+  uint8_t *page = allocatePage(pages, pageNumber);
+  if (page == NULL)
+    return NULL;
+  entry->pageNumber = pageNumber;
+  entry->page = page;
+  entry->writable = true;
+
+  return page;
+}
+
+
+
+/* uint64_t nextAllocatedPage(const struct storePageTable *pages,
+                              uint64_t pageNumber):
+ * Returns the first page from pageNumber on allocated, or totalPages if
+ * there is none, skipping tables not allocated. Must not run along with
+ * allocations.
+ */
+uint64_t nextAllocatedPage(const struct storePageTable *pages,
+                           uint64_t pageNumber){
+  while (pageNumber < pages->totalPages){
+    uint8_t ***middle = pages->directory[DIRECTORY_INDEX(pageNumber)];
+    if (middle == NULL){
+      pageNumber = (DIRECTORY_INDEX(pageNumber) + 1) << (2 * PAGE_TABLE_SHIFT);
+      continue;
+    }
+    uint8_t **leaf = middle[MIDDLE_INDEX(pageNumber)];
+    if (leaf == NULL){
+      pageNumber = ((pageNumber >> PAGE_TABLE_SHIFT) + 1) << PAGE_TABLE_SHIFT;
+      continue;
+    }
+    if (leaf[LEAF_INDEX(pageNumber)] != NULL)
+      return pageNumber;
+    pageNumber++;
+  }
+
+  return pages->totalPages;
+}
+
+
+
+/* void flushTLB(struct storePageTable *pages):
+ * Invalidates every entry of the TLB of the page table, counters are kept.
+ */
+void flushTLB(struct storePageTable *pages){
+  for (unsigned index = 0; index < STORE_TLB_ENTRIES; index++){
+    pages->tlb[index].pageNumber = NO_PAGE_NUMBER;
+    pages->tlb[index].page = NULL;
+    pages->tlb[index].writable = false;
+  }
+}
+
+
+
+/* void makePageTableConcurrent(struct storePageTable *pages):
+ * Switches the page table to concurrent lookups and allocations, see
+ * storepages.h.
+ */
+void makePageTableConcurrent(struct storePageTable *pages){
+  flushTLB(pages);
+  pages->concurrent = true;
+}
+
+
+
+/* size_t footprintofPageTable(const struct storePageTable *pages):
+ * Returns number of bytes allocated to the page table, its tables and
+ * pages.
+ */
+size_t footprintofPageTable(const struct storePageTable *pages){
+  return sizeof(struct storePageTable) +
+         pages->directoryEntries * sizeof(uint8_t***) +
+         pages->allocatedTables * PAGE_TABLE_ENTRIES * sizeof(void*) +
+         pages->allocatedPages * STORE_PAGE_BYTES;
+}
@@ -0,0 +1,71 @@
+#ifndef LIB_STORE_IMPLEMENTATION_STOREPAGES_H
+#define LIB_STORE_IMPLEMENTATION_STOREPAGES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Page table of a PAGED_STORE. The packed bits of the store are cut into
+ * pages of STORE_PAGE_BYTES bytes, allocated zeroed on first write.
+ * Pages are found through a radix tree of three levels: a directory sized
+ * for the store, pointing to middle tables, pointing to leaf tables of page
+ * pointers, each table of PAGE_TABLE_ENTRIES entries and allocated on first
+ * write under it too.
+ */
+#define STORE_PAGE_SHIFT 12
+#define STORE_PAGE_BYTES ((uint64_t)1 << STORE_PAGE_SHIFT)
+#define PAGE_TABLE_SHIFT 12
+#define PAGE_TABLE_ENTRIES ((uint64_t)1 << PAGE_TABLE_SHIFT)
+
+/* Lookups go through a direct mapped cache of STORE_TLB_ENTRIES (a power
+ * of 2) recently used pages first, indexed by lowest bits of the page
+ * number, so sequential and local accesses skip the walk of the tables.
+ * An entry found through pageforRead for an untouched page points to
+ * zeroPage and is not writable, so the first write still allocates.
+ * Define STORE_TLB_ENTRIES when building the library to tune its size.
+ */
+#ifndef STORE_TLB_ENTRIES
+#define STORE_TLB_ENTRIES 64
+#endif
+
+#define NO_PAGE_NUMBER UINT64_MAX
+
+struct storeTLBEntry{
+  uint64_t pageNumber;
+  uint8_t *page;
+  bool writable;
+};
+
+/* With 'concurrent' set, the TLB is bypassed and tables and pages are
+ * read with atomic loads and published with compare and swap, so threads
+ * can look up and allocate pages at the same time.
+ */
+struct storePageTable{
+  bool concurrent;
+  uint64_t totalPages;
+  uint64_t directoryEntries;
+  uint64_t allocatedTables;
+  uint64_t allocatedPages;
+  uint64_t tlbHits;
+  uint64_t tlbMisses;
+  struct storeTLBEntry tlb[STORE_TLB_ENTRIES];
+  uint8_t ***directory[];
+};
+
+/* Zeroed page returned for reads of pages not allocated yet, aligned as
+ * an allocated page for the 8 byte atomic loads of concurrent stores.
+ */
+extern const uint8_t zeroPage[STORE_PAGE_BYTES];
+
+struct storePageTable *createPageTable(uint64_t totalBytes);
+void destroyPageTable(struct storePageTable *pages);
+const uint8_t *pageforRead(struct storePageTable *pages,
+                           uint64_t pageNumber);
+uint8_t *pageforWrite(struct storePageTable *pages, uint64_t pageNumber);
+uint64_t nextAllocatedPage(const struct storePageTable *pages,
+                           uint64_t pageNumber);
+size_t footprintofPageTable(const struct storePageTable *pages);
+void flushTLB(struct storePageTable *pages);
+void makePageTableConcurrent(struct storePageTable *pages);
+
+#endif
@@ -0,0 +1,343 @@
+#include "store/storesnapshot.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "packedbits.h"
+#include "pagewrites.h"
+#include "snapshotpages.h"
+#include "storepages.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+#define PAGE_BITS (STORE_PAGE_BYTES * 8)
+
+
+
+/* uint64_t pageBytesofStore(const store *STORE, uint64_t pageNumber):
+ * Returns how many bytes of the page hold packed bits of the store, less
+ * than STORE_PAGE_BYTES only for the last page of a flat store.
+ */
+static uint64_t pageBytesofStore(const store *STORE, uint64_t pageNumber){
+  uint64_t totalBytes = (STORE->kind == MATRIX_STORE) ?
+                        (STORE->totalLocations * STORE->wordSize + 7) / 8 :
+                        packedBytesofStore(STORE);
+  uint64_t firstByte = pageNumber * STORE_PAGE_BYTES;
+
+  return (totalBytes - firstByte < STORE_PAGE_BYTES) ?
+         totalBytes - firstByte : STORE_PAGE_BYTES;
+}
+
+
+
+/* void copyPageoutofStore(const store *STORE, uint64_t pageNumber,
+                           uint8_t *bytes):
+ * Copies the packed bits of the page of the store to bytes, gathering
+ * them from the rows of a MATRIX_STORE. Bytes past the end of the store
+ * are left as they are for flat stores, zeroed for a MATRIX_STORE.
+ */
+void copyPageoutofStore(const store *STORE, uint64_t pageNumber,
+                               uint8_t *bytes){
+  if (STORE->kind == PAGED_STORE){
+    memcpy(bytes, pageforRead(STORE->pages, pageNumber), STORE_PAGE_BYTES);
+    return;
+  }
+
+  if (STORE->kind != MATRIX_STORE){
+    memcpy(bytes, (const uint8_t*)STORE->words +
+                  pageNumber * STORE_PAGE_BYTES,
+           pageBytesofStore(STORE, pageNumber));
+    return;
+  }
+
+  uint64_t firstBit = pageNumber * PAGE_BITS;
+  uint64_t totalBits = STORE->totalLocations * STORE->wordSize - firstBit;
+  if (totalBits > PAGE_BITS)
+    totalBits = PAGE_BITS;
+
+  memset(bytes, 0, STORE_PAGE_BYTES);
+  uint64_t location = firstBit / STORE->wordSize;
+  uint64_t bitinWord = firstBit % STORE->wordSize;
+  for (uint64_t bit = 0; bit < totalBits; bit++){
+    bytes[bit / 8] |= STORE->matrix[location][bitinWord] << (7 - bit % 8);
+    if (++bitinWord == STORE->wordSize){
+      location++;
+      bitinWord = 0;
+    }
+  }
+}
+
+
+
+/* int copyPageintoStore(const store *STORE, uint64_t pageNumber,
+                         const uint8_t *bytes):
+ * Copies bytes saved by copyPageoutofStore back to the page of the store,
+ * marking it changed.
+ * Returns 0, or -1 if the page of a PAGED_STORE can't be allocated or the
+ * page can't be marked.
+ */
+static int copyPageintoStore(const store *STORE, uint64_t pageNumber,
+                             const uint8_t *bytes){
+  if (markPageChanged(STORE, pageNumber))
+    return -1;
+
+  if (STORE->kind == PAGED_STORE){
+    uint8_t *page = pageforWrite(STORE->pages, pageNumber);
+    if (page == NULL)
+      return -1;
+    memcpy(page, bytes, STORE_PAGE_BYTES);
+    return 0;
+  }
+
+  if (STORE->kind != MATRIX_STORE){
+    memcpy((uint8_t*)STORE->words + pageNumber * STORE_PAGE_BYTES, bytes,
+           pageBytesofStore(STORE, pageNumber));
+    return 0;
+  }
+
+  uint64_t firstBit = pageNumber * PAGE_BITS;
+  uint64_t totalBits = STORE->totalLocations * STORE->wordSize - firstBit;
+  if (totalBits > PAGE_BITS)
+    totalBits = PAGE_BITS;
+
+  uint64_t location = firstBit / STORE->wordSize;
+  uint64_t bitinWord = firstBit % STORE->wordSize;
+  for (uint64_t bit = 0; bit < totalBits; bit++){
+    STORE->matrix[location][bitinWord] = (bytes[bit / 8] >> (7 - bit % 8))
+                                         & 1;
+    if (++bitinWord == STORE->wordSize){
+      location++;
+      bitinWord = 0;
+    }
+  }
+
+  return 0;
+}
+
+
+
+/* int savePageforSnapshot(const store *STORE, uint64_t pageNumber):
+ * Slow path of preservePageofStore: saves the page in the next buffer of
+ * the saved list, allocating the buffer, a longer list or the chunk of
+ * epochs of the page if needed, and marks the page saved.
+ * Returns 0, or -1 if unable to allocate.
+ */
+int savePageforSnapshot(const store *STORE, uint64_t pageNumber){
+  struct storeSnapshot *snapshot = STORE->snapshot;
+
+  uint32_t **epochs = &snapshot->epochs[pageNumber >> SNAPSHOT_CHUNK_SHIFT];
+  if (*epochs == NULL){
+    *epochs = calloc(SNAPSHOT_CHUNK_PAGES, sizeof(uint32_t));
+    if (*epochs == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("savePageforSnapshot",
+                                     "unable to allocate epochs of pages",
+                                     "-1"));
+      return -1;
+    }
+  }
+
+  if (snapshot->totalSaved == snapshot->savedCapacity){
+    uint64_t capacity = snapshot->savedCapacity ?
+                        2 * snapshot->savedCapacity : 16;
+    struct savedPage *saved = realloc(snapshot->saved,
+                                      capacity * sizeof(struct savedPage));
+    if (saved == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("savePageforSnapshot",
+                                     "unable to grow list of saved pages",
+                                     "-1"));
+      return -1;
+    }
+    memset(saved + snapshot->savedCapacity, 0,
+           (capacity - snapshot->savedCapacity) * sizeof(struct savedPage));
+    snapshot->saved = saved;
+    snapshot->savedCapacity = capacity;
+  }
+
+  /* buffers of earlier generations are kept in the list and reused.*/
+  struct savedPage *entry = &snapshot->saved[snapshot->totalSaved];
+  if (entry->bytes == NULL){
+    entry->bytes = malloc(STORE_PAGE_BYTES);
+    if (entry->bytes == NULL){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("savePageforSnapshot",
+                                     "unable to allocate saved page", "-1"));
+      return -1;
+    }
+  }
+
+  copyPageoutofStore(STORE, pageNumber, entry->bytes);
+  entry->pageNumber = pageNumber;
+  snapshot->totalSaved++;
+  (*epochs)[pageNumber & (SNAPSHOT_CHUNK_PAGES - 1)] = snapshot->epoch;
+
+  return 0;
+}
+
+
+
+/* void startGeneration(struct storeSnapshot *snapshot):
+ * Forgets every saved page, so pages are saved again on their next write,
+ * for a new snapshot.
+ * Epochs are only cleared when the generation counter wraps around.
+ */
+static void startGeneration(struct storeSnapshot *snapshot){
+  snapshot->totalSaved = 0;
+
+  if (++snapshot->epoch != 0)
+    return;
+
+  for (uint64_t chunk = 0; chunk < snapshot->totalChunks; chunk++)
+    if (snapshot->epochs[chunk] != NULL)
+      memset(snapshot->epochs[chunk], 0,
+             SNAPSHOT_CHUNK_PAGES * sizeof(uint32_t));
+  snapshot->epoch = 1;
+}
+
+
+
+/* int takeStoreSnapshot(store *STORE):
+ * Takes initialized store, not concurrent, and makes its current state the
+ * one restoreStoreSnapshot rolls back to, replacing any earlier snapshot.
+ * Copies nothing, only the first snapshot of the store allocates.
+ * Returns 0, or -1 if the store can't have a snapshot or allocation fails.
+ */
+int takeStoreSnapshot(store *STORE){
+  if (STORE_CHECK_FAILS(!STORE->set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("takeStoreSnapshot",
+                                   "store is not formally initialized",
+                                   "-1"));
+    return -1;
+  }
+
+  if (STORE_CHECK_FAILS(STORE->concurrent)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("takeStoreSnapshot",
+                                   "a concurrent store can't have a snapshot",
+                                   "-1"));
+    return -1;
+  }
+
+  if (STORE->snapshot != NULL){
+    startGeneration(STORE->snapshot);
+    return 0;
+  }
+
+  uint64_t totalBytes = (STORE->totalLocations * STORE->wordSize + 7) / 8;
+  uint64_t totalPages = (totalBytes + STORE_PAGE_BYTES - 1) / STORE_PAGE_BYTES;
+  uint64_t totalChunks = (totalPages >> SNAPSHOT_CHUNK_SHIFT) + 1;
+
+  struct storeSnapshot *snapshot = calloc(1, sizeof(struct storeSnapshot) +
+                                          totalChunks * sizeof(uint32_t*));
+  if (snapshot == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("takeStoreSnapshot",
+                                   "unable to allocate snapshot", "-1"));
+    return -1;
+  }
+
+  snapshot->totalPages = totalPages;
+  snapshot->totalChunks = totalChunks;
+  snapshot->epoch = 1;
+  STORE->snapshot = snapshot;
+
+  return 0;
+}
+
+
+
+/* int restoreStoreSnapshot(store *STORE):
+ * Rolls the store back to the state it had when its snapshot was taken,
+ * copying back every page written since the snapshot or the last restore.
+ * The snapshot is kept for later restores.
+ * Returns 0, or -1 if the store has no snapshot or a page can't be
+ * allocated, leaving the pages not restored yet in the saved list.
+ */
+int restoreStoreSnapshot(store *STORE){
+  if (STORE_CHECK_FAILS(!STORE->set || STORE->snapshot == NULL)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("restoreStoreSnapshot",
+                                   "store has no snapshot", "-1"));
+    return -1;
+  }
+
+  struct storeSnapshot *snapshot = STORE->snapshot;
+  while (snapshot->totalSaved > 0){
+    const struct savedPage *entry = &snapshot->saved[snapshot->totalSaved - 1];
+    if (copyPageintoStore(STORE, entry->pageNumber, entry->bytes)){
+      reportStoreError(STORE_ALLOCATION_FAILED,
+                       ERROR_MESSAGE("restoreStoreSnapshot",
+                                     "unable to allocate page", "-1"));
+      return -1;
+    }
+    /* restored pages are saved again on their next write.*/
+    snapshot->epochs[entry->pageNumber >> SNAPSHOT_CHUNK_SHIFT]
+                    [entry->pageNumber & (SNAPSHOT_CHUNK_PAGES - 1)] = 0;
+    snapshot->totalSaved--;
+  }
+
+  return 0;
+}
+
+
+
+/* void dropStoreSnapshot(store *STORE):
+ * Frees the snapshot of the store, keeping its current state. Does nothing
+ * if it has none. Called by destroyStore.
+ */
+void dropStoreSnapshot(store *STORE){
+  struct storeSnapshot *snapshot = STORE->snapshot;
+  if (snapshot == NULL)
+    return;
+
+  for (uint64_t index = 0; index < snapshot->savedCapacity; index++)
+    free(snapshot->saved[index].bytes);
+  free(snapshot->saved);
+  for (uint64_t chunk = 0; chunk < snapshot->totalChunks; chunk++)
+    free(snapshot->epochs[chunk]);
+  free(snapshot);
+
+  STORE->snapshot = NULL;
+}
+
+
+
+/* int takeStoreSnapshots(store *stores[], const unsigned totalStores):
+ * takeStoreSnapshot of every store, e.g. memory and registers of a
+ * machine, so they are restored together.
+ * Returns 0, or -1 if any of them fails, the others keep their new
+ * snapshot.
+ */
+int takeStoreSnapshots(store *stores[], const unsigned totalStores){
+  int failed = 0;
+
+  for (unsigned index = 0; index < totalStores; index++)
+    if (takeStoreSnapshot(stores[index]))
+      failed = -1;
+
+  return failed;
+}
+
+
+
+/* int restoreStoreSnapshots(store *stores[], const unsigned totalStores):
+ * restoreStoreSnapshot of every store.
+ * Returns 0, or -1 if any of them fails.
+ */
+int restoreStoreSnapshots(store *stores[], const unsigned totalStores){
+  int failed = 0;
+
+  for (unsigned index = 0; index < totalStores; index++)
+    if (restoreStoreSnapshot(stores[index]))
+      failed = -1;
+
+  return failed;
+}
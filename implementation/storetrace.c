@@ -0,0 +1,408 @@
+#include "store/storetrace.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "packedbits.h"
+
+#define ERROR_MESSAGE(location,reason,returnValue) ("\nin " location ":\n"\
+                                                    reason ", returning "\
+                                                    returnValue "\n")
+
+#define BLOCK_HEADER_BYTES 24
+#define RECORD_BYTES 24
+/* records converted at a time when draining or replaying.*/
+#define BATCH_RECORDS 256
+#define MAX_CAPACITY ((uint64_t)1 << 40)
+
+/* struct traceRecord:
+ * A recorded access, as written in trace files.
+ */
+struct traceRecord{
+  uint64_t location;
+  uint64_t value;
+  uint32_t bitinWord;
+  uint16_t storeId;
+  uint8_t width;
+  uint8_t writing;
+};
+
+/* struct traceRing:
+ * Ring of records of a thread, records from 'tail' to 'head' (excluded),
+ * counted from the start, held at their count modulo mask + 1. 'dropped'
+ * counts records lost since the last drain, fd is -1 if the ring keeps
+ * its latest records rather than draining when full.
+ */
+struct traceRing{
+  struct traceRecord *records;
+  uint64_t mask;
+  uint64_t head;
+  uint64_t tail;
+  uint64_t dropped;
+  int fd;
+};
+
+static _Thread_local struct traceRing *threadRing;
+
+
+
+/* void putLittleEndian(uint8_t *bytes, uint64_t number, unsigned length):
+ * Stores lowest 'length' bytes of number, least significant first.
+ */
+static void putLittleEndian(uint8_t *bytes, uint64_t number, unsigned length){
+  for (unsigned index = 0; index < length; index++)
+    bytes[index] = (uint8_t)(number >> (8 * index));
+}
+
+
+
+/* uint64_t getLittleEndian(const uint8_t *bytes, unsigned length):
+ * Returns number of 'length' bytes stored by putLittleEndian.
+ */
+static uint64_t getLittleEndian(const uint8_t *bytes, unsigned length){
+  uint64_t number = 0;
+  for (unsigned index = length; index > 0; index--)
+    number = (number << 8) | bytes[index - 1];
+  return number;
+}
+
+
+
+/* int writeAll(int fd, const uint8_t *bytes, uint64_t length):
+ * Writes all bytes to fd, retrying partial and interrupted writes.
+ * Returns 0, or -1 if the write fails.
+ */
+static int writeAll(int fd, const uint8_t *bytes, uint64_t length){
+  while (length > 0){
+    ssize_t written = write(fd, bytes, length);
+    if (written < 0 && errno == EINTR)
+      continue;
+    if (written <= 0)
+      return -1;
+    bytes += written;
+    length -= written;
+  }
+
+  return 0;
+}
+
+
+
+/* int readAll(int fd, uint8_t *bytes, uint64_t length):
+ * Reads 'length' bytes from fd, retrying partial and interrupted reads.
+ * Returns 0, 1 if the file ends before the first byte, or -1 if the read
+ * fails or the file ends after it.
+ */
+static int readAll(int fd, uint8_t *bytes, uint64_t length){
+  uint64_t done = 0;
+
+  while (done < length){
+    ssize_t got = read(fd, bytes + done, length - done);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      return (got == 0 && done == 0) ? 1 : -1;
+    done += got;
+  }
+
+  return 0;
+}
+
+
+
+/* int64_t drainRing(struct traceRing *ring, int fd):
+ * Writes the records of the ring to fd as a block, oldest first, and
+ * empties the ring.
+ * Returns number of records written, or -1 if the write fails, the ring
+ * being left as it was.
+ */
+static int64_t drainRing(struct traceRing *ring, int fd){
+  uint8_t bytes[BATCH_RECORDS * RECORD_BYTES];
+  uint64_t totalRecords = ring->head - ring->tail;
+
+  memcpy(bytes, "STRC", 4);
+  putLittleEndian(bytes + 4, STORE_TRACE_VERSION, 4);
+  putLittleEndian(bytes + 8, totalRecords, 8);
+  putLittleEndian(bytes + 16, ring->dropped, 8);
+  if (writeAll(fd, bytes, BLOCK_HEADER_BYTES))
+    return -1;
+
+  for (uint64_t done = 0; done < totalRecords; done += BATCH_RECORDS){
+    uint64_t batch = (totalRecords - done < BATCH_RECORDS) ?
+                     totalRecords - done : BATCH_RECORDS;
+    for (uint64_t index = 0; index < batch; index++){
+      const struct traceRecord *record = &ring->records[(ring->tail + done +
+                                                         index) & ring->mask];
+      uint8_t *encoded = bytes + index * RECORD_BYTES;
+      putLittleEndian(encoded, record->location, 8);
+      putLittleEndian(encoded + 8, record->value, 8);
+      putLittleEndian(encoded + 16, record->bitinWord, 4);
+      putLittleEndian(encoded + 20, record->storeId, 2);
+      encoded[22] = record->width;
+      encoded[23] = record->writing;
+    }
+    if (writeAll(fd, bytes, batch * RECORD_BYTES))
+      return -1;
+  }
+
+  ring->tail = ring->head;
+  ring->dropped = 0;
+
+  return totalRecords;
+}
+
+
+
+/* void recordStoreAccess(const store *STORE, uint64_t bit, unsigned width,
+                          uint64_t value, bool writing):
+ * Called by readStoreBits and writeStoreBits for a store traced: records
+ * the field of 'width' bits from packed bit 'bit' in the ring of the
+ * thread, if it has one, draining or dropping the oldest record first when
+ * the ring is full.
+ */
+void recordStoreAccess(const store *STORE, uint64_t bit, unsigned width,
+                       uint64_t value, bool writing){
+  struct traceRing *ring = threadRing;
+  if (ring == NULL)
+    return;
+
+  if (ring->head - ring->tail > ring->mask &&
+      (ring->fd < 0 || drainRing(ring, ring->fd) < 0)){
+    ring->tail++;
+    ring->dropped++;
+  }
+
+  struct traceRecord *record = &ring->records[ring->head++ & ring->mask];
+  record->location = bit / STORE->wordSize;
+  record->value = value & widthMask(width);
+  record->bitinWord = bit % STORE->wordSize;
+  record->storeId = STORE->traceId;
+  record->width = width;
+  record->writing = writing;
+}
+
+
+
+/* int startStoreTrace(const uint64_t capacity, const int fd):
+ * Gives the calling thread a ring of capacity records, rounded up to a
+ * power of two, for the accesses it makes to traced stores. With fd of an
+ * open file, the ring drains into it whenever full, else (fd -1) it keeps
+ * the latest records.
+ * Returns 0, or -1 if the thread has a ring already, capacity is 0 or
+ * over 1 << 40, or allocation fails.
+ */
+int startStoreTrace(const uint64_t capacity, const int fd){
+  if (STORE_CHECK_FAILS(threadRing != NULL || capacity == 0 ||
+                        capacity > MAX_CAPACITY)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("startStoreTrace",
+                                   "thread traces already or capacity is "
+                                   "out of range", "-1"));
+    return -1;
+  }
+
+  uint64_t slots = 1;
+  while (slots < capacity)
+    slots *= 2;
+
+  struct traceRing *ring = calloc(1, sizeof(struct traceRing));
+  if (ring != NULL)
+    ring->records = malloc(slots * sizeof(struct traceRecord));
+  if (ring == NULL || ring->records == NULL){
+    free(ring);
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("startStoreTrace",
+                                   "unable to allocate ring", "-1"));
+    return -1;
+  }
+
+  ring->mask = slots - 1;
+  ring->fd = fd;
+  threadRing = ring;
+
+  return 0;
+}
+
+
+
+/* int64_t drainStoreTrace(const int fd):
+ * Writes the records of the ring of the calling thread to fd as a block
+ * and empties the ring.
+ * Returns number of records written, or -1 if the thread has no ring or
+ * the write fails, records being then kept.
+ */
+int64_t drainStoreTrace(const int fd){
+  if (STORE_CHECK_FAILS(threadRing == NULL)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("drainStoreTrace",
+                                   "thread has no trace ring", "-1"));
+    return -1;
+  }
+
+  int64_t totalRecords = drainRing(threadRing, fd);
+  if (totalRecords < 0)
+    reportStoreError(STORE_IO_FAILED,
+                     ERROR_MESSAGE("drainStoreTrace",
+                                   "unable to write to the file", "-1"));
+
+  return totalRecords;
+}
+
+
+
+/* int stopStoreTrace(void):
+ * Drains the ring of the calling thread into its file, if it has one, and
+ * frees it. Does nothing if the thread has no ring.
+ * Returns 0, or -1 if the last records couldn't be written, the ring
+ * being freed all the same.
+ */
+int stopStoreTrace(void){
+  struct traceRing *ring = threadRing;
+  if (ring == NULL)
+    return 0;
+
+  int failed = (ring->fd >= 0 && ring->head != ring->tail &&
+                drainRing(ring, ring->fd) < 0) ? -1 : 0;
+  if (failed)
+    reportStoreError(STORE_IO_FAILED,
+                     ERROR_MESSAGE("stopStoreTrace",
+                                   "unable to write last records", "-1"));
+
+  free(ring->records);
+  free(ring);
+  threadRing = NULL;
+
+  return failed;
+}
+
+
+
+/* int traceStore(store *STORE, const uint16_t storeId):
+ * Takes initialized store of words up to 1 << 32 bits and starts recording
+ * its accesses, as storeId, in the rings of the threads accessing it. Like
+ * snapshots, only the store object given and copies of it made after are
+ * traced.
+ * Returns 0, or -1 if the store is not initialized or words are wider.
+ */
+int traceStore(store *STORE, const uint16_t storeId){
+  if (STORE_CHECK_FAILS(!STORE->set || STORE->wordSize > UINT32_MAX)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("traceStore",
+                                   "store is not initialized or its words "
+                                   "are too wide", "-1"));
+    return -1;
+  }
+
+  STORE->traced = true;
+  STORE->traceId = storeId;
+
+  return 0;
+}
+
+
+
+/* void untraceStore(store *STORE):
+ * Stops recording accesses of the store.
+ */
+void untraceStore(store *STORE){
+  STORE->traced = false;
+}
+
+
+
+/* int replayRecords(const uint8_t *bytes, uint64_t totalRecords,
+                     store *stores[], unsigned totalStores,
+                     uint64_t *replayed):
+ * Writes again the write records of stores given, counting them in
+ * replayed.
+ * Returns 0, or -1 if a record falls out of its store or the store can't
+ * be written.
+ */
+static int replayRecords(const uint8_t *bytes, uint64_t totalRecords,
+                         store *stores[], unsigned totalStores,
+                         uint64_t *replayed){
+  for (uint64_t index = 0; index < totalRecords; index++){
+    const uint8_t *encoded = bytes + index * RECORD_BYTES;
+    uint16_t storeId = getLittleEndian(encoded + 20, 2);
+    if (!encoded[23] || storeId >= totalStores || stores[storeId] == NULL)
+      continue;
+
+    store target = *stores[storeId];
+    uint64_t location = getLittleEndian(encoded, 8);
+    uint64_t bitinWord = getLittleEndian(encoded + 16, 4);
+    unsigned width = encoded[22];
+    if (!target.set || location >= target.totalLocations ||
+        bitinWord >= target.wordSize || width == 0 || width > 64 ||
+        width > (target.totalLocations - location) * target.wordSize -
+                bitinWord)
+      return -1;
+
+    /* replayed writes are not recorded again.*/
+    target.traced = false;
+    if (writeStoreBits(&target, location * target.wordSize + bitinWord,
+                       width, getLittleEndian(encoded + 8, 8)))
+      return -1;
+    (*replayed)++;
+  }
+
+  return 0;
+}
+
+
+
+/* int64_t replayStoreTrace(const int fd, store *stores[],
+                            const unsigned totalStores):
+ * Reads blocks of records drained to fd till its end and writes again, in
+ * order, the writes recorded to stores whose id indexes stores, skipping
+ * reads and stores of id past totalStores or left NULL, e.g. to bring
+ * stores from a snapshot to where the guest diverged without running it.
+ * Blocks with records dropped before them are replayed with a
+ * STORE_TRUNCATED warning.
+ * Returns number of writes replayed, or -1 if the file can't be read, is
+ * corrupt or a store can't be written, writes before being kept.
+ */
+int64_t replayStoreTrace(const int fd, store *stores[],
+                         const unsigned totalStores){
+  uint8_t bytes[BATCH_RECORDS * RECORD_BYTES];
+  uint64_t replayed = 0;
+
+  while (true){
+    int ended = readAll(fd, bytes, BLOCK_HEADER_BYTES);
+    if (ended == 1)
+      return replayed;
+    if (ended || memcmp(bytes, "STRC", 4) ||
+        getLittleEndian(bytes + 4, 4) != STORE_TRACE_VERSION){
+      reportStoreError(STORE_IO_FAILED,
+                       ERROR_MESSAGE("replayStoreTrace",
+                                     "not a trace of this version", "-1"));
+      return -1;
+    }
+
+    uint64_t totalRecords = getLittleEndian(bytes + 8, 8);
+    if (getLittleEndian(bytes + 16, 8) != 0)
+      reportStoreError(STORE_TRUNCATED,
+                       ERROR_MESSAGE("replayStoreTrace",
+                                     "WARNING: records were dropped before "
+                                     "this block", "replaying the rest"));
+
+    for (uint64_t done = 0; done < totalRecords; done += BATCH_RECORDS){
+      uint64_t batch = (totalRecords - done < BATCH_RECORDS) ?
+                       totalRecords - done : BATCH_RECORDS;
+      if (readAll(fd, bytes, batch * RECORD_BYTES) ||
+          replayRecords(bytes, batch, stores, totalStores, &replayed)){
+        reportStoreError(STORE_IO_FAILED,
+                         ERROR_MESSAGE("replayStoreTrace",
+                                       "trace is truncated, corrupt or "
+                                       "store can't be written", "-1"));
+        return -1;
+      }
+    }
+  }
+}
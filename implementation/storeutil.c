@@ -1,16 +1,22 @@
 #include "store/storeutil.h"
 
 #include <inttypes.h>
-#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "store/store.h"
+#include "store/storeerror.h"
+#include "deviceranges.h"
+#include "packedbits.h"
 
-#define BIGENDIAN 0
-#define LITTLEENDIAN 1
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HOSTENDIAN BIGENDIAN
+#else
+#define HOSTENDIAN LITTLEENDIAN
+#endif
 
 #define ERROR_MESSAGE(location,reason,reaction) ("\nin " location ":\n"\
                                                  reason ", " reaction "\n")
@@ -30,17 +36,146 @@
  */
 int checkStore(const store STORE, const uint64_t location,
                const uint64_t wordBit){
-  if (!STORE.set){
-    printf(STORE_ERROR("STORE not initialized"));
+  if (STORE_CHECK_FAILS(!STORE.set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     STORE_ERROR("STORE not initialized"));
     return -1;
   }
-  if (location >= STORE.totalLocations){
-    printf(STORE_ERROR("Requested location %"PRIu64" out of bound"), location);
+  if (STORE_CHECK_FAILS(location >= STORE.totalLocations)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     STORE_ERROR("Requested location %"PRIu64" out of bound"), location);
     return -1;
   }
-  if (wordBit >= STORE.wordSize){
-    printf(STORE_ERROR("Requested 'bit in word'%"PRIu64" out of bound"),
-           wordBit);
+  if (STORE_CHECK_FAILS(wordBit >= STORE.wordSize)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     STORE_ERROR("Requested 'bit in word'%"PRIu64" out of bound"),
+                     wordBit);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* uint64_t readFieldBits(const store STORE, const uint64_t location,
+                          const uint64_t wordStartBit, unsigned width):
+ * Reads 'width' (1 to 64) bits from wordStartBit of the word at location,
+ * first bit as most significant bit, without any checks.
+ * Shifts and masks whole words of the packed kinds, walks the row of a
+ * MATRIX_STORE directly, unless traced.
+ */
+static uint64_t readFieldBits(const store STORE, const uint64_t location,
+                              const uint64_t wordStartBit, unsigned width){
+  if (STORE.kind != MATRIX_STORE || storeTracesAccesses(&STORE))
+    return readStoreBits(&STORE, location * STORE.wordSize + wordStartBit,
+                         width);
+
+  const bool *row = STORE.matrix[location] + wordStartBit;
+  uint64_t number = 0;
+  for (unsigned index = 0; index < width; index++)
+    number = (number << 1) | row[index];
+
+  return number;
+}
+
+
+
+/* int writeFieldBits(store STORE, const uint64_t location,
+                      const uint64_t wordStartBit, unsigned width,
+                      uint64_t number):
+ * Writes lowest 'width' (1 to 64) bits of number from wordStartBit of the
+ * word at location, most significant bit first, without any checks.
+ * Returns 0, or -1 if the store is read only or a page of PAGED_STORE
+ * couldn't be allocated. Rows of a MATRIX_STORE noting pages written or
+ * traced are left to writeStoreBits, which notes their page and records
+ * the write.
+ */
+static int writeFieldBits(store STORE, const uint64_t location,
+                           const uint64_t wordStartBit, unsigned width,
+                           uint64_t number){
+  if (STORE.kind != MATRIX_STORE || storeWatchesWrites(&STORE) ||
+      storeTracesAccesses(&STORE))
+    return writeStoreBits(&STORE, location * STORE.wordSize + wordStartBit,
+                          width, number);
+
+  bool *row = STORE.matrix[location] + wordStartBit;
+  for (unsigned index = 0; index < width; index++)
+    row[index] = (number >> (width - index - 1)) & 1;
+
+  return 0;
+}
+
+
+
+/* uint64_t readFieldfromStore(const store STORE, const uint64_t location,
+                               const uint64_t wordStartBit,
+                               const uint64_t width):
+ * Fast path of readNumBitsfromStore for whole fields: reads 'width' bits
+ * from wordStartBit, first bit as most significant bit, validating the
+ * store, location and whole field once and allocating nothing.
+ * Field must lie inside the word and width must be from 1 to 64, no
+ * truncation is done.
+ * Returns the number, or 0 if the checks fail.
+ */
+uint64_t readFieldfromStore(const store STORE, const uint64_t location,
+                            const uint64_t wordStartBit,
+                            const uint64_t width){
+  if (checkStore(STORE, location, wordStartBit)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("readFieldfromStore",
+                                   "checkStore returned -1",
+                                   "returning 0"));
+    return 0;
+  }
+  if (STORE_CHECK_FAILS(width == 0 || width > 64 ||
+                        width > STORE.wordSize - wordStartBit)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("readFieldfromStore",
+                                   "requested width doesn't fit in word or 64 bits",
+                                   "returning 0"));
+    return 0;
+  }
+
+  return readFieldBits(STORE, location, wordStartBit, width);
+}
+
+
+
+/* int writeFieldtoStore(store STORE, const uint64_t location,
+                         const uint64_t wordStartBit, const uint64_t width,
+                         uint64_t number):
+ * Fast path of writeNumBitstoStore for whole fields: writes lowest 'width'
+ * bits of number from wordStartBit, most significant bit first, validating
+ * once and allocating nothing.
+ * Field must lie inside the word and width must be from 1 to 64, higher
+ * bits of number are ignored.
+ * Returns 0 if written successfully, else -1.
+ */
+int writeFieldtoStore(store STORE, const uint64_t location,
+                      const uint64_t wordStartBit, const uint64_t width,
+                      uint64_t number){
+  if (checkStore(STORE, location, wordStartBit)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("writeFieldtoStore",
+                                   "checkStore returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS(width == 0 || width > 64 ||
+                        width > STORE.wordSize - wordStartBit)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("writeFieldtoStore",
+                                   "requested width doesn't fit in word or 64 bits",
+                                   "returning -1"));
+    return -1;
+  }
+
+  if (writeFieldBits(STORE, location, wordStartBit, width, number)){
+    reportStoreError(STORE_WRITE_FAILED,
+                     ERROR_MESSAGE("writeFieldtoStore",
+                                   "store read only or page not allocated",
+                                   "returning -1"));
     return -1;
   }
 
@@ -69,8 +204,10 @@ int writeMultiBitstoStore (store STORE, const uint64_t location,
 
 
   if (checkStore(STORE, location, wordStartBit)){
-    printf(ERROR_MESSAGE("writeMultiBitstoStore", "checkStore returned -1",
-                         "returning -1"));
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("writeMultiBitstoStore",
+                                   "checkStore returned -1",
+                                   "returning -1"));
     return -1;
   }
 
@@ -79,19 +216,32 @@ int writeMultiBitstoStore (store STORE, const uint64_t location,
    * can't overflow as STORE.wordSize > wordStartBit,
    * thanks to the checking of the same previously.*/
   if((STORE.wordSize - wordStartBit) < length){
-    printf(ERROR_MESSAGE("writeMultiBitstoStore",
-                         "WARNING: bitArray length is too big to fit in word",
-                         "truncating the bitArray"));
+    reportStoreError(STORE_TRUNCATED,
+                     ERROR_MESSAGE("writeMultiBitstoStore",
+                                   "WARNING: bitArray length is too big to fit in word",
+                                   "truncating the bitArray"));
     appliedLength = STORE.wordSize - wordStartBit;
   }
 
   /* bitArray is stored in store such that, when store word is converted
    * into decimal number, lowest address word bit stores most significant bit,
    * whereas highest address word bit stores least significant bit.
-   * Loop is designed with that in mind.*/
-  for (uint64_t index = 0; index < appliedLength; index++){
-    writeBittoStore(STORE, location, wordStartBit + index,
-                    bitArray[appliedLength - index - 1]);
+   * Loop is designed with that in mind, writing up to 64 bits at a time.*/
+  uint64_t index = 0;
+  while (index < appliedLength){
+    unsigned width = (appliedLength - index < 64) ?
+                     appliedLength - index : 64;
+    uint64_t number = 0;
+    for (unsigned bit = 0; bit < width; bit++)
+      number = (number << 1) | bitArray[appliedLength - index - bit - 1];
+    if (writeFieldBits(STORE, location, wordStartBit + index, width, number)){
+      reportStoreError(STORE_WRITE_FAILED,
+                       ERROR_MESSAGE("writeMultiBitstoStore",
+                                     "store read only or page not allocated",
+                                     "returning -1"));
+      return -1;
+    }
+    index += width;
   }
 
   return 0;
@@ -99,68 +249,137 @@ int writeMultiBitstoStore (store STORE, const uint64_t location,
 
 
 
+/* int64_t readMultiBitsintoBuffer (const store STORE,
+                                   const uint64_t location,
+                                   const uint64_t wordStartBit,
+                                   uint64_t numberofBits, bool bitArray[]):
+ * Same as readMultiBitsfromStore, but stores the bits in caller owned
+ * bitArray instead of allocating one, so nothing is allocated per call.
+ * Returns number of bits stored in bitArray, less than numberofBits if the
+ * word ends before, or -1 if checkStore fails.
+ * WARNING: Take care for keeping bitArray's actual length greater than
+ * equal to numberofBits.
+ */
+int64_t readMultiBitsintoBuffer (const store STORE, const uint64_t location,
+                                 const uint64_t wordStartBit,
+                                 uint64_t numberofBits, bool bitArray[]){
+
+  if(checkStore(STORE, location, wordStartBit)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("readMultiBitsintoBuffer",
+                                   "checkStore returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint64_t avlNumberofBits = numberofBits;
+  /* STORE.wordSize - wordStartBit can't overflow as
+   * STORE.wordSize > wordStartBit, thanks to the checking of the same
+   * previously.*/
+  if((STORE.wordSize - wordStartBit) < numberofBits){
+    reportStoreError(STORE_TRUNCATED,
+                     ERROR_MESSAGE("readMultiBitsintoBuffer",
+                                   "WARNING: Requested number of bits greater than total"
+                                   " bits in Word after wordStartBit",
+                                   "storing only available bits in bitArray"));
+    avlNumberofBits = STORE.wordSize - wordStartBit;
+  }
+
+  /* bitArray stores value(bits) such that, when bit array is converted
+   * into decimal number, highest array index stores most significant bit,
+   * whereas lowest array index stores least significant bit.
+   * Bits are read a field of up to 64 bits at a time.*/
+  uint64_t index = 0;
+  while (index < avlNumberofBits){
+    unsigned width = (avlNumberofBits - index < 64) ?
+                     avlNumberofBits - index : 64;
+    uint64_t number = readFieldBits(STORE, location, wordStartBit + index,
+                                    width);
+    for (unsigned bit = 0; bit < width; bit++)
+      bitArray[avlNumberofBits - index - bit - 1] =
+        (number >> (width - bit - 1)) & 1;
+    index += width;
+  }
+
+  return avlNumberofBits;
+}
+
+
+
 /* bool *readMultiBitsfromStore (const store STORE, const uint64_t location,
                               const uint64_t wordStartBit,
                               uint64_t numberofBits):
  * Takes store object, location in store, bit location in word of store,
  * length - number of bits to read from store.
  * Reads multiple bits from a word of the store and returns array of bool
- * storing the bits of word from the store.
+ * storing the bits of word from the store, which the caller has to free.
  * Retuns NULL if checkStore fails.
+ * Use readMultiBitsintoBuffer to avoid the allocation.
  */
 bool *readMultiBitsfromStore (const store STORE, const uint64_t location,
                               const uint64_t wordStartBit,
                               uint64_t numberofBits){
 
   if(checkStore(STORE, location, wordStartBit)){
-    printf(ERROR_MESSAGE("readMultiBitsfromStore","checkStore returned -1",
-                         "returning NULL"));
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("readMultiBitsfromStore",
+                                   "checkStore returned -1",
+                                   "returning NULL"));
     return NULL;
   }
 
   uint64_t avlNumberofBits = numberofBits;
-  /* STORE.wordSize - wordStartBit can't overflow as
-   * STORE.wordSize > wordStartBit, thanks to the checking of the same
-   * previously.*/
-  if((STORE.wordSize - wordStartBit) < numberofBits){
-    printf(ERROR_MESSAGE("readMultiBitsfromStore",
-                         "WARNING: Requested number of bits greater than total"
-                         " bits in Word after wordStartBit",
-                         "storing only available bits in bitArray"));
+  if((STORE.wordSize - wordStartBit) < numberofBits)
     avlNumberofBits = STORE.wordSize - wordStartBit;
-  }
 
-  /* bitArray stores value(bits) such that, when bit array is converted
-   * into decimal number, highest array index stores most significant bit,
-   * whereas lowest array index stores least significant bit.
-   * Loop is designed with that in mind.*/
-  bool *bitArray = (bool*)malloc(sizeof(bool)*avlNumberofBits);
-  for (uint64_t index = 0; index < avlNumberofBits; index++){
-    bitArray[avlNumberofBits - index - 1] =
-     readBitfromStore(STORE, location, wordStartBit + index);
+  bool *bitArray = (bool*)malloc(sizeof(bool)*(avlNumberofBits ?
+                                               avlNumberofBits : 1));
+  if (bitArray == NULL){
+    reportStoreError(STORE_ALLOCATION_FAILED,
+                     ERROR_MESSAGE("readMultiBitsfromStore",
+                                   "unable to allocate bitArray",
+                                   "returning NULL"));
+    return NULL;
   }
+  readMultiBitsintoBuffer(STORE, location, wordStartBit, numberofBits,
+                          bitArray);
 
   return bitArray;
 }
 
 
 
+/* void numbertoBitStringinBuffer(uint64_t number, uint64_t length,
+                                  bool bitString[]):
+ * Same as numbertoBitString, but stores the binary digits in caller owned
+ * bitString of at least 'length' elements instead of allocating one.
+ */
+void numbertoBitStringinBuffer(uint64_t number, uint64_t length,
+                               bool bitString[]){
+  uint64_t actionNumber = number;
+  for (uint64_t i = 0; i < length; i++){
+      bitString[i] = actionNumber & 1;
+      actionNumber >>= 1;
+  }
+}
+
+
+
 /* bool *numbertoBitString(uint64_t number, uint64_t length):
  * Takes unsigned number and length of bool array to store,
  * converts number into array of binary digits stored in
  * bool array. Converts such that most significant bit is the
  * highest index element, and least significant bit is the lowest
  * index element.
- * Returns this bool array.
- * Exceptions? not found yet.. help me out if you find one.
+ * Returns this bool array, which the caller has to free, or NULL if
+ * unable to allocate it.
  */
 bool *numbertoBitString(uint64_t number, uint64_t length){
-  uint64_t actionNumber = number;
-  bool *bitString = malloc(sizeof(bool)*length);
-  for (uint64_t i = 0; i < length; i++){
-      bitString[i] = actionNumber % 2;
-      actionNumber /= 2;
-  }
+  bool *bitString = malloc(sizeof(bool)*(length ? length : 1));
+  if (bitString == NULL)
+    return NULL;
+
+  numbertoBitStringinBuffer(number, length, bitString);
 
   return bitString;
 }
@@ -178,24 +397,44 @@ int writeNumBitstoStore (store STORE, const uint64_t location,
                          uint64_t length){
 
   if(checkStore(STORE, location, wordStartBit)){
-    printf(ERROR_MESSAGE("writeNumBitstoStore", "checkStore returned -1",
-                         "returning -1"));
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("writeNumBitstoStore",
+                                   "checkStore returned -1",
+                                   "returning -1"));
     return -1;
   }
 
   uint64_t availableBits = STORE.wordSize - wordStartBit;
   uint64_t bitstoWrite = (length <= availableBits)?length: availableBits;
-  if (bitstoWrite < 64 && number >= pow(2, bitstoWrite)){
-      printf(ERROR_MESSAGE("writeNumBitstoStore",
-                           "WARNING: given number is bigger than"
-                           " requested bit length",
-                           "Truncating the number!"));
-      number %= (uint64_t)pow(2, bitstoWrite);
+  if (bitstoWrite < 64 && (number >> bitstoWrite) != 0){
+      reportStoreError(STORE_TRUNCATED,
+                       ERROR_MESSAGE("writeNumBitstoStore",
+                                     "WARNING: given number is bigger than"
+                                     " requested bit length",
+                                     "Truncating the number!"));
+      number = bitstoWrite ? number & widthMask(bitstoWrite) : 0;
+  }
+
+  /* bits above the 64 bits of number are written as leading zeros,
+   * the number itself goes to the last bits of the field in one step.*/
+  uint64_t fieldStart = wordStartBit;
+  while (bitstoWrite > 64){
+    uint64_t zeroBits = (bitstoWrite - 64 < 64) ? bitstoWrite - 64 : 64;
+    if (writeFieldBits(STORE, location, fieldStart, zeroBits, 0))
+      break;
+    fieldStart += zeroBits;
+    bitstoWrite -= zeroBits;
+  }
+  if (bitstoWrite > 64 ||
+      (bitstoWrite && writeFieldBits(STORE, location, fieldStart,
+                                     bitstoWrite, number))){
+    reportStoreError(STORE_WRITE_FAILED,
+                     ERROR_MESSAGE("writeNumBitstoStore",
+                                   "store read only or page not allocated",
+                                   "returning -1"));
+    return -1;
   }
 
-  bool *bitArray = numbertoBitString(number, bitstoWrite);
-  writeMultiBitstoStore (STORE, location, wordStartBit, bitArray,
-                         bitstoWrite);
   return 0;
 }
 
@@ -233,8 +472,10 @@ uint64_t bitStringtoNumber (bool bitString[], uint64_t bitLength){
 uint64_t readNumBitsfromStore(store STORE, const uint64_t location,
                               const uint64_t wordStartBit, uint64_t bitWidth){
   if (checkStore(STORE, location, wordStartBit)){
-    printf(ERROR_MESSAGE("readNumBitsfromStore","checkStore returned -1",
-                          "Returning 0"));
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("readNumBitsfromStore",
+                                   "checkStore returned -1",
+                                    "Returning 0"));
     return 0;
   }
 
@@ -242,19 +483,22 @@ uint64_t readNumBitsfromStore(store STORE, const uint64_t location,
   uint64_t bitstoRead = bitWidth;
 
   if(availableBits < bitWidth){
-    printf(ERROR_MESSAGE("readNumBitstoStore",
-                         "available bits in word after wordStartBit less"\
-                         " than requested number of bits",
-                         "returning number of smaller bit "\
-                         "size than requested"));
+    reportStoreError(STORE_TRUNCATED,
+                     ERROR_MESSAGE("readNumBitstoStore",
+                                   "available bits in word after wordStartBit less"\
+                                   " than requested number of bits",
+                                   "returning number of smaller bit "\
+                                   "size than requested"));
     bitstoRead = availableBits;
   }
 
-  bool *bitArray = readMultiBitsfromStore(STORE, location,
-                                          wordStartBit, bitstoRead);
-  uint64_t number = bitStringtoNumber(bitArray, bitstoRead);
+  /* only the last 64 bits of a wider field fit in the number.*/
+  if (bitstoRead > 64)
+    return readFieldBits(STORE, location, wordStartBit + bitstoRead - 64, 64);
+  if (bitstoRead == 0)
+    return 0;
 
-  return number;
+  return readFieldBits(STORE, location, wordStartBit, bitstoRead);
 }
 
 
@@ -272,10 +516,11 @@ uint64_t giveBytestoUse (const uint64_t wordSize, const uint64_t wordStartBit,
   uint64_t availableBytes = (wordSize - wordStartBit) / 8;
   uint64_t bytestoUse = byteLength;
   if (availableBytes < byteLength){
-    printf(ERROR_MESSAGE("giveBytestoUse",
-                         "WARNING: available byte length is smaller "\
-                         "than requested byte length ",
-                         "using available bytes only."));
+    reportStoreError(STORE_TRUNCATED,
+                     ERROR_MESSAGE("giveBytestoUse",
+                                   "WARNING: available byte length is smaller "\
+                                   "than requested byte length ",
+                                   "using available bytes only."));
     bytestoUse = availableBytes;
   }
 
@@ -290,19 +535,157 @@ uint64_t giveBytestoUse (const uint64_t wordSize, const uint64_t wordStartBit,
  * Returns the inverted number.
  * Truncates the higher significant bits when number is large to
  * store in byteLength.
+ * Done with a single hardware byte swap.
  */
 uint64_t invertEndian(uint64_t number, unsigned byteLength){
   //cannot convert number greater than 8 bytes
-  byteLength = byteLength*!(byteLength/8) + 8*(bool)(byteLength/8);
+  if (byteLength == 0)
+    return 0;
+  if (byteLength > 8)
+    byteLength = 8;
+
+  return __builtin_bswap64(number) >> (64 - 8 * byteLength);
+}
 
-  uint64_t result = 0;
 
-  for (unsigned index = 0; index < byteLength; index++){
-    result = result*256 + number % 256;
-    number /= 256;
+
+/* uint64_t bytestoNumber(const uint8_t bytes[], unsigned byteLength,
+                          const bool endianStyle):
+ * Returns byteLength (1 to 8) bytes as a number in given endian style,
+ * a plain load when the endian style is the host's, else load and swap.
+ */
+static inline uint64_t bytestoNumber(const uint8_t bytes[],
+                                     unsigned byteLength,
+                                     const bool endianStyle){
+  uint64_t number = 0;
+  memcpy(&number, bytes, byteLength);
+#if HOSTENDIAN == LITTLEENDIAN
+  if (endianStyle == BIGENDIAN)
+    number = __builtin_bswap64(number) >> (64 - 8 * byteLength);
+#else
+  if (endianStyle == LITTLEENDIAN)
+    number = __builtin_bswap64(number);
+  else
+    number >>= 64 - 8 * byteLength;
+#endif
+  return number;
+}
+
+
+
+/* void numbertoBytes(uint8_t bytes[], unsigned byteLength, uint64_t number,
+                      const bool endianStyle):
+ * Stores lowest byteLength (1 to 8) bytes of number in bytes in given
+ * endian style, the reverse of bytestoNumber.
+ */
+static inline void numbertoBytes(uint8_t bytes[], unsigned byteLength,
+                                 uint64_t number, const bool endianStyle){
+#if HOSTENDIAN == LITTLEENDIAN
+  if (endianStyle == BIGENDIAN)
+    number = __builtin_bswap64(number << (64 - 8 * byteLength));
+#else
+  if (endianStyle == LITTLEENDIAN)
+    number = __builtin_bswap64(number);
+  else
+    number <<= 64 - 8 * byteLength;
+#endif
+  memcpy(bytes, &number, byteLength);
+}
+
+
+
+/* int deviceforBytes(const store *STORE, uint64_t location,
+                      uint64_t wordStartBit, uint64_t byteLength,
+                      bool writing, const struct deviceRange **device):
+ * Sets *device to the device handling byteLength bytes from wordStartBit
+ * of location, or to NULL if the store does, see deviceofAccess.
+ * Returns 0, or -1 if the bytes run out of the range of a device.
+ */
+static int deviceforBytes(const store *STORE, uint64_t location,
+                          uint64_t wordStartBit, uint64_t byteLength,
+                          bool writing, const struct deviceRange **device){
+  uint64_t lastLocation = location + (wordStartBit + 8 * byteLength - 1) /
+                                     STORE->wordSize;
+  return deviceofAccess(STORE->devices, location, lastLocation, writing,
+                        device);
+}
+
+
+
+/* int writeBytesinStyle (store STORE, uint64_t location,
+                          const uint64_t wordStartBit, uint64_t number,
+                          uint64_t byteLength, const bool endianStyle):
+ * Body of writeBytestoStore and its endian specific entry points, which
+ * pass a constant endianStyle so the compiler drops the other style.
+ * Bytes starting on a byte of a packed kind in one page are stored with a
+ * single copy, else go through writeNumBitstoStore. Bytes in the range
+ * of a device go to its handler instead, see storedevice.h.
+ */
+static inline int writeBytesinStyle (store STORE, uint64_t location,
+                                     const uint64_t wordStartBit,
+                                     uint64_t number, uint64_t byteLength,
+                                     const bool endianStyle){
+  if (checkStore(STORE, location, wordStartBit)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("writeBytestoStore",
+                                   "checkStore returned -1",
+                                   "Returning -1"));
+    return -1;
+  }
+
+  uint64_t bytestoWrite = giveBytestoUse(STORE.wordSize, wordStartBit,
+                                         byteLength);
+  if (bytestoWrite == 0)
+    return 0;
+
+  const struct deviceRange *device = NULL;
+  if (STORE.devices != NULL &&
+      deviceforBytes(&STORE, location, wordStartBit, bytestoWrite, true,
+                     &device)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("writeBytestoStore",
+                                   "bytes run out of the range of a device",
+                                   "returning -1"));
+    return -1;
+  }
+  if (device != NULL){
+    if (bytestoWrite < 8)
+      number &= ((uint64_t)1 << (8 * bytestoWrite)) - 1;
+    return device->write(device->context, location, wordStartBit, number,
+                         bytestoWrite, endianStyle);
+  }
+
+  uint64_t bit = location * STORE.wordSize + wordStartBit;
+  if (STORE.kind != MATRIX_STORE && !storeTracesAccesses(&STORE) &&
+      bit % 8 == 0 && bytestoWrite <= 8){
+    uint64_t availableBytes;
+    uint8_t *bytes = storeBytesforWrite(&STORE, bit / 8, &availableBytes);
+    if (bytes != NULL && availableBytes >= bytestoWrite){
+      if (bytestoWrite < 8 && (number >> (8 * bytestoWrite)) != 0)
+        reportStoreError(STORE_TRUNCATED,
+                         ERROR_MESSAGE("writeBytestoStore",
+                                       "WARNING: given number is bigger than"
+                                       " requested byte length",
+                                       "Truncating the number!"));
+      numbertoBytes(bytes, bytestoWrite, number, endianStyle);
+      return 0;
+    }
   }
 
-  return result;
+  if (endianStyle == LITTLEENDIAN){
+    number = invertEndian(number, bytestoWrite);
+  }
+
+  if(writeNumBitstoStore(STORE, location, wordStartBit, number,
+                         bytestoWrite * 8)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("writeBytestoStore",
+                                   "writeNumBitstoStore returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
 }
 
 
@@ -319,29 +702,101 @@ uint64_t invertEndian(uint64_t number, unsigned byteLength){
 int writeBytestoStore (store STORE, uint64_t location,
                        const uint64_t wordStartBit, uint64_t number,
                        uint64_t byteLength, const bool endianStyle){
+  if (endianStyle == LITTLEENDIAN)
+    return writeBytesinStyle(STORE, location, wordStartBit, number,
+                             byteLength, LITTLEENDIAN);
+
+  return writeBytesinStyle(STORE, location, wordStartBit, number,
+                           byteLength, BIGENDIAN);
+}
+
+
+
+/* int writeLittleEndianBytestoStore (store STORE, uint64_t location,
+                                      const uint64_t wordStartBit,
+                                      uint64_t number, uint64_t byteLength):
+ * writeBytestoStore with endian style fixed to LITTLEENDIAN at compile
+ * time. On a little endian host it stores the bytes with no conversion.
+ */
+int writeLittleEndianBytestoStore (store STORE, uint64_t location,
+                                   const uint64_t wordStartBit,
+                                   uint64_t number, uint64_t byteLength){
+  return writeBytesinStyle(STORE, location, wordStartBit, number,
+                           byteLength, LITTLEENDIAN);
+}
+
+
+
+/* int writeBigEndianBytestoStore (store STORE, uint64_t location,
+                                   const uint64_t wordStartBit,
+                                   uint64_t number, uint64_t byteLength):
+ * writeBytestoStore with endian style fixed to BIGENDIAN at compile time.
+ */
+int writeBigEndianBytestoStore (store STORE, uint64_t location,
+                                const uint64_t wordStartBit,
+                                uint64_t number, uint64_t byteLength){
+  return writeBytesinStyle(STORE, location, wordStartBit, number,
+                           byteLength, BIGENDIAN);
+}
+
+
+
+/* uint64_t readBytesinStyle (const store STORE, const uint64_t location,
+                              const uint64_t wordStartBit,
+                              const unsigned byteLength,
+                              const bool endianStyle):
+ * Body of readBytesfromStore and its endian specific entry points, the
+ * reverse of writeBytesinStyle.
+ */
+static inline uint64_t readBytesinStyle (const store STORE,
+                                         const uint64_t location,
+                                         const uint64_t wordStartBit,
+                                         const unsigned byteLength,
+                                         const bool endianStyle){
   if (checkStore(STORE, location, wordStartBit)){
-    printf(ERROR_MESSAGE("writeBytestoStore",
-                         "checkStore returned -1",
-                         "Returning -1"));
-    return -1;
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("readBytesfromStore", "checkStore return -1",
+                                   "returning 0"));
+    return 0;
   }
 
-  uint64_t bytestoWrite = giveBytestoUse(STORE.wordSize, wordStartBit,
-                                         byteLength);
+  uint64_t bytestoRead = giveBytestoUse(STORE.wordSize, wordStartBit,
+                                        byteLength);
+  if (bytestoRead == 0)
+    return 0;
 
-  if (endianStyle == LITTLEENDIAN){
-    number = invertEndian(number, bytestoWrite);
+  const struct deviceRange *device = NULL;
+  if (STORE.devices != NULL &&
+      deviceforBytes(&STORE, location, wordStartBit, bytestoRead, false,
+                     &device)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("readBytesfromStore",
+                                   "bytes run out of the range of a device",
+                                   "returning 0"));
+    return 0;
+  }
+  if (device != NULL)
+    return device->read(device->context, location, wordStartBit,
+                        bytestoRead, endianStyle);
+
+  uint64_t bit = location * STORE.wordSize + wordStartBit;
+  if (STORE.kind != MATRIX_STORE && !storeTracesAccesses(&STORE) &&
+      bit % 8 == 0 && bytestoRead <= 8){
+    uint64_t availableBytes;
+    const uint8_t *bytes = storeBytesforRead(&STORE, bit / 8,
+                                             &availableBytes);
+    if (availableBytes >= bytestoRead)
+      return bytestoNumber(bytes, bytestoRead, endianStyle);
   }
 
-  if(writeNumBitstoStore(STORE, location, wordStartBit, number,
-                         bytestoWrite * 8)){
-    printf(ERROR_MESSAGE("writeBytestoStore",
-                         "writeNumBitstoStore returned -1",
-                         "returning -1"));
-    return -1;
+  uint64_t number = readNumBitsfromStore(STORE, location, wordStartBit,
+                                         bytestoRead * 8);
+
+  if (endianStyle == LITTLEENDIAN){
+    number = invertEndian(number, bytestoRead);
   }
 
-  return 0;
+  return number;
 }
 
 
@@ -360,21 +815,280 @@ uint64_t readBytesfromStore (const store STORE, const uint64_t location,
                              const uint64_t wordStartBit,
                              const unsigned byteLength,
                              const bool endianStyle){
-  if (checkStore(STORE, location, wordStartBit)){
-    printf(ERROR_MESSAGE("readBytesfromStore", "checkStore return -1",
-                         "returning 0"));
+  if (endianStyle == LITTLEENDIAN)
+    return readBytesinStyle(STORE, location, wordStartBit, byteLength,
+                            LITTLEENDIAN);
+
+  return readBytesinStyle(STORE, location, wordStartBit, byteLength,
+                          BIGENDIAN);
+}
+
+
+
+/* uint64_t readLittleEndianBytesfromStore (const store STORE,
+                                            const uint64_t location,
+                                            const uint64_t wordStartBit,
+                                            const unsigned byteLength):
+ * readBytesfromStore with endian style fixed to LITTLEENDIAN at compile
+ * time. On a little endian host it loads the bytes with no conversion.
+ */
+uint64_t readLittleEndianBytesfromStore (const store STORE,
+                                         const uint64_t location,
+                                         const uint64_t wordStartBit,
+                                         const unsigned byteLength){
+  return readBytesinStyle(STORE, location, wordStartBit, byteLength,
+                          LITTLEENDIAN);
+}
+
+
+
+/* uint64_t readBigEndianBytesfromStore (const store STORE,
+                                         const uint64_t location,
+                                         const uint64_t wordStartBit,
+                                         const unsigned byteLength):
+ * readBytesfromStore with endian style fixed to BIGENDIAN at compile time.
+ */
+uint64_t readBigEndianBytesfromStore (const store STORE,
+                                      const uint64_t location,
+                                      const uint64_t wordStartBit,
+                                      const unsigned byteLength){
+  return readBytesinStyle(STORE, location, wordStartBit, byteLength,
+                          BIGENDIAN);
+}
+
+
+
+/* void reverseBytes(uint8_t bytes[], unsigned byteLength):
+ * Reverses order of the first byteLength (1, 2, 4, 8 or 16) bytes of the
+ * array with hardware byte swaps.
+ */
+static void reverseBytes(uint8_t bytes[], unsigned byteLength){
+  uint64_t high, low;
+
+  switch (byteLength){
+    case 2: {
+      uint16_t value;
+      memcpy(&value, bytes, 2);
+      value = __builtin_bswap16(value);
+      memcpy(bytes, &value, 2);
+      break;
+    }
+    case 4: {
+      uint32_t value;
+      memcpy(&value, bytes, 4);
+      value = __builtin_bswap32(value);
+      memcpy(bytes, &value, 4);
+      break;
+    }
+    case 8:
+      memcpy(&low, bytes, 8);
+      low = __builtin_bswap64(low);
+      memcpy(bytes, &low, 8);
+      break;
+    case 16:
+      memcpy(&low, bytes, 8);
+      memcpy(&high, bytes + 8, 8);
+      low = __builtin_bswap64(low);
+      high = __builtin_bswap64(high);
+      memcpy(bytes, &high, 8);
+      memcpy(bytes + 8, &low, 8);
+      break;
+  }
+}
+
+
+
+/* int checkValueAccess(const store STORE, const uint64_t location,
+                        const uint64_t wordStartBit,
+                        const unsigned byteLength):
+ * Checks whether store is initialized, byteLength is 1, 2, 4, 8 or 16, and
+ * all byteLength bytes from wordStartBit of location lie inside the store,
+ * counting the bits of the following locations too.
+ * Returns 0 if so, else -1.
+ */
+static int checkValueAccess(const store STORE, const uint64_t location,
+                            const uint64_t wordStartBit,
+                            const unsigned byteLength){
+  if (checkStore(STORE, location, wordStartBit))
+    return -1;
+  if (STORE_CHECK_FAILS(byteLength == 0 || byteLength > 16 ||
+                        (byteLength & (byteLength - 1)) != 0)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("checkValueAccess",
+                                   "byteLength must be 1, 2, 4, 8 or 16",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint64_t bit = location * STORE.wordSize + wordStartBit;
+  uint64_t totalBits = STORE.totalLocations * STORE.wordSize;
+  if (STORE_CHECK_FAILS(totalBits - bit < 8 * (uint64_t)byteLength)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("checkValueAccess",
+                                   "requested bytes run past the end of the store",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int checkDeviceValue(const unsigned byteLength, const char *caller):
+ * Checks whether a value of byteLength bytes fits the number given to
+ * device handlers, reporting the error as caller's if not.
+ * Returns 0 if so, else -1.
+ */
+static int checkDeviceValue(const unsigned byteLength, const char *caller){
+  if (byteLength > 8){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     "\nin %s:\ndevices take values up to 8 bytes, "
+                     "returning -1\n", caller);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int readValuefromStore(const store STORE, const uint64_t location,
+                          const uint64_t wordStartBit,
+                          const unsigned byteLength, const bool endianStyle,
+                          void *value):
+ * Reads byteLength (1, 2, 4, 8 or 16) bytes from wordStartBit of location
+ * and the locations after it, treating consecutive locations as one byte
+ * addressable space, e.g. a 32 bit load from a store of 8 bit words.
+ * Bytes are taken as a number in given endian style and stored in value as
+ * a host integer of byteLength bytes (uint8_t to uint64_t, or two uint64_t
+ * in host order for 16 bytes).
+ * Checks bounds once. When the bytes start on a byte of a packed kind and
+ * lie in one page, it is a single copy, plus byte swap if endian style
+ * differs from the host's. Values in the range of a device go to its
+ * handler, see storedevice.h, and can't be wider than 8 bytes.
+ * Returns 0 if read, else -1.
+ */
+int readValuefromStore(const store STORE, const uint64_t location,
+                       const uint64_t wordStartBit, const unsigned byteLength,
+                       const bool endianStyle, void *value){
+  if (checkValueAccess(STORE, location, wordStartBit, byteLength)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("readValuefromStore",
+                                   "checkValueAccess returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  const struct deviceRange *device = NULL;
+  if (STORE.devices != NULL &&
+      deviceforBytes(&STORE, location, wordStartBit, byteLength, false,
+                     &device)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("readValuefromStore",
+                                   "bytes run out of the range of a device",
+                                   "returning -1"));
+    return -1;
+  }
+  if (device != NULL){
+    if (checkDeviceValue(byteLength, "readValuefromStore"))
+      return -1;
+    numbertoBytes(value, byteLength,
+                  device->read(device->context, location, wordStartBit,
+                               byteLength, endianStyle), HOSTENDIAN);
     return 0;
   }
 
-  uint64_t bytestoRead = giveBytestoUse(STORE.wordSize, wordStartBit,
-                                        byteLength);
+  uint64_t bit = location * STORE.wordSize + wordStartBit;
+  uint8_t bytes[16];
 
-  uint64_t number = readNumBitsfromStore(STORE, location, wordStartBit,
-                                         bytestoRead * 8);
+  uint64_t availableBytes = 0;
+  const uint8_t *source = NULL;
+  if (STORE.kind != MATRIX_STORE && !storeTracesAccesses(&STORE) &&
+      bit % 8 == 0)
+    source = storeBytesforRead(&STORE, bit / 8, &availableBytes);
 
-  if (endianStyle == LITTLEENDIAN){
-    number = invertEndian(number, bytestoRead);
+  if (source != NULL && availableBytes >= byteLength){
+    memcpy(bytes, source, byteLength);
+  }
+  else {
+    for (unsigned index = 0; index < byteLength; index++)
+      bytes[index] = readStoreBits(&STORE, bit + 8 * index, 8);
   }
 
-  return number;
+  if (endianStyle != HOSTENDIAN)
+    reverseBytes(bytes, byteLength);
+  memcpy(value, bytes, byteLength);
+
+  return 0;
+}
+
+
+
+/* int writeValuetoStore(store STORE, const uint64_t location,
+                         const uint64_t wordStartBit,
+                         const unsigned byteLength, const bool endianStyle,
+                         const void *value):
+ * Same as readValuefromStore, but writes the host integer of byteLength
+ * bytes at value to the store in given endian style.
+ * Returns 0 if written, else -1.
+ */
+int writeValuetoStore(store STORE, const uint64_t location,
+                      const uint64_t wordStartBit, const unsigned byteLength,
+                      const bool endianStyle, const void *value){
+  if (checkValueAccess(STORE, location, wordStartBit, byteLength)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("writeValuetoStore",
+                                   "checkValueAccess returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  const struct deviceRange *device = NULL;
+  if (STORE.devices != NULL &&
+      deviceforBytes(&STORE, location, wordStartBit, byteLength, true,
+                     &device)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("writeValuetoStore",
+                                   "bytes run out of the range of a device",
+                                   "returning -1"));
+    return -1;
+  }
+  if (device != NULL){
+    if (checkDeviceValue(byteLength, "writeValuetoStore"))
+      return -1;
+    return device->write(device->context, location, wordStartBit,
+                         bytestoNumber(value, byteLength, HOSTENDIAN),
+                         byteLength, endianStyle);
+  }
+
+  uint64_t bit = location * STORE.wordSize + wordStartBit;
+  uint8_t bytes[16];
+
+  memcpy(bytes, value, byteLength);
+  if (endianStyle != HOSTENDIAN)
+    reverseBytes(bytes, byteLength);
+
+  uint64_t availableBytes = 0;
+  uint8_t *destination = NULL;
+  if (STORE.kind != MATRIX_STORE && !storeTracesAccesses(&STORE) &&
+      bit % 8 == 0)
+    destination = storeBytesforWrite(&STORE, bit / 8, &availableBytes);
+
+  if (destination != NULL && availableBytes >= byteLength){
+    memcpy(destination, bytes, byteLength);
+    return 0;
+  }
+
+  for (unsigned index = 0; index < byteLength; index++){
+    if (writeStoreBits(&STORE, bit + 8 * index, 8, bytes[index])){
+      reportStoreError(STORE_WRITE_FAILED,
+                       ERROR_MESSAGE("writeValuetoStore",
+                                     "store read only or page not allocated",
+                                     "returning -1"));
+      return -1;
+    }
+  }
+
+  return 0;
 }
@@ -0,0 +1,690 @@
+#include "store/vectorstore.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "store/store.h"
+#include "store/storeblock.h"
+#include "store/storeerror.h"
+#include "store/storeutil.h"
+#include "packedbits.h"
+
+#define ERROR_MESSAGE(location,reason,reaction) ("\nin " location ":\n"\
+                                                 reason ", " reaction "\n")
+
+#define VECTOR_MAX_BYTES (STORE_VECTOR_MAX_BITS / 8)
+
+/* Host vector kernels, built with the vector extensions of GCC and Clang so
+ * the compiler emits the widest instructions enabled for the build: chunks
+ * of WIDE_CHUNK_BYTES first, then of 16 bytes, leaving the elements past
+ * the last chunk to the element loops.
+ */
+#if defined(__GNUC__)
+#define LANE_CHUNKS
+
+#if defined(__AVX512BW__)
+#define WIDE_CHUNK_BYTES 64
+#elif defined(__AVX2__)
+#define WIDE_CHUNK_BYTES 32
+#else
+#define WIDE_CHUNK_BYTES 16
+#endif
+
+/* Elements are stored most significant byte first, lanes of a little
+ * endian host are swapped around arithmetic, 'step' bytes at a time.
+ * Shifts are taken modulo the lane so steps a lane doesn't need still
+ * compile.
+ */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SWAP_STEP(v, laneType, laneBits, step, low)                          \
+  if ((step) < (laneBits))                                                   \
+    v = ((v << ((step) % (laneBits))) & (laneType)~(uint64_t)(low)) |        \
+        ((v >> ((step) % (laneBits))) & (laneType)(low))
+#define SWAP_LANES(v, laneType, laneBits)                                    \
+  do{                                                                        \
+    SWAP_STEP(v, laneType, laneBits, 8, 0x00ff00ff00ff00ffULL);              \
+    SWAP_STEP(v, laneType, laneBits, 16, 0x0000ffff0000ffffULL);             \
+    SWAP_STEP(v, laneType, laneBits, 32, 0x00000000ffffffffULL);             \
+  }while (0)
+#else
+#define SWAP_LANES(v, laneType, laneBits) do{}while (0)
+#endif
+
+#define DEFINE_LANE_KERNELS(laneBits, suffix, chunkBytes)                    \
+typedef uint##laneBits##_t lanes##laneBits##suffix                           \
+        __attribute__((vector_size(chunkBytes)));                            \
+                                                                             \
+static uint64_t addChunks##laneBits##suffix(uint8_t *destination,           \
+                                             const uint8_t *source1,         \
+                                             const uint8_t *source2,         \
+                                             uint64_t totalBytes,            \
+                                             uint64_t done, bool subtract){  \
+  for (; done + (chunkBytes) <= totalBytes; done += (chunkBytes)){           \
+    lanes##laneBits##suffix x, y;                                            \
+    memcpy(&x, source1 + done, sizeof(x));                                   \
+    memcpy(&y, source2 + done, sizeof(y));                                   \
+    SWAP_LANES(x, uint##laneBits##_t, laneBits);                             \
+    SWAP_LANES(y, uint##laneBits##_t, laneBits);                             \
+    x = subtract ? x - y : x + y;                                            \
+    SWAP_LANES(x, uint##laneBits##_t, laneBits);                             \
+    memcpy(destination + done, &x, sizeof(x));                               \
+  }                                                                          \
+  return done;                                                               \
+}                                                                            \
+                                                                             \
+static uint64_t compareChunks##laneBits##suffix(uint8_t *mask,               \
+                                    const uint8_t *source1,                  \
+                                    const uint8_t *source2,                  \
+                                    uint64_t totalBytes, uint64_t done,      \
+                                    vectorComparison comparison){            \
+  const uint##laneBits##_t sign = (uint##laneBits##_t)1 << ((laneBits) - 1); \
+  for (; done + (chunkBytes) <= totalBytes; done += (chunkBytes)){           \
+    lanes##laneBits##suffix x, y;                                            \
+    memcpy(&x, source1 + done, sizeof(x));                                   \
+    memcpy(&y, source2 + done, sizeof(y));                                   \
+    __typeof__(x == y) result;                                               \
+    switch (comparison){                                                     \
+      case VECTOR_EQUAL:                                                     \
+        result = x == y;                                                     \
+        break;                                                               \
+      case VECTOR_NOT_EQUAL:                                                 \
+        result = x != y;                                                     \
+        break;                                                               \
+      case VECTOR_LESS_UNSIGNED:                                             \
+      default:                                                               \
+        SWAP_LANES(x, uint##laneBits##_t, laneBits);                         \
+        SWAP_LANES(y, uint##laneBits##_t, laneBits);                         \
+        if (comparison == VECTOR_LESS_SIGNED){                               \
+          x ^= sign;                                                         \
+          y ^= sign;                                                         \
+        }                                                                    \
+        result = x < y;                                                      \
+        break;                                                               \
+    }                                                                        \
+    uint64_t element = done / ((laneBits) / 8);                              \
+    for (unsigned lane = 0; lane < sizeof(x) / sizeof(x[0]); lane++)         \
+      setMaskBit(mask, element + lane, result[lane] != 0);                   \
+  }                                                                          \
+  return done;                                                               \
+}                                                                            \
+                                                                             \
+static uint64_t mergeChunks##laneBits##suffix(uint8_t *destination,         \
+                                              const uint8_t *source1,        \
+                                              const uint8_t *source2,        \
+                                              const uint8_t *mask,           \
+                                              uint64_t totalBytes,           \
+                                              uint64_t done){                \
+  for (; done + (chunkBytes) <= totalBytes; done += (chunkBytes)){           \
+    lanes##laneBits##suffix x, y, select;                                    \
+    memcpy(&x, source1 + done, sizeof(x));                                   \
+    memcpy(&y, source2 + done, sizeof(y));                                   \
+    uint64_t element = done / ((laneBits) / 8);                              \
+    for (unsigned lane = 0; lane < sizeof(x) / sizeof(x[0]); lane++)         \
+      select[lane] = -(uint##laneBits##_t)maskBit(mask, element + lane);     \
+    x = (x & ~select) | (y & select);                                        \
+    memcpy(destination + done, &x, sizeof(x));                               \
+  }                                                                          \
+  return done;                                                               \
+}
+
+#endif
+
+
+
+/* bool maskBit(const uint8_t *mask, uint64_t element):
+ * Returns the bit of element in mask register bytes.
+ */
+static inline bool maskBit(const uint8_t *mask, uint64_t element){
+  return (mask[element / 8] >> (7 - element % 8)) & 1;
+}
+
+
+
+/* void setMaskBit(uint8_t *mask, uint64_t element, bool value):
+ * Sets the bit of element in mask register bytes to value.
+ */
+static inline void setMaskBit(uint8_t *mask, uint64_t element, bool value){
+  uint8_t bit = 0x80 >> (element % 8);
+  mask[element / 8] = value ? (mask[element / 8] | bit) :
+                              (mask[element / 8] & ~bit);
+}
+
+
+
+#ifdef LANE_CHUNKS
+DEFINE_LANE_KERNELS(8, Wide, WIDE_CHUNK_BYTES)
+DEFINE_LANE_KERNELS(16, Wide, WIDE_CHUNK_BYTES)
+DEFINE_LANE_KERNELS(32, Wide, WIDE_CHUNK_BYTES)
+DEFINE_LANE_KERNELS(64, Wide, WIDE_CHUNK_BYTES)
+DEFINE_LANE_KERNELS(8, Narrow, 16)
+DEFINE_LANE_KERNELS(16, Narrow, 16)
+DEFINE_LANE_KERNELS(32, Narrow, 16)
+DEFINE_LANE_KERNELS(64, Narrow, 16)
+#endif
+
+
+
+/* int checkVectors(const store *STORE, const unsigned elementBits,
+                    const uint64_t locations[], const unsigned count):
+ * Checks whether store is initialized, its words can be split in elements
+ * of elementBits (8, 16, 32 or 64) bits for lane operations, and the count
+ * locations given are inside it.
+ * Returns 0 if so, else -1.
+ */
+static int checkVectors(const store *STORE, const unsigned elementBits,
+                        const uint64_t locations[], const unsigned count){
+  if (STORE_CHECK_FAILS(!STORE->set)){
+    reportStoreError(STORE_NOT_INITIALIZED,
+                     ERROR_MESSAGE("checkVectors", "STORE not initialized",
+                                   "returning -1"));
+    return -1;
+  }
+  if (STORE_CHECK_FAILS((elementBits != 8 && elementBits != 16 &&
+                         elementBits != 32 && elementBits != 64) ||
+                        STORE->wordSize % elementBits != 0 ||
+                        STORE->wordSize > STORE_VECTOR_MAX_BITS)){
+    reportStoreError(STORE_INVALID_ARGUMENT,
+                     ERROR_MESSAGE("checkVectors",
+                                   "words of %"PRIu64" bits can't be split "
+                                   "in lanes of %u bits", "returning -1"),
+                     STORE->wordSize, elementBits);
+    return -1;
+  }
+  for (unsigned index = 0; index < count; index++)
+    if (STORE_CHECK_FAILS(locations[index] >= STORE->totalLocations)){
+      reportStoreError(STORE_OUT_OF_BOUND,
+                       ERROR_MESSAGE("checkVectors",
+                                     "location %"PRIu64" out of bound",
+                                     "returning -1"), locations[index]);
+      return -1;
+    }
+
+  return 0;
+}
+
+
+
+/* const uint8_t *vectorforRead(const store *STORE, uint64_t location,
+                                uint8_t *buffer):
+ * Returns the bytes of the word at location, in place if the store keeps
+ * them contiguous and isn't traced, else gathered in buffer of
+ * VECTOR_MAX_BYTES.
+ */
+static const uint8_t *vectorforRead(const store *STORE, uint64_t location,
+                                    uint8_t *buffer){
+  uint64_t vectorBytes = STORE->wordSize / 8;
+
+  if (STORE->kind != MATRIX_STORE && !storeTracesAccesses(STORE)){
+    uint64_t availableBytes;
+    const uint8_t *bytes = storeBytesforRead(STORE, location * vectorBytes,
+                                             &availableBytes);
+    if (availableBytes >= vectorBytes)
+      return bytes;
+  }
+
+  readBlockfromStore(*STORE, location, 1, buffer);
+  return buffer;
+}
+
+
+
+/* uint8_t *vectorforWrite(const store *STORE, uint64_t location,
+                           uint8_t *buffer):
+ * Same as vectorforRead for a word to be changed. When it returns buffer,
+ * the word is only changed by storeVector.
+ */
+static uint8_t *vectorforWrite(const store *STORE, uint64_t location,
+                               uint8_t *buffer){
+  uint64_t vectorBytes = STORE->wordSize / 8;
+
+  if (STORE->kind != MATRIX_STORE && !storeTracesAccesses(STORE)){
+    uint64_t availableBytes;
+    uint8_t *bytes = storeBytesforWrite(STORE, location * vectorBytes,
+                                        &availableBytes);
+    if (bytes && availableBytes >= vectorBytes)
+      return bytes;
+  }
+
+  readBlockfromStore(*STORE, location, 1, buffer);
+  return buffer;
+}
+
+
+
+/* int storeVector(const store *STORE, uint64_t location,
+                   const uint8_t *bytes, const uint8_t *buffer):
+ * Ends a vectorforWrite: writes the word back if it was gathered in buffer.
+ * Returns 0, or -1 if the store can't be written.
+ */
+static int storeVector(const store *STORE, uint64_t location,
+                       const uint8_t *bytes, const uint8_t *buffer){
+  if (bytes != buffer)
+    return 0;
+
+  return writeBlocktoStore(*STORE, location, 1, buffer);
+}
+
+
+
+/* uint64_t readVectorElement(const store STORE, const uint64_t location,
+                              const uint64_t element,
+                              const unsigned elementBits):
+ * Takes store object, location of the vector register, index of the
+ * element and its size in bits (1 to 64), returns the element, or 0 if it
+ * is not inside the word.
+ */
+uint64_t readVectorElement(const store STORE, const uint64_t location,
+                           const uint64_t element, const unsigned elementBits){
+  if (STORE_CHECK_FAILS(elementBits == 0 || elementBits > 64 ||
+                        element >= STORE.wordSize / elementBits)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("readVectorElement",
+                                   "element %"PRIu64" of %u bits out of word",
+                                   "returning 0"), element, elementBits);
+    return 0;
+  }
+
+  return readFieldfromStore(STORE, location, element * elementBits,
+                            elementBits);
+}
+
+
+
+/* int writeVectorElement(store STORE, const uint64_t location,
+                          const uint64_t element, const unsigned elementBits,
+                          const uint64_t number):
+ * Same as readVectorElement, but writes lowest elementBits bits of number
+ * as the element. Returns 0 if written, else -1.
+ */
+int writeVectorElement(store STORE, const uint64_t location,
+                       const uint64_t element, const unsigned elementBits,
+                       const uint64_t number){
+  if (STORE_CHECK_FAILS(elementBits == 0 || elementBits > 64 ||
+                        element >= STORE.wordSize / elementBits)){
+    reportStoreError(STORE_OUT_OF_BOUND,
+                     ERROR_MESSAGE("writeVectorElement",
+                                   "element %"PRIu64" of %u bits out of word",
+                                   "returning -1"), element, elementBits);
+    return -1;
+  }
+
+  return writeFieldtoStore(STORE, location, element * elementBits,
+                           elementBits, number);
+}
+
+
+
+/* int addorSubtractVectors(store STORE, const uint64_t destination,
+                            const uint64_t source1, const uint64_t source2,
+                            const unsigned elementBits,
+                            const bool subtract):
+ * Common part of addVectors and subtractVectors.
+ */
+static int addorSubtractVectors(store STORE, const uint64_t destination,
+                                const uint64_t source1,
+                                const uint64_t source2,
+                                const unsigned elementBits,
+                                const bool subtract){
+  uint64_t locations[] = {destination, source1, source2};
+  if (checkVectors(&STORE, elementBits, locations, 3))
+    return -1;
+
+  uint8_t buffer1[VECTOR_MAX_BYTES], buffer2[VECTOR_MAX_BYTES];
+  uint8_t destinationBuffer[VECTOR_MAX_BYTES];
+  const uint8_t *bytes1 = vectorforRead(&STORE, source1, buffer1);
+  const uint8_t *bytes2 = vectorforRead(&STORE, source2, buffer2);
+  uint8_t *result = vectorforWrite(&STORE, destination, destinationBuffer);
+  uint64_t totalBytes = STORE.wordSize / 8;
+  unsigned elementBytes = elementBits / 8;
+  uint64_t done = 0;
+
+#ifdef LANE_CHUNKS
+  switch (elementBits){
+    case 8:
+      done = addChunks8Wide(result, bytes1, bytes2, totalBytes, done,
+                            subtract);
+      done = addChunks8Narrow(result, bytes1, bytes2, totalBytes, done,
+                              subtract);
+      break;
+    case 16:
+      done = addChunks16Wide(result, bytes1, bytes2, totalBytes, done,
+                             subtract);
+      done = addChunks16Narrow(result, bytes1, bytes2, totalBytes, done,
+                               subtract);
+      break;
+    case 32:
+      done = addChunks32Wide(result, bytes1, bytes2, totalBytes, done,
+                             subtract);
+      done = addChunks32Narrow(result, bytes1, bytes2, totalBytes, done,
+                               subtract);
+      break;
+    case 64:
+      done = addChunks64Wide(result, bytes1, bytes2, totalBytes, done,
+                             subtract);
+      done = addChunks64Narrow(result, bytes1, bytes2, totalBytes, done,
+                               subtract);
+      break;
+  }
+#endif
+
+  for (; done < totalBytes; done += elementBytes){
+    uint64_t x = loadBigEndianBytes(bytes1 + done, elementBytes);
+    uint64_t y = loadBigEndianBytes(bytes2 + done, elementBytes);
+    storeBigEndianBytes(result + done, elementBytes,
+                        subtract ? x - y : x + y);
+  }
+
+  return storeVector(&STORE, destination, result, destinationBuffer);
+}
+
+
+
+/* int addVectors(store STORE, const uint64_t destination,
+                  const uint64_t source1, const uint64_t source2,
+                  const unsigned elementBits):
+ * Takes store object, locations of the destination and source vector
+ * registers and size of their elements, sets every element of destination
+ * to the sum of the elements of the sources, wrapping around.
+ * Returns 0 if done, else -1.
+ */
+int addVectors(store STORE, const uint64_t destination,
+               const uint64_t source1, const uint64_t source2,
+               const unsigned elementBits){
+  if (addorSubtractVectors(STORE, destination, source1, source2, elementBits,
+                           false)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("addVectors", "unable to add vectors",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int subtractVectors(store STORE, const uint64_t destination,
+                       const uint64_t source1, const uint64_t source2,
+                       const unsigned elementBits):
+ * Same as addVectors, but elements of source2 are subtracted from those of
+ * source1.
+ * Returns 0 if done, else -1.
+ */
+int subtractVectors(store STORE, const uint64_t destination,
+                    const uint64_t source1, const uint64_t source2,
+                    const unsigned elementBits){
+  if (addorSubtractVectors(STORE, destination, source1, source2, elementBits,
+                           true)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("subtractVectors",
+                                   "unable to subtract vectors",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int compareVectors(store STORE, const uint64_t destinationMask,
+                      const uint64_t source1, const uint64_t source2,
+                      const unsigned elementBits,
+                      const vectorComparison comparison):
+ * Compares every element of source1 with the same element of source2 and
+ * sets bit i of destinationMask if the comparison holds for element i,
+ * clears it otherwise. Bits of the mask past the last element are left
+ * untouched. The mask may be one of the sources.
+ * Returns 0 if done, else -1.
+ */
+int compareVectors(store STORE, const uint64_t destinationMask,
+                   const uint64_t source1, const uint64_t source2,
+                   const unsigned elementBits,
+                   const vectorComparison comparison){
+  uint64_t locations[] = {destinationMask, source1, source2};
+  if (checkVectors(&STORE, elementBits, locations, 3)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("compareVectors",
+                                   "checkVectors returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint8_t buffer1[VECTOR_MAX_BYTES], buffer2[VECTOR_MAX_BYTES];
+  uint8_t mask[VECTOR_MAX_BYTES], destinationBuffer[VECTOR_MAX_BYTES];
+  const uint8_t *bytes1 = vectorforRead(&STORE, source1, buffer1);
+  const uint8_t *bytes2 = vectorforRead(&STORE, source2, buffer2);
+  uint64_t totalBytes = STORE.wordSize / 8;
+  unsigned elementBytes = elementBits / 8;
+  uint64_t maskBytes = (totalBytes / elementBytes + 7) / 8;
+  uint64_t done = 0;
+
+  memcpy(mask, vectorforRead(&STORE, destinationMask, destinationBuffer),
+         maskBytes);
+
+#ifdef LANE_CHUNKS
+  switch (elementBits){
+    case 8:
+      done = compareChunks8Wide(mask, bytes1, bytes2, totalBytes, done,
+                                comparison);
+      done = compareChunks8Narrow(mask, bytes1, bytes2, totalBytes, done,
+                                  comparison);
+      break;
+    case 16:
+      done = compareChunks16Wide(mask, bytes1, bytes2, totalBytes, done,
+                                 comparison);
+      done = compareChunks16Narrow(mask, bytes1, bytes2, totalBytes, done,
+                                   comparison);
+      break;
+    case 32:
+      done = compareChunks32Wide(mask, bytes1, bytes2, totalBytes, done,
+                                 comparison);
+      done = compareChunks32Narrow(mask, bytes1, bytes2, totalBytes, done,
+                                   comparison);
+      break;
+    case 64:
+      done = compareChunks64Wide(mask, bytes1, bytes2, totalBytes, done,
+                                 comparison);
+      done = compareChunks64Narrow(mask, bytes1, bytes2, totalBytes, done,
+                                   comparison);
+      break;
+  }
+#endif
+
+  uint64_t sign = (uint64_t)1 << (elementBits - 1);
+  for (; done < totalBytes; done += elementBytes){
+    uint64_t x = loadBigEndianBytes(bytes1 + done, elementBytes);
+    uint64_t y = loadBigEndianBytes(bytes2 + done, elementBytes);
+    bool holds;
+    switch (comparison){
+      case VECTOR_EQUAL:
+        holds = x == y;
+        break;
+      case VECTOR_NOT_EQUAL:
+        holds = x != y;
+        break;
+      case VECTOR_LESS_SIGNED:
+        holds = (x ^ sign) < (y ^ sign);
+        break;
+      case VECTOR_LESS_UNSIGNED:
+      default:
+        holds = x < y;
+        break;
+    }
+    setMaskBit(mask, done / elementBytes, holds);
+  }
+
+  uint8_t *result = vectorforWrite(&STORE, destinationMask,
+                                   destinationBuffer);
+  memcpy(result, mask, maskBytes);
+  if (storeVector(&STORE, destinationMask, result, destinationBuffer)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("compareVectors",
+                                   "unable to write the mask",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int mergeVectors(store STORE, const uint64_t destination,
+                    const uint64_t source1, const uint64_t source2,
+                    const uint64_t mask, const unsigned elementBits):
+ * Sets element i of destination to element i of source2 if bit i of mask
+ * is set, else to element i of source1. Any of the registers may be the
+ * same.
+ * Returns 0 if done, else -1.
+ */
+int mergeVectors(store STORE, const uint64_t destination,
+                 const uint64_t source1, const uint64_t source2,
+                 const uint64_t mask, const unsigned elementBits){
+  uint64_t locations[] = {destination, source1, source2, mask};
+  if (checkVectors(&STORE, elementBits, locations, 4)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("mergeVectors", "checkVectors returned -1",
+                                   "returning -1"));
+    return -1;
+  }
+
+  uint8_t buffer1[VECTOR_MAX_BYTES], buffer2[VECTOR_MAX_BYTES];
+  uint8_t maskBuffer[VECTOR_MAX_BYTES], destinationBuffer[VECTOR_MAX_BYTES];
+  const uint8_t *bytes1 = vectorforRead(&STORE, source1, buffer1);
+  const uint8_t *bytes2 = vectorforRead(&STORE, source2, buffer2);
+  uint64_t totalBytes = STORE.wordSize / 8;
+  unsigned elementBytes = elementBits / 8;
+  uint64_t done = 0;
+
+  /* mask is copied first, writing destination may overwrite it. */
+  uint8_t maskBits[VECTOR_MAX_BYTES];
+  memcpy(maskBits, vectorforRead(&STORE, mask, maskBuffer),
+         (totalBytes / elementBytes + 7) / 8);
+  uint8_t *result = vectorforWrite(&STORE, destination, destinationBuffer);
+
+#ifdef LANE_CHUNKS
+  switch (elementBits){
+    case 8:
+      done = mergeChunks8Wide(result, bytes1, bytes2, maskBits, totalBytes,
+                              done);
+      done = mergeChunks8Narrow(result, bytes1, bytes2, maskBits, totalBytes,
+                                done);
+      break;
+    case 16:
+      done = mergeChunks16Wide(result, bytes1, bytes2, maskBits, totalBytes,
+                               done);
+      done = mergeChunks16Narrow(result, bytes1, bytes2, maskBits,
+                                 totalBytes, done);
+      break;
+    case 32:
+      done = mergeChunks32Wide(result, bytes1, bytes2, maskBits, totalBytes,
+                               done);
+      done = mergeChunks32Narrow(result, bytes1, bytes2, maskBits,
+                                 totalBytes, done);
+      break;
+    case 64:
+      done = mergeChunks64Wide(result, bytes1, bytes2, maskBits, totalBytes,
+                               done);
+      done = mergeChunks64Narrow(result, bytes1, bytes2, maskBits,
+                                 totalBytes, done);
+      break;
+  }
+#endif
+
+  for (; done < totalBytes; done += elementBytes)
+    memmove(result + done,
+            (maskBit(maskBits, done / elementBytes) ? bytes2 : bytes1) + done,
+            elementBytes);
+
+  if (storeVector(&STORE, destination, result, destinationBuffer)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("mergeVectors",
+                                   "unable to write the destination",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int slideVector(store STORE, const uint64_t destination,
+                   const uint64_t source, const unsigned elementBits,
+                   const uint64_t offset, const bool up):
+ * Common part of slideVectorUp and slideVectorDown. Elements move as
+ * bytes, so the slide is a single memmove of the register.
+ */
+static int slideVector(store STORE, const uint64_t destination,
+                       const uint64_t source, const unsigned elementBits,
+                       const uint64_t offset, const bool up){
+  uint64_t locations[] = {destination, source};
+  if (checkVectors(&STORE, elementBits, locations, 2))
+    return -1;
+
+  uint8_t sourceBuffer[VECTOR_MAX_BYTES], destinationBuffer[VECTOR_MAX_BYTES];
+  uint8_t moved[VECTOR_MAX_BYTES];
+  uint64_t totalBytes = STORE.wordSize / 8;
+  uint64_t totalElements = STORE.wordSize / elementBits;
+  uint64_t shift = (offset < totalElements) ? offset * (elementBits / 8) :
+                                              totalBytes;
+
+  memcpy(moved, vectorforRead(&STORE, source, sourceBuffer), totalBytes);
+  uint8_t *result = vectorforWrite(&STORE, destination, destinationBuffer);
+
+  if (up)
+    memmove(result + shift, moved, totalBytes - shift);
+  else{
+    memmove(result, moved + shift, totalBytes - shift);
+    memset(result + totalBytes - shift, 0, shift);
+  }
+
+  return storeVector(&STORE, destination, result, destinationBuffer);
+}
+
+
+
+/* int slideVectorUp(store STORE, const uint64_t destination,
+                     const uint64_t source, const unsigned elementBits,
+                     const uint64_t offset):
+ * Sets element i + offset of destination to element i of source, elements
+ * of destination below offset are left untouched, as vslideup of RISC-V.
+ * Returns 0 if done, else -1.
+ */
+int slideVectorUp(store STORE, const uint64_t destination,
+                  const uint64_t source, const unsigned elementBits,
+                  const uint64_t offset){
+  if (slideVector(STORE, destination, source, elementBits, offset, true)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("slideVectorUp", "unable to slide vector",
+                                   "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
+
+
+
+/* int slideVectorDown(store STORE, const uint64_t destination,
+                       const uint64_t source, const unsigned elementBits,
+                       const uint64_t offset):
+ * Sets element i of destination to element i + offset of source, elements
+ * past the end of source give 0, as vslidedown of RISC-V.
+ * Returns 0 if done, else -1.
+ */
+int slideVectorDown(store STORE, const uint64_t destination,
+                    const uint64_t source, const unsigned elementBits,
+                    const uint64_t offset){
+  if (slideVector(STORE, destination, source, elementBits, offset, false)){
+    reportStoreError(lastStoreError(),
+                     ERROR_MESSAGE("slideVectorDown",
+                                   "unable to slide vector", "returning -1"));
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+#ifndef LIB_STORE_REGISTERFILE_H
+#define LIB_STORE_REGISTERFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+#include "store/storeerror.h"
+#include "store/storeutil.h"
+
+/* struct registerFile:
+ * Register file built on a PACKED_STORE of totalRegisters physical
+ * registers of wordSize (1 to 64) bits, of which windowRegisters are
+ * visible at a time from physical register 'base' on, wrapping around past
+ * the last physical register. Changing the window, to switch a bank or
+ * slide overlapping windows, only changes base.
+ * Visible registers 0 to 63 set in zeroRegisters are hardwired to zero,
+ * they read as 0 and writes to them are dropped.
+ */
+typedef struct{
+  store registers;
+  uint64_t windowRegisters;
+  uint64_t base;
+  uint64_t zeroRegisters;
+}registerFile;
+
+registerFile initializeRegisterFile(const uint64_t totalRegisters,
+                                    const uint64_t wordSize);
+registerFile initializeWindowedRegisterFile(const uint64_t windowRegisters,
+                                            const uint64_t totalRegisters,
+                                            const uint64_t wordSize);
+void destroyRegisterFile(registerFile *REGISTERFILE);
+int hardwireZeroRegister(registerFile *REGISTERFILE, const uint64_t index);
+int selectRegisterWindow(registerFile *REGISTERFILE, const uint64_t base);
+int readRegisters(const registerFile *REGISTERFILE, const uint64_t indices[],
+                  uint64_t values[], const unsigned count);
+int writeRegisters(registerFile *REGISTERFILE, const uint64_t indices[],
+                   const uint64_t values[], const unsigned count);
+
+/* uint64_t physicalRegister(const registerFile *REGISTERFILE,
+                             uint64_t index):
+ * Returns location in the store of visible register index, no checks.
+ */
+static inline uint64_t physicalRegister(const registerFile *REGISTERFILE,
+                                        uint64_t index){
+  uint64_t location = REGISTERFILE->base + index;
+  if (location >= REGISTERFILE->registers.totalLocations)
+    location -= REGISTERFILE->registers.totalLocations;
+  return location;
+}
+
+/* bool isZeroRegister(const registerFile *REGISTERFILE, uint64_t index):
+ * Returns true if visible register index is hardwired to zero.
+ */
+static inline bool isZeroRegister(const registerFile *REGISTERFILE,
+                                  uint64_t index){
+  return index < 64 && ((REGISTERFILE->zeroRegisters >> index) & 1);
+}
+
+/* uint64_t readRegister(const registerFile *REGISTERFILE, uint64_t index):
+ * Returns visible register index, or 0 if it's out of the window.
+ */
+static inline uint64_t readRegister(const registerFile *REGISTERFILE,
+                                    uint64_t index){
+  if (STORE_CHECK_FAILS(index >= REGISTERFILE->windowRegisters)){
+    reportStoreError(STORE_OUT_OF_BOUND, "\nin readRegister:\n"
+                     "register out of the window, returning 0\n");
+    return 0;
+  }
+  if (isZeroRegister(REGISTERFILE, index))
+    return 0;
+
+  return readStoreWord(&REGISTERFILE->registers,
+                       physicalRegister(REGISTERFILE, index));
+}
+
+/* int writeRegister(registerFile *REGISTERFILE, uint64_t index,
+                     uint64_t number):
+ * Writes lowest wordSize bits of number to visible register index, unless
+ * it's hardwired to zero. Returns 0, or -1 if it's out of the window.
+ */
+static inline int writeRegister(registerFile *REGISTERFILE, uint64_t index,
+                                uint64_t number){
+  if (STORE_CHECK_FAILS(index >= REGISTERFILE->windowRegisters)){
+    reportStoreError(STORE_OUT_OF_BOUND, "\nin writeRegister:\n"
+                     "register out of the window, returning -1\n");
+    return -1;
+  }
+  if (isZeroRegister(REGISTERFILE, index))
+    return 0;
+
+  return writeStoreWord(&REGISTERFILE->registers,
+                        physicalRegister(REGISTERFILE, index), number);
+}
+#endif
@@ -5,6 +5,38 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/* enum storeKind:
+ * Layout used to hold the data of a store, chosen at initialization.
+ *  -MATRIX_STORE keeps one heap row of bool per location, a byte per bit.
+ *  -PACKED_STORE packs all bits of the store contiguously in a single
+ *   allocation of uint64_t words.
+ *  -PAGED_STORE packs bits the same way, but in fixed size pages allocated
+ *   on first write, reads of untouched pages give 0 without allocating.
+ *   Made for large, sparsely used address spaces.
+ *  -MAPPED_STORE packs bits like PACKED_STORE in a memory mapped file,
+ *   see initializeMappedStore.
+ */
+typedef enum{
+  MATRIX_STORE,
+  PACKED_STORE,
+  PAGED_STORE,
+  MAPPED_STORE
+}storeKind;
+
+/* enum storeMapping:
+ * How the file behind a MAPPED_STORE is mapped.
+ *  -ROM_MAPPING maps it read only, every write to the store fails.
+ *  -PRIVATE_MAPPING maps it copy-on-write, writes stay in memory and the
+ *   file is never changed, as RAM initialized from an image.
+ *  -SHARED_MAPPING maps it shared, writes go to the file, as a persistent
+ *   NVRAM.
+ */
+typedef enum{
+  ROM_MAPPING,
+  PRIVATE_MAPPING,
+  SHARED_MAPPING
+}storeMapping;
+
 /* struct store:
  * Data structure to hold data of the store
  * and info about the status of the particular
@@ -12,17 +44,40 @@
  * separately as structure in c is non dynamic.
  */
 typedef struct{
-  int wordSize;
-  int totalLocations;
+  uint64_t wordSize;
+  uint64_t totalLocations;
   bool set;
+  storeKind kind;
   bool **matrix;
+  uint64_t *words;
+  struct storePageTable *pages;
+  bool readOnly;
+  bool concurrent;
+  struct storeSnapshot *snapshot;
+  struct storeDirtyMap *dirty;
+  struct storeHashTree *hashes;
+  bool traced;
+  uint16_t traceId;
+  struct storeDeviceTable *devices;
+  bool inArena;
 }store;
 
 store initializeStore(const uint64_t totalLocations,
                       const uint64_t wordSize);
+store initializeStoreofKind(const uint64_t totalLocations,
+                            const uint64_t wordSize, const storeKind kind);
+store initializeMappedStore(const char *path, const uint64_t totalLocations,
+                            const uint64_t wordSize,
+                            const storeMapping mapping);
+int syncMappedStore(store givenStore);
+int makeStoreConcurrent(store *STORE);
+void destroyStore(store *STORE);
 int writeBittoStore(store givenStore, const uint64_t location,
                     const uint64_t bitinWord, const bool value);
 int readBitfromStore(const store givenStore, const uint64_t location,
                      const uint64_t bitinWord);
 size_t sizeofStore(store givenStore);
+size_t footprintofStore(store givenStore);
+int tlbCountersofStore(store givenStore, uint64_t *hits, uint64_t *misses);
+int resetTLBCountersofStore(store givenStore);
 #endif
@@ -0,0 +1,47 @@
+#ifndef LIB_STORE_STOREARENA_H
+#define LIB_STORE_STOREARENA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Arenas hold the state of a simulated machine, e.g. GPRs, FPRs, CSRs and
+ * vector registers of a core, as PACKED_STOREs all in one allocation
+ * aligned to STORE_ARENA_ALIGNMENT bytes: the store objects, then the
+ * packed bits of the hot stores back to back, then those of the others,
+ * each from a new cache line. Resetting or cloning a whole arena is a
+ * single memset or memcpy of its packed bits, and destroyStoreArena frees
+ * it all at once. Stores of an arena are used as any other, destroyStore
+ * on one only frees what was attached to it (snapshot, dirty pages, hash,
+ * devices), attach those to the store objects of the arena. An arena is
+ * meant for a single thread, its stores share cache lines.
+ */
+#define STORE_ARENA_ALIGNMENT 64
+
+/* struct storeLayout:
+ * Geometry of a store of an arena, hot if accessed on most steps.
+ */
+typedef struct{
+  uint64_t totalLocations;
+  uint64_t wordSize;
+  bool hot;
+}storeLayout;
+
+/* struct storeArena:
+ * stores[index] is the store laid out by layouts[index], its packed bits
+ * are among the dataBytes bytes from data.
+ */
+typedef struct{
+  store *stores;
+  unsigned totalStores;
+  uint8_t *data;
+  uint64_t dataBytes;
+}storeArena;
+
+storeArena initializeStoreArena(const storeLayout layouts[],
+                                const unsigned totalStores);
+int resetStoreArena(storeArena ARENA);
+storeArena cloneStoreArena(const storeArena ARENA);
+void destroyStoreArena(storeArena *ARENA);
+#endif
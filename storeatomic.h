@@ -0,0 +1,46 @@
+#ifndef LIB_STORE_STOREATOMIC_H
+#define LIB_STORE_STOREATOMIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Lock free atomic operations on whole words of a store, for guest atomic
+ * memory operations of harts simulated by different threads. A word must
+ * be 1 to 64 bits and lie inside one 8 byte aligned unit of the packed
+ * bits, as every word of a size dividing 64 does, in any kind of store but
+ * MATRIX_STORE. Plain accesses sharing the store must go through a store
+ * made concurrent with makeStoreConcurrent.
+ * Load reserved / store conditional pairs map onto loadAcquirefromStore
+ * and compareAndSwapinStore with the loaded value as expected.
+ * In a traced store, each operation is recorded as the read or write of
+ * the whole word it ends with, see storetrace.h.
+ */
+
+/* enum atomicOperation:
+ * Operation of fetchAndOperateinStore between the word and the operand,
+ * minimum and maximum taking both signed (two's complement of wordSize
+ * bits) or unsigned, ATOMIC_SWAP replacing the word with the operand.
+ */
+typedef enum{
+  ATOMIC_ADD,
+  ATOMIC_AND,
+  ATOMIC_OR,
+  ATOMIC_XOR,
+  ATOMIC_MIN,
+  ATOMIC_MAX,
+  ATOMIC_MIN_UNSIGNED,
+  ATOMIC_MAX_UNSIGNED,
+  ATOMIC_SWAP
+}atomicOperation;
+
+uint64_t loadAcquirefromStore(const store STORE, const uint64_t location);
+int storeReleasetoStore(store STORE, const uint64_t location,
+                        const uint64_t number);
+int compareAndSwapinStore(store STORE, const uint64_t location,
+                          uint64_t *expected, const uint64_t desired);
+int fetchAndOperateinStore(store STORE, const uint64_t location,
+                           const atomicOperation operation,
+                           const uint64_t operand, uint64_t *previous);
+#endif
@@ -0,0 +1,26 @@
+#ifndef LIB_STORE_STOREBLOCK_H
+#define LIB_STORE_STOREBLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Block operations on ranges of consecutive locations. Host buffers hold
+ * the bits of the range packed as in PACKED_STORE: word after word, first
+ * bit of the range as most significant bit of the first byte, so with a
+ * wordSize multiple of 8 every word is simply its bytes, most significant
+ * first. A buffer for totalLocations locations takes
+ * (totalLocations * wordSize + 7) / 8 bytes.
+ */
+int writeBlocktoStore(store STORE, const uint64_t location,
+                      const uint64_t totalLocations, const void *buffer);
+int readBlockfromStore(const store STORE, const uint64_t location,
+                       const uint64_t totalLocations, void *buffer);
+int fillBlockinStore(store STORE, const uint64_t location,
+                     const uint64_t totalLocations, const uint64_t number);
+int copyBlockbetweenStores(store destination,
+                           const uint64_t destinationLocation,
+                           const store source, const uint64_t sourceLocation,
+                           const uint64_t totalLocations);
+#endif
@@ -0,0 +1,44 @@
+#ifndef LIB_STORE_STOREDEVICE_H
+#define LIB_STORE_STOREDEVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Devices attach to ranges of locations of a store, e.g. registers of a
+ * simulated UART in the address space of a guest RAM, and the byte
+ * accessors (readBytesfromStore, writeBytestoStore, their endian specific
+ * entry points, readValuefromStore and writeValuetoStore) call their
+ * handlers instead of touching the words of an access inside the range.
+ * An access running out of the range, into the store or another range,
+ * fails with STORE_INVALID_ARGUMENT, neither side getting part of it.
+ * Handlers get the arguments of the byte accessors, byteLength cut to the
+ * bytes the access covers, and a number of byteLength bytes. Other
+ * accessors reach the words of the store under the range, e.g. for the
+ * device to keep its registers there.
+ * Stores without devices pay a single check; a store with devices looks
+ * up a bit of a map of pages of locations, then the sorted ranges of
+ * marked pages. Like dirty pages, only the store object given to the first
+ * attachDevicetoStore and copies of it made after see the devices. Don't
+ * attach or detach while other threads access the store.
+ */
+
+/* storeDeviceRead, storeDeviceWrite:
+ * Handlers of a device, given the context passed to attachDevicetoStore.
+ * A read returns the number of byteLength bytes read, a write returns 0,
+ * or -1 to fail the access.
+ */
+typedef uint64_t (*storeDeviceRead)(void *context, uint64_t location,
+                                    uint64_t wordStartBit,
+                                    unsigned byteLength, bool endianStyle);
+typedef int (*storeDeviceWrite)(void *context, uint64_t location,
+                                uint64_t wordStartBit, uint64_t number,
+                                unsigned byteLength, bool endianStyle);
+
+int attachDevicetoStore(store *STORE, const uint64_t firstLocation,
+                        const uint64_t totalLocations, storeDeviceRead read,
+                        storeDeviceWrite write, void *context);
+int detachDevicefromStore(store *STORE, const uint64_t firstLocation);
+void detachAllDevicesfromStore(store *STORE);
+#endif
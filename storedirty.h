@@ -0,0 +1,28 @@
+#ifndef LIB_STORE_STOREDIRTY_H
+#define LIB_STORE_STOREDIRTY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Dirty pages tell which parts of a store were written since the last
+ * clearDirtyPages, e.g. to compare a simulated RAM with a golden model
+ * only where either changed. Every write path marks the pages of
+ * STORE_PAGE_BYTES bytes of packed bits it writes, so ranges are given in
+ * whole pages, widened to the locations they hold, and may hold locations
+ * written with their old value. Bits are kept in chunks allocated on the
+ * first write under them, so a huge sparse PAGED_STORE pays only for what
+ * is written, and clearDirtyPages and nextDirtyRange cost in proportion to
+ * the pages dirty; a write needing a chunk fails if it can't be allocated.
+ * Like snapshots, only the store object given to trackDirtyPages and copies
+ * of it made after mark pages.
+ */
+int trackDirtyPages(store *STORE);
+void stopTrackingDirtyPages(store *STORE);
+int clearDirtyPages(const store STORE);
+int nextDirtyRange(const store STORE, const uint64_t location,
+                   uint64_t *firstLocation, uint64_t *totalLocations);
+int64_t diffStores(const store first, const store second,
+                   uint64_t locations[], const uint64_t maxLocations);
+#endif
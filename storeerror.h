@@ -0,0 +1,55 @@
+#ifndef LIB_STORE_STOREERROR_H
+#define LIB_STORE_STOREERROR_H
+
+#include <stdbool.h>
+
+/* enum storeError:
+ * What went wrong in the last failing call of the library on this thread.
+ * STORE_TRUNCATED is a warning, the call did its work on fewer bits or
+ * bytes than requested.
+ */
+typedef enum{
+  STORE_OK = 0,
+  STORE_NOT_INITIALIZED,
+  STORE_OUT_OF_BOUND,
+  STORE_INVALID_ARGUMENT,
+  STORE_TRUNCATED,
+  STORE_ALLOCATION_FAILED,
+  STORE_WRITE_FAILED,
+  STORE_WRONG_KIND,
+  STORE_IO_FAILED
+}storeError;
+
+/* storeErrorHandler:
+ * Callback given the error, a formatted message naming the function that
+ * failed and why, and the context passed to setStoreErrorHandler.
+ */
+typedef void (*storeErrorHandler)(storeError error, const char *message,
+                                  void *context);
+
+/* Errors are kept per thread instead of being printed. Like errno, the
+ * error is only set by failing calls (and truncating ones), so check it
+ * after a call reports failure, or clear it before a sequence of calls.
+ * A handler, if set, is called for every error of every thread, set it
+ * before starting threads which use the library.
+ */
+storeError lastStoreError(void);
+void clearStoreError(void);
+const char *storeErrorName(storeError error);
+void setStoreErrorHandler(storeErrorHandler handler, void *context);
+void printStoreError(storeError error, const char *message, void *context);
+void reportStoreError(storeError error, const char *format, ...);
+
+/* STORE_CHECK_FAILS(condition):
+ * Guards every validation of arguments in the library. Building with
+ * STORE_UNCHECKED defined drops all of them, along with the bounds checks
+ * of the inline accessors, for inner loops already known to be valid.
+ * Out of bound accesses are undefined behaviour in that mode.
+ */
+#ifdef STORE_UNCHECKED
+#define STORE_CHECK_FAILS(condition) (false && (condition))
+#else
+#define STORE_CHECK_FAILS(condition) __builtin_expect(!!(condition), 0)
+#endif
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef LIB_STORE_STOREFIELD_H
+#define LIB_STORE_STOREFIELD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Field descriptors pull values made of bit fragments scattered in a word,
+ * e.g. immediates of an instruction, in one step. Bits are numbered as in
+ * ISA manuals: bit 0 is the least significant bit of the word read as a
+ * number, so bit wordSize - 1 is the first bit of the word in the store.
+ * Fragments are listed from the one giving the most significant bits of
+ * the value, with the bits of each keeping their order. The B immediate of
+ * RISC-V is {{31, 31}, {7, 7}, {30, 25}, {11, 8}} with a valueShift of 1
+ * and signExtend.
+ * Fragments following each other in the word as in the value are
+ * compiled in one group, extracted with a single pext and inserted with a
+ * single pdep when the CPU has BMI2, otherwise every fragment is a shift
+ * and a mask. Words of the stores must be at most 64 bits.
+ */
+#define FIELD_MAX_FRAGMENTS 16
+
+/* struct fieldFragment:
+ * Bits highBit down to lowBit of the word.
+ */
+typedef struct{
+  uint8_t highBit;
+  uint8_t lowBit;
+}fieldFragment;
+
+/* struct fieldDescriptor:
+ * Compiled form of a list of fragments, made by compileFieldDescriptor.
+ * 'shift' is the position of the lowest bit of a fragment or group in the
+ * value, 'mask' the bits of a group in the word.
+ */
+typedef struct{
+  unsigned totalFragments;
+  unsigned totalGroups;
+  unsigned width;
+  unsigned highestBit;
+  bool signExtend;
+  bool usePext;
+  uint64_t wordMask;
+  struct{
+    uint8_t lowBit;
+    uint8_t width;
+    uint8_t shift;
+  }fragments[FIELD_MAX_FRAGMENTS];
+  struct{
+    uint64_t mask;
+    uint8_t shift;
+  }groups[FIELD_MAX_FRAGMENTS];
+}fieldDescriptor;
+
+int compileFieldDescriptor(fieldDescriptor *descriptor,
+                           const fieldFragment fragments[],
+                           const unsigned totalFragments,
+                           const unsigned valueShift, const bool signExtend);
+uint64_t extractField(const fieldDescriptor *descriptor, uint64_t word);
+uint64_t insertField(const fieldDescriptor *descriptor, uint64_t word,
+                     uint64_t value);
+int extractFieldsfromStore(const store STORE, const uint64_t location,
+                           const fieldDescriptor descriptors[],
+                           const unsigned totalDescriptors,
+                           uint64_t values[]);
+int insertFieldsinStore(store STORE, const uint64_t location,
+                        const fieldDescriptor descriptors[],
+                        const unsigned totalDescriptors,
+                        const uint64_t values[]);
+int extractFieldsfromBlock(const store STORE, const uint64_t location,
+                           const uint64_t totalLocations,
+                           const fieldDescriptor descriptors[],
+                           const unsigned totalDescriptors,
+                           uint64_t values[]);
+#endif
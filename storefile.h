@@ -0,0 +1,34 @@
+#ifndef LIB_STORE_STOREFILE_H
+#define LIB_STORE_STOREFILE_H
+
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Store files save the geometry and packed bits of a store, e.g. for
+ * checkpoints, streamed through a file descriptor (file, pipe or socket),
+ * written in chunks of STORE_FILE_CHUNK_BYTES, never holding a second copy
+ * of the store. Loads read no byte past the last record, so stores saved
+ * one after the other on a descriptor load back in turn. All numbers are
+ * little endian:
+ *   header: "STOR", version (4 bytes), STORE_PAGE_BYTES (4 bytes),
+ *           options (4 bytes), wordSize (8 bytes), totalLocations (8 bytes)
+ *   then for every page of STORE_PAGE_BYTES bytes of packed bits holding a
+ *   bit set, in increasing order:
+ *           page number (8 bytes), encoding (1 byte, 0 raw, 1 LZ block),
+ *           length of the payload (4 bytes), payload
+ *   and a last record of page number UINT64_MAX, encoding 0, length 0.
+ * The last page of the store is cut at its last byte. With
+ * STORE_FILE_COMPRESSED, pages are compressed with the bundled LZ4 style
+ * codec, those which don't shrink are kept raw.
+ */
+#define STORE_FILE_VERSION 1
+#define STORE_FILE_CHUNK_BYTES ((uint32_t)1 << 16)
+
+/* options of saveStoretoFile. */
+#define STORE_FILE_COMPRESSED 1
+
+int saveStoretoFile(const store STORE, const int fd, const unsigned options);
+store loadStorefromFile(const int fd, const storeKind kind);
+int loadFileintoStore(store STORE, const int fd);
+#endif
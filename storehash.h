@@ -0,0 +1,25 @@
+#ifndef LIB_STORE_STOREHASH_H
+#define LIB_STORE_STOREHASH_H
+
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Content hashes fingerprint the state of stores, e.g. to deduplicate
+ * machine states found by a fuzzer. A store tracking its hash keeps a tree
+ * of hashes of its pages of STORE_PAGE_BYTES bytes of packed bits, writes
+ * mark their pages stale, and hashofStore rehashes only those and the
+ * nodes above them, so after small changes it costs microseconds. Hashes of
+ * the tree are allocated only where they differ from those of zeroed pages,
+ * and the first hashofStore of a PAGED_STORE hashes only its allocated
+ * pages, so huge sparse stores pay for the pages written.
+ * Stores of the same geometry and contents hash the same whatever their
+ * kind. Hashes are fast, not cryptographic, and depend on the byte order of
+ * the host. Like snapshots, only the store object given to trackStoreHash
+ * and copies of it made after mark pages stale.
+ */
+int trackStoreHash(store *STORE);
+void stopTrackingStoreHash(store *STORE);
+uint64_t hashofStore(const store STORE);
+uint64_t hashofStores(store *stores[], const unsigned totalStores);
+#endif
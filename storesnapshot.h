@@ -0,0 +1,25 @@
+#ifndef LIB_STORE_STORESNAPSHOT_H
+#define LIB_STORE_STORESNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Snapshots save the state of a store to roll back to it later, e.g. the
+ * RAM and register stores of a machine between runs of a fuzzer. Taking a
+ * snapshot copies nothing, pages of STORE_PAGE_BYTES bytes of the store
+ * are copied when written for the first time after it, so restoring takes
+ * time in proportion to the pages written since, not to the size of the
+ * store. A restore keeps the snapshot, the store can be rolled back to it
+ * again and again; taking a new one replaces it.
+ * Works with every kind of store, but only through the store object given
+ * to takeStoreSnapshot and copies of it made after, copies made before
+ * write without saving pages. A concurrent store can't have a snapshot.
+ */
+int takeStoreSnapshot(store *STORE);
+int restoreStoreSnapshot(store *STORE);
+void dropStoreSnapshot(store *STORE);
+int takeStoreSnapshots(store *stores[], const unsigned totalStores);
+int restoreStoreSnapshots(store *stores[], const unsigned totalStores);
+#endif
@@ -0,0 +1,38 @@
+#ifndef LIB_STORE_STORETRACE_H
+#define LIB_STORE_STORETRACE_H
+
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Access traces record every read and write of the stores given to
+ * traceStore, e.g. to find where a simulated guest diverges, as records
+ * of (store id, location, bit in word, width, value, read or write).
+ * Accesses go through readStoreBits and writeStoreBits, so a record is a
+ * field of 1 to 64 bits as the store moved it: a block or value access
+ * gives several records, and a record of a block may run on past the end
+ * of its word. Stores not traced pay a single check; traced stores take
+ * the out of line paths.
+ * Records go to a ring of the thread making the access, given by
+ * startStoreTrace, so threads never share one. A ring with a file
+ * descriptor drains into it when full, else it keeps the latest records,
+ * dropping the oldest. Loads of store files and snapshot restores are not
+ * recorded.
+ * Rings drain as blocks, all numbers little endian:
+ *   "STRC", STORE_TRACE_VERSION (4 bytes), number of records (8 bytes),
+ *   number of records dropped before them (8 bytes)
+ * then the records, each:
+ *   location (8 bytes), value (8 bytes), bit in word (4 bytes),
+ *   store id (2 bytes), width (1 byte), 1 for a write else 0 (1 byte).
+ * replayStoreTrace writes the write records of such blocks again.
+ */
+#define STORE_TRACE_VERSION 1
+
+int startStoreTrace(const uint64_t capacity, const int fd);
+int64_t drainStoreTrace(const int fd);
+int stopStoreTrace(void);
+int traceStore(store *STORE, const uint16_t storeId);
+void untraceStore(store *STORE);
+int64_t replayStoreTrace(const int fd, store *stores[],
+                         const unsigned totalStores);
+#endif
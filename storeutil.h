@@ -5,19 +5,282 @@
 #include <stdint.h>
 
 #include "store/store.h"
+#include "store/storeerror.h"
+#include "store/implementation/packedbits.h"
 
+/* endianStyle of the byte accessors. */
+#define BIGENDIAN 0
+#define LITTLEENDIAN 1
+
+int checkStore(const store STORE, const uint64_t location,
+               const uint64_t wordBit);
+int writeMultiBitstoStore (store STORE, const uint64_t location,
+                           const uint64_t wordStartBit, const bool bitArray[],
+                           uint64_t length);
+int64_t readMultiBitsintoBuffer (const store STORE, const uint64_t location,
+                                 const uint64_t wordStartBit,
+                                 uint64_t numberofBits, bool bitArray[]);
+bool *readMultiBitsfromStore (const store STORE, const uint64_t location,
+                              const uint64_t wordStartBit,
+                              uint64_t numberofBits);
+void numbertoBitStringinBuffer(uint64_t number, uint64_t length,
+                               bool bitString[]);
+bool *numbertoBitString(uint64_t number, uint64_t length);
+uint64_t bitStringtoNumber (bool bitString[], uint64_t bitLength);
 int writeNumBitstoStore (store STORE, const uint64_t location,
                          const uint64_t wordStartBit, uint64_t number,
                          uint64_t length);
-uint64_t readNumBitstoStore (store STORE, const uint64_t location,
-                             const uint64_t wordStartBit,
-                             uint64_t bitLength);
 uint64_t readNumBitsfromStore(store STORE, const uint64_t location,
                               const uint64_t wordStartBit, uint64_t width);
-int writeBytestoStore(store STORE, const uint64_t location,
+uint64_t readFieldfromStore(const store STORE, const uint64_t location,
+                            const uint64_t wordStartBit,
+                            const uint64_t width);
+int writeFieldtoStore(store STORE, const uint64_t location,
+                      const uint64_t wordStartBit, const uint64_t width,
+                      uint64_t number);
+uint64_t giveBytestoUse (const uint64_t wordSize, const uint64_t wordStartBit,
+                         const uint64_t byteLength);
+uint64_t invertEndian(uint64_t number, unsigned byteLength);
+int writeBytestoStore(store STORE, uint64_t location,
                       const uint64_t wordStartBit, uint64_t number,
-                      uint64_t byteLength, bool endianStyle);
-uint64_t readBytestoStore(const store STORE, const uint64_t location,
-                          const uint64_t wordStartBit, uint64_t byteLength,
-                          const bool endianStyle);
+                      uint64_t byteLength, const bool endianStyle);
+uint64_t readBytesfromStore (const store STORE, const uint64_t location,
+                             const uint64_t wordStartBit,
+                             const unsigned byteLength,
+                             const bool endianStyle);
+int writeLittleEndianBytestoStore (store STORE, uint64_t location,
+                                   const uint64_t wordStartBit,
+                                   uint64_t number, uint64_t byteLength);
+int writeBigEndianBytestoStore (store STORE, uint64_t location,
+                                const uint64_t wordStartBit,
+                                uint64_t number, uint64_t byteLength);
+uint64_t readLittleEndianBytesfromStore (const store STORE,
+                                         const uint64_t location,
+                                         const uint64_t wordStartBit,
+                                         const unsigned byteLength);
+uint64_t readBigEndianBytesfromStore (const store STORE,
+                                      const uint64_t location,
+                                      const uint64_t wordStartBit,
+                                      const unsigned byteLength);
+int readValuefromStore(const store STORE, const uint64_t location,
+                       const uint64_t wordStartBit, const unsigned byteLength,
+                       const bool endianStyle, void *value);
+int writeValuetoStore(store STORE, const uint64_t location,
+                      const uint64_t wordStartBit, const unsigned byteLength,
+                      const bool endianStyle, const void *value);
+
+/* Inline accessors:
+ * Same accesses as readBitfromStore, readFieldfromStore and their write
+ * counterparts, but taking the store by pointer and defined here, so the
+ * compiler can inline them in the loops of a simulator and fold what it
+ * knows of the store. PACKED_STORE and writable MAPPED_STORE are accessed
+ * in place, other kinds, traced stores, and writes to a store noting its
+ * pages written (snapshot, dirty pages, hash), through readStoreBits and
+ * writeStoreBits.
+ * Checks follow STORE_UNCHECKED as defined where this header is included.
+ */
+
+/* uint8_t *flatBytesofStore(const store *STORE, bool writing):
+ * Returns the packed bits of a store held in place in a single block, for
+ * reading or writing, or NULL if it has to be accessed out of line, as a
+ * concurrent or traced store always is.
+ */
+static inline uint8_t *flatBytesofStore(const store *STORE, bool writing){
+  if (STORE->concurrent || storeTracesAccesses(STORE))
+    return NULL;
+  if (STORE->kind == PACKED_STORE ||
+      (STORE->kind == MAPPED_STORE && !(writing && STORE->readOnly)))
+    return (uint8_t*)STORE->words;
+  return NULL;
+}
+
+/* bool fieldOutofStore(const store *STORE, uint64_t location,
+                        uint64_t wordStartBit, uint64_t width):
+ * Returns true if the store is not initialized or the field of 'width'
+ * (1 to 64) bits from wordStartBit is not inside the word at location.
+ */
+static inline bool fieldOutofStore(const store *STORE, uint64_t location,
+                                   uint64_t wordStartBit, uint64_t width){
+  return !STORE->set || location >= STORE->totalLocations ||
+         width == 0 || width > 64 || wordStartBit >= STORE->wordSize ||
+         width > STORE->wordSize - wordStartBit;
+}
+
+/* uint64_t readStoreField(const store *STORE, uint64_t location,
+                           uint64_t wordStartBit, unsigned width):
+ * Inline readFieldfromStore. Returns the field, or 0 if checks fail.
+ */
+static inline uint64_t readStoreField(const store *STORE, uint64_t location,
+                                      uint64_t wordStartBit, unsigned width){
+  if (STORE_CHECK_FAILS(fieldOutofStore(STORE, location, wordStartBit,
+                                        width))){
+    reportStoreError(STORE_OUT_OF_BOUND, "\nin readStoreField:\n"
+                     "field is out of the store, returning 0\n");
+    return 0;
+  }
+
+  uint64_t bit = location * STORE->wordSize + wordStartBit;
+  const uint8_t *bytes = flatBytesofStore(STORE, false);
+  if (bytes)
+    return readFlatBits(bytes, packedBytesofStore(STORE), bit, width);
+
+  return readStoreBits(STORE, bit, width);
+}
+
+/* int writeStoreField(store *STORE, uint64_t location,
+                       uint64_t wordStartBit, unsigned width,
+                       uint64_t number):
+ * Inline writeFieldtoStore. Returns 0, or -1 if checks fail or the store
+ * can't be written.
+ */
+static inline int writeStoreField(store *STORE, uint64_t location,
+                                  uint64_t wordStartBit, unsigned width,
+                                  uint64_t number){
+  if (STORE_CHECK_FAILS(fieldOutofStore(STORE, location, wordStartBit,
+                                        width))){
+    reportStoreError(STORE_OUT_OF_BOUND, "\nin writeStoreField:\n"
+                     "field is out of the store, returning -1\n");
+    return -1;
+  }
+
+  uint64_t bit = location * STORE->wordSize + wordStartBit;
+  uint8_t *bytes = !storeWatchesWrites(STORE) ?
+                   flatBytesofStore(STORE, true) : NULL;
+  if (bytes){
+    writeFlatBits(bytes, packedBytesofStore(STORE), bit, width, number);
+    return 0;
+  }
+
+  return writeStoreBits(STORE, bit, width, number);
+}
+
+/* int readStoreBit(const store *STORE, uint64_t location,
+                    uint64_t bitinWord):
+ * Inline readBitfromStore. Returns the bit, or -1 if checks fail.
+ */
+static inline int readStoreBit(const store *STORE, uint64_t location,
+                               uint64_t bitinWord){
+  if (STORE_CHECK_FAILS(fieldOutofStore(STORE, location, bitinWord, 1))){
+    reportStoreError(STORE_OUT_OF_BOUND, "\nin readStoreBit:\n"
+                     "bit is out of the store, returning -1\n");
+    return -1;
+  }
+
+  uint64_t bit = location * STORE->wordSize + bitinWord;
+  const uint8_t *bytes = flatBytesofStore(STORE, false);
+  if (bytes)
+    return (bytes[bit / 8] >> (7 - bit % 8)) & 1;
+
+  return readStoreBits(STORE, bit, 1);
+}
+
+/* int writeStoreBit(store *STORE, uint64_t location, uint64_t bitinWord,
+                     bool value):
+ * Inline writeBittoStore. Returns 0, or -1 if checks fail or the store
+ * can't be written.
+ */
+static inline int writeStoreBit(store *STORE, uint64_t location,
+                                uint64_t bitinWord, bool value){
+  return writeStoreField(STORE, location, bitinWord, 1, value);
+}
+
+/* uint64_t readStoreWord(const store *STORE, uint64_t location):
+ * Returns the whole word at location of a store of words up to 64 bits,
+ * or 0 if checks fail or words are wider. Wider words are refused even
+ * with STORE_UNCHECKED, they don't fit a field.
+ */
+static inline uint64_t readStoreWord(const store *STORE, uint64_t location){
+  if (STORE->wordSize > 64){
+    reportStoreError(STORE_INVALID_ARGUMENT, "\nin readStoreWord:\n"
+                     "words are wider than 64 bits, returning 0\n");
+    return 0;
+  }
+
+  return readStoreField(STORE, location, 0, STORE->wordSize);
+}
+
+/* int writeStoreWord(store *STORE, uint64_t location, uint64_t number):
+ * Writes lowest wordSize bits of number as the whole word at location of a
+ * store of words up to 64 bits. Returns 0, or -1 if checks fail, words are
+ * wider, refused as by readStoreWord, or the store can't be written.
+ */
+static inline int writeStoreWord(store *STORE, uint64_t location,
+                                 uint64_t number){
+  if (STORE->wordSize > 64){
+    reportStoreError(STORE_INVALID_ARGUMENT, "\nin writeStoreWord:\n"
+                     "words are wider than 64 bits, returning -1\n");
+    return -1;
+  }
+
+  return writeStoreField(STORE, location, 0, STORE->wordSize, number);
+}
+
+/* STORE_FIXED_GEOMETRY(name, totalLocations, wordSize):
+ * Defines inline accessors of whole words for stores of a geometry known
+ * at compile time, wordSize from 1 to 64:
+ *   uint64_t read<name>(const store *STORE, uint64_t location)
+ *   int write<name>(store *STORE, uint64_t location, uint64_t number)
+ * They take a PACKED_STORE or MAPPED_STORE of exactly that geometry, not
+ * made concurrent, or a traced store of that geometry, which they access
+ * out of line, with the same returns as readStoreWord and
+ * writeStoreWord. Once checks are dropped, a word of 8, 16, 32 or 64 bits
+ * is a single load or store, plus a byte swap on little endian hosts.
+ */
+#define STORE_FIXED_GEOMETRY(name, fixedLocations, fixedWordSize)             \
+_Static_assert((fixedWordSize) >= 1 && (fixedWordSize) <= 64,                 \
+               #name ": word size must be from 1 to 64 bits");                \
+                                                                              \
+static inline bool name##OutofStore(const store *STORE, uint64_t location,    \
+                                    bool writing){                            \
+  return !STORE->set || location >= (fixedLocations) ||                      \
+         STORE->totalLocations != (fixedLocations) ||                         \
+         STORE->wordSize != (fixedWordSize) ||                                \
+         (flatBytesofStore(STORE, writing) == NULL &&                         \
+          !storeTracesAccesses(STORE));                                       \
+}                                                                             \
+                                                                              \
+static inline uint64_t read##name(const store *STORE, uint64_t location){     \
+  if (STORE_CHECK_FAILS(name##OutofStore(STORE, location, false))){           \
+    reportStoreError(STORE_OUT_OF_BOUND, "\nin read" #name ":\n"              \
+                     "not a flat " #name " store or location out of it, "     \
+                     "returning 0\n");                                        \
+    return 0;                                                                 \
+  }                                                                           \
+                                                                              \
+  if (storeTracesAccesses(STORE))                                             \
+    return readStoreBits(STORE, location * (fixedWordSize), (fixedWordSize)); \
+                                                                              \
+  return readFlatBits((const uint8_t*)STORE->words,                           \
+                      packedBytesforGeometry((fixedLocations),                \
+                                             (fixedWordSize)),                \
+                      location * (fixedWordSize), (fixedWordSize));           \
+}                                                                             \
+                                                                              \
+static inline int write##name(store *STORE, uint64_t location,                \
+                              uint64_t number){                               \
+  if (STORE_CHECK_FAILS(name##OutofStore(STORE, location, true))){            \
+    reportStoreError(STORE_OUT_OF_BOUND, "\nin write" #name ":\n"             \
+                     "not a flat " #name " store or location out of it, "     \
+                     "returning -1\n");                                       \
+    return -1;                                                                \
+  }                                                                           \
+                                                                              \
+  if (storeWatchesWrites(STORE) || storeTracesAccesses(STORE))               \
+    return writeStoreBits(STORE, location * (fixedWordSize),                  \
+                          (fixedWordSize), number);                           \
+                                                                              \
+  writeFlatBits((uint8_t*)STORE->words,                                       \
+                packedBytesforGeometry((fixedLocations), (fixedWordSize)),    \
+                location * (fixedWordSize), (fixedWordSize), number);         \
+  return 0;                                                                   \
+}
+/* Common register file shapes, e.g. readRegisters32x32 and
+ * writeRegisters32x32 for 32 registers of 32 bits.
+ */
+STORE_FIXED_GEOMETRY(Registers8x8, 8, 8)
+STORE_FIXED_GEOMETRY(Registers16x16, 16, 16)
+STORE_FIXED_GEOMETRY(Registers16x32, 16, 32)
+STORE_FIXED_GEOMETRY(Registers32x32, 32, 32)
+STORE_FIXED_GEOMETRY(Registers32x64, 32, 64)
+STORE_FIXED_GEOMETRY(Registers64x64, 64, 64)
 #endif
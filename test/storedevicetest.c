@@ -0,0 +1,157 @@
+/* storedevicetest.c:
+ * Checks that values running out of the range of a device fail with
+ * STORE_INVALID_ARGUMENT, the device and the store getting none of them:
+ * a value ending inside a device, one starting inside it and running
+ * past it, and a 16 byte value holding a device of one location, in every
+ * kind of store the devices take.
+ * Build from the folder holding the 'store' folder, e.g.
+ *   cc -O2 -I. store/test/storedevicetest.c store/implementation/[a-z]*.c \
+ *      -o storedevicetest
+ * Prints the failing checks, exits with 0 if none failed, else 1.
+ */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "store/store.h"
+#include "store/storedevice.h"
+#include "store/storeerror.h"
+#include "store/storeutil.h"
+
+/* a device of 4 locations from WIDE_DEVICE, one at NARROW_DEVICE.*/
+#define WIDE_DEVICE 20
+#define NARROW_DEVICE 40
+
+static int failures;
+static unsigned deviceCalls;
+
+/* void check(bool condition, const char *what, storeKind kind):
+ * Counts and prints a failed check of a store of kind.
+ */
+static void check(bool condition, const char *what, storeKind kind){
+  if (!condition){
+    printf("FAILED: %s, store kind %d\n", what, (int)kind);
+    failures++;
+  }
+}
+
+/* uint64_t readDevice(void *context, uint64_t location,
+                       uint64_t wordStartBit, unsigned byteLength,
+                       bool endianStyle):
+ * Counts the call and reads bytes 0xdd.
+ */
+static uint64_t readDevice(void *context, uint64_t location,
+                           uint64_t wordStartBit, unsigned byteLength,
+                           bool endianStyle){
+  (void)context; (void)location; (void)wordStartBit; (void)endianStyle;
+  deviceCalls++;
+  return 0xddddddddddddddddull >> (64 - 8 * byteLength);
+}
+
+/* int writeDevice(void *context, uint64_t location, uint64_t wordStartBit,
+                   uint64_t number, unsigned byteLength, bool endianStyle):
+ * Counts the call and takes the write.
+ */
+static int writeDevice(void *context, uint64_t location,
+                       uint64_t wordStartBit, uint64_t number,
+                       unsigned byteLength, bool endianStyle){
+  (void)context; (void)location; (void)wordStartBit; (void)number;
+  (void)byteLength; (void)endianStyle;
+  deviceCalls++;
+  return 0;
+}
+
+/* bool storeUntouched(const store STORE, uint64_t location,
+                       uint64_t totalLocations):
+ * Returns true if the words from location still hold their location, as
+ * written by testStraddlingValues.
+ */
+static bool storeUntouched(const store STORE, uint64_t location,
+                           uint64_t totalLocations){
+  for (uint64_t next = location; next < location + totalLocations; next++)
+    if (readFieldfromStore(STORE, next, 0, 8) != next)
+      return false;
+  return true;
+}
+
+/* bool accessRefused(int returned):
+ * Returns true if an access returned -1 with STORE_INVALID_ARGUMENT and
+ * no handler was called, then resets the error and the calls.
+ */
+static bool accessRefused(int returned){
+  bool refused = returned == -1 &&
+                 lastStoreError() == STORE_INVALID_ARGUMENT &&
+                 deviceCalls == 0;
+  clearStoreError();
+  deviceCalls = 0;
+  return refused;
+}
+
+/* void testStraddlingValues(storeKind kind):
+ * Attaches the devices to a store of kind of 8 bit words, each word
+ * holding its location, and checks values straddling them.
+ */
+static void testStraddlingValues(storeKind kind){
+  store STORE = initializeStoreofKind(64, 8, kind);
+  for (uint64_t location = 0; location < 64; location++)
+    writeFieldtoStore(STORE, location, 0, 8, location);
+  check(attachDevicetoStore(&STORE, WIDE_DEVICE, 4, readDevice, writeDevice,
+                            NULL) == 0, "attach of the wide device", kind);
+  check(attachDevicetoStore(&STORE, NARROW_DEVICE, 1, readDevice,
+                            writeDevice, NULL) == 0,
+        "attach of the narrow device", kind);
+
+  uint64_t value[2], pattern[2] = {0xaaaaaaaaaaaaaaaaull,
+                                   0xaaaaaaaaaaaaaaaaull};
+
+  /* 18 to 21, ending inside the wide device.*/
+  check(accessRefused(writeValuetoStore(STORE, WIDE_DEVICE - 2, 0, 4,
+                                        BIGENDIAN, pattern)),
+        "write of a value ending inside a device", kind);
+  check(accessRefused(readValuefromStore(STORE, WIDE_DEVICE - 2, 0, 4,
+                                         LITTLEENDIAN, value)),
+        "read of a value ending inside a device", kind);
+
+  /* 22 to 25, starting inside the wide device and running past it.*/
+  check(accessRefused(writeValuetoStore(STORE, WIDE_DEVICE + 2, 0, 4,
+                                        LITTLEENDIAN, pattern)),
+        "write of a value running past a device", kind);
+  check(accessRefused(readValuefromStore(STORE, WIDE_DEVICE + 2, 0, 4,
+                                         BIGENDIAN, value)),
+        "read of a value running past a device", kind);
+
+  /* 32 to 47, the narrow device in the middle.*/
+  check(accessRefused(writeValuetoStore(STORE, NARROW_DEVICE - 8, 0, 16,
+                                        BIGENDIAN, pattern)),
+        "write of a 16 byte value holding a device", kind);
+  check(accessRefused(readValuefromStore(STORE, NARROW_DEVICE - 8, 0, 16,
+                                         LITTLEENDIAN, value)),
+        "read of a 16 byte value holding a device", kind);
+
+  check(storeUntouched(STORE, 0, 64), "store untouched by refused writes",
+        kind);
+
+  /* values inside a device or beside it still go through.*/
+  check(writeValuetoStore(STORE, WIDE_DEVICE, 0, 4, BIGENDIAN,
+                          pattern) == 0 && deviceCalls == 1,
+        "write of a value filling a device", kind);
+  deviceCalls = 0;
+  check(readValuefromStore(STORE, NARROW_DEVICE + 1, 0, 8, BIGENDIAN,
+                           value) == 0 && deviceCalls == 0 &&
+        value[0] >> 56 == NARROW_DEVICE + 1,
+        "read of a value just past a device", kind);
+  check(storeUntouched(STORE, 0, 64), "store untouched by device writes",
+        kind);
+
+  destroyStore(&STORE);
+}
+
+int main(void){
+  testStraddlingValues(MATRIX_STORE);
+  testStraddlingValues(PACKED_STORE);
+  testStraddlingValues(PAGED_STORE);
+
+  if (failures == 0)
+    printf("all checks passed\n");
+  return failures != 0;
+}
@@ -0,0 +1,124 @@
+/* storefiletest.c:
+ * Checks that stores saved one after the other on a descriptor, as a RAM
+ * and the registers of a checkpoint, load back in turn, through a file
+ * and through a pipe, with loadStorefromFile and loadFileintoStore.
+ * Build from the folder holding the 'store' folder, e.g.
+ *   cc -O2 -I. store/test/storefiletest.c store/implementation/[a-z]*.c \
+ *      -o storefiletest
+ * Prints the failing checks, exits with 0 if none failed, else 1.
+ */
+#define _DEFAULT_SOURCE
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "store/store.h"
+#include "store/storefile.h"
+#include "store/storeutil.h"
+
+static int failures;
+
+/* void check(bool condition, const char *what):
+ * Counts and prints a failed check.
+ */
+static void check(bool condition, const char *what){
+  if (!condition){
+    printf("FAILED: %s\n", what);
+    failures++;
+  }
+}
+
+/* bool sameStores(const store first, const store second):
+ * Returns true if both stores hold the same geometry and words.
+ */
+static bool sameStores(const store first, const store second){
+  if (!first.set || !second.set || first.wordSize != second.wordSize ||
+      first.totalLocations != second.totalLocations)
+    return false;
+  for (uint64_t location = 0; location < first.totalLocations; location++)
+    for (uint64_t bit = 0; bit < first.wordSize; bit += 32){
+      uint64_t width = (first.wordSize - bit < 32) ?
+                       first.wordSize - bit : 32;
+      if (readFieldfromStore(first, location, bit, width) !=
+          readFieldfromStore(second, location, bit, width))
+        return false;
+    }
+  return true;
+}
+
+/* void fillStore(store STORE, uint64_t seed):
+ * Writes a pattern of seed in every other word of the store.
+ */
+static void fillStore(store STORE, uint64_t seed){
+  unsigned width = (STORE.wordSize < 64) ? STORE.wordSize : 64;
+  for (uint64_t location = 0; location < STORE.totalLocations; location += 2)
+    writeFieldtoStore(STORE, location, 0, width,
+                      (location + seed) * 0x9E3779B97F4A7C15ull);
+}
+
+/* void testStoresinTurn(int writeFd, int readFd, bool seekable):
+ * Saves a RAM, compressed, then a register file to writeFd and loads them
+ * back in turn from readFd, closing writeFd if it's not seekable.
+ */
+static void testStoresinTurn(int writeFd, int readFd, bool seekable){
+  store ram = initializeStoreofKind(3000, 8, PAGED_STORE);
+  store registers = initializeStoreofKind(32, 64, PACKED_STORE);
+  fillStore(ram, 1);
+  fillStore(registers, 2);
+
+  check(saveStoretoFile(ram, writeFd, STORE_FILE_COMPRESSED) == 0,
+        "save of the RAM");
+  off_t ramEnd = seekable ? lseek(writeFd, 0, SEEK_CUR) : 0;
+  check(saveStoretoFile(registers, writeFd, 0) == 0,
+        "save of the registers");
+  off_t registersEnd = seekable ? lseek(writeFd, 0, SEEK_CUR) : 0;
+  /* a pipe ends after the registers, a load reading past them fails
+   * instead of waiting.*/
+  if (seekable)
+    lseek(readFd, 0, SEEK_SET);
+  else
+    close(writeFd);
+
+  store loadedRam = loadStorefromFile(readFd, PACKED_STORE);
+  check(sameStores(ram, loadedRam), "RAM loaded first");
+  if (seekable)
+    check(lseek(readFd, 0, SEEK_CUR) == ramEnd,
+          "file left just past the RAM");
+
+  store loadedRegisters = initializeStoreofKind(32, 64, MATRIX_STORE);
+  writeFieldtoStore(loadedRegisters, 1, 0, 64, 12345);
+  check(loadFileintoStore(loadedRegisters, readFd) == 0,
+        "load of the registers after the RAM");
+  check(sameStores(registers, loadedRegisters), "registers loaded second");
+  if (seekable)
+    check(lseek(readFd, 0, SEEK_CUR) == registersEnd,
+          "file left just past the registers");
+
+  destroyStore(&ram);
+  destroyStore(&registers);
+  destroyStore(&loadedRam);
+  destroyStore(&loadedRegisters);
+}
+
+int main(void){
+  char path[] = "/tmp/storefiletestXXXXXX";
+  int fd = mkstemp(path);
+  check(fd >= 0, "temporary file created");
+  if (fd >= 0){
+    unlink(path);
+    testStoresinTurn(fd, fd, true);
+    close(fd);
+  }
+
+  /* both stores fit the buffer of a pipe, no reader needed while saving.*/
+  int pipeFds[2];
+  check(pipe(pipeFds) == 0, "pipe created");
+  testStoresinTurn(pipeFds[1], pipeFds[0], false);
+  close(pipeFds[0]);
+
+  if (failures == 0)
+    printf("all checks passed\n");
+  return failures != 0;
+}
@@ -0,0 +1,63 @@
+#ifndef LIB_STORE_VECTORSTORE_H
+#define LIB_STORE_VECTORSTORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "store/store.h"
+
+/* Vector registers are words of a store wider than 64 bits, e.g. 32
+ * locations of 128 to 2048 bits, split in elements of elementBits bits:
+ * element i takes bits i * elementBits to (i + 1) * elementBits - 1 of the
+ * word, most significant bit first as every field of a store, so element 0
+ * is in the first bytes of the word. Whole words move in and out of host
+ * buffers with readBlockfromStore and writeBlocktoStore.
+ *
+ * Lane operations take elements of 8, 16, 32 or 64 bits, words a multiple
+ * of them and at most STORE_VECTOR_MAX_BITS, with all operands in the same
+ * store. A mask is a vector register whose bit i, counted as element i of
+ * 1 bit, selects element i. Registers are worked on in place when the
+ * store keeps them in contiguous bytes, with host vectors of the width the
+ * library is built for (SSE, AVX2 or AVX-512 on x86), elements left over
+ * and compilers without vector extensions go one element at a time.
+ */
+#ifndef STORE_VECTOR_MAX_BITS
+#define STORE_VECTOR_MAX_BITS 2048
+#endif
+
+/* enum vectorComparison:
+ * Comparison made between each pair of elements by compareVectors, signed
+ * comparisons take the elements as two's complement.
+ */
+typedef enum{
+  VECTOR_EQUAL,
+  VECTOR_NOT_EQUAL,
+  VECTOR_LESS_UNSIGNED,
+  VECTOR_LESS_SIGNED
+}vectorComparison;
+
+uint64_t readVectorElement(const store STORE, const uint64_t location,
+                           const uint64_t element, const unsigned elementBits);
+int writeVectorElement(store STORE, const uint64_t location,
+                       const uint64_t element, const unsigned elementBits,
+                       const uint64_t number);
+int addVectors(store STORE, const uint64_t destination,
+               const uint64_t source1, const uint64_t source2,
+               const unsigned elementBits);
+int subtractVectors(store STORE, const uint64_t destination,
+                    const uint64_t source1, const uint64_t source2,
+                    const unsigned elementBits);
+int compareVectors(store STORE, const uint64_t destinationMask,
+                   const uint64_t source1, const uint64_t source2,
+                   const unsigned elementBits,
+                   const vectorComparison comparison);
+int mergeVectors(store STORE, const uint64_t destination,
+                 const uint64_t source1, const uint64_t source2,
+                 const uint64_t mask, const unsigned elementBits);
+int slideVectorUp(store STORE, const uint64_t destination,
+                  const uint64_t source, const unsigned elementBits,
+                  const uint64_t offset);
+int slideVectorDown(store STORE, const uint64_t destination,
+                    const uint64_t source, const unsigned elementBits,
+                    const uint64_t offset);
+#endif